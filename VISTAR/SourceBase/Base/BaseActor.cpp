@@ -98,15 +98,12 @@ void ABaseActor::setParentInfo(FString ParentId, int childId) {
 }
 
 void ABaseActor::unsetParentInfo() {
+	// Ingest is applied on the game thread, so detach directly
 	if (_m_nChildId > 0) {
-
-	AsyncTask(ENamedThreads::GameThread, [this]()
-		{
-			DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
-			_m_nChildId = 0;
-			WidgetObjectIdComponent->SetVisibility(true);
-			activateOnUpdate();
-		});
+		DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+		_m_nChildId = 0;
+		WidgetObjectIdComponent->SetVisibility(true);
+		activateOnUpdate();
 	}
 }
 
@@ -125,9 +122,6 @@ void ABaseActor::Refresh() {
 
 void ABaseActor::ProcessAction(FString sAction) {
 	if (sAction.Contains("destroy")) {
-		AsyncTask(ENamedThreads::GameThread, [this]()
-			{
-				OnObjectDestroyed();
-			});
+		OnObjectDestroyed();
 	}
 }
@@ -214,40 +214,24 @@ void ATrajectoryActor::BuildSplineMeshes()
 
 void ATrajectoryActor::TransmitSelfInfo() {
 
-	FString JsonOutput;
-
-	TSharedRef<FJsonObject> JsonObjectRoot = MakeShared<FJsonObject>();
+	UVistarGameInstance* VistarGI = Cast<UVistarGameInstance>(GetGameInstance());
+	if (!VistarGI)
+	{
+		return;
+	}
 
 	int32 NumPoints = SplineComponent->GetNumberOfSplinePoints();
 
-	TArray<TSharedPtr<FJsonValue>> JsonObjectLocationsList;
-
+	FVistarEntityUpdate Message;
+	Message.Stream = EVistarStream::Create;
+	Message.Id = FVistarEntityId(sObjectId);
+	Message.Class = VistarGI->GetVistarClassType(sObjectClass);
+	Message.Points.Reserve(NumPoints);
 	for (int32 i = 0; i < NumPoints; ++i)
 	{
-		FVector location = SplineComponent->GetLocationAtSplinePoint(i, ESplineCoordinateSpace::World);
-
-		TSharedRef<FJsonObject> JsonObjectLocation = MakeShared<FJsonObject>();
-		JsonObjectLocation->SetNumberField(TEXT("X"), location.X);
-		JsonObjectLocation->SetNumberField(TEXT("Y"), location.Y);
-		JsonObjectLocation->SetNumberField(TEXT("Z"), location.Z);
-		JsonObjectLocationsList.Add(MakeShared<FJsonValueObject>(JsonObjectLocation));
+		Message.Points.Add(SplineComponent->GetLocationAtSplinePoint(i, ESplineCoordinateSpace::World));
 	}
 
-
-	// Add key-value pairs
-	JsonObjectRoot->SetStringField(TEXT("ID"), sObjectId);
-	JsonObjectRoot->SetStringField(TEXT("CLASS"), sObjectClass);
-	JsonObjectRoot->SetStringField(TEXT("STREAM"), TEXT("Create"));
-	JsonObjectRoot->SetArrayField(TEXT("POINTS"), JsonObjectLocationsList);
-
-	// Convert to string
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonOutput);
-	FJsonSerializer::Serialize(JsonObjectRoot, Writer);
-
-	UVistarGameInstance* VistarGI = Cast<UVistarGameInstance>(GetGameInstance());
-
-	if (VistarGI)
-	{
-		VistarGI->SendMessage(JsonOutput);
-	}
+	// Long routes exceed one datagram, the sender fragments them
+	VistarGI->SendEntity(Message, sObjectClass);
 }
\ No newline at end of file
@@ -36,39 +36,29 @@ void AVistarActor::AttachTrajectory(FString trajectoryName) {
 
 void AVistarActor::TransmitSelfInfo() {
 	
-	FVector location = GetActorLocation();
-	FRotator rotation = GetActorRotation();
-	FString JsonOutput;
-
-	TSharedRef<FJsonObject> JsonObjectRoot = MakeShared<FJsonObject>();
-
-	TSharedRef<FJsonObject> JsonObjectLocation = MakeShared<FJsonObject>();
-	JsonObjectLocation->SetNumberField("X", location.X);
-	JsonObjectLocation->SetNumberField(TEXT("Y"), location.Y);
-	JsonObjectLocation->SetNumberField(TEXT("Z"), location.Z);
-
-	TSharedRef<FJsonObject> JsonObjectRotation = MakeShared<FJsonObject>();
-	JsonObjectRotation->SetNumberField(TEXT("YAW"), rotation.Yaw);
-	JsonObjectRotation->SetNumberField(TEXT("PITCH"), rotation.Pitch);
-	JsonObjectRotation->SetNumberField(TEXT("ROLL"), rotation.Roll);
-
-
-	// Add key-value pairs
-	JsonObjectRoot->SetStringField(TEXT("ID"), sObjectId);
-	JsonObjectRoot->SetStringField(TEXT("CLASS"), sObjectClass);
-	JsonObjectRoot->SetStringField(TEXT("STREAM"), TEXT("Create"));
-	JsonObjectRoot->SetStringField(TEXT("TRAJECTORY"), sAttachedTrajectoryName);
-	JsonObjectRoot->SetObjectField(TEXT("LOCATION"), JsonObjectLocation);
-	JsonObjectRoot->SetObjectField(TEXT("ROTATION"), JsonObjectRotation);
-
-	// Convert to string
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonOutput);
-	FJsonSerializer::Serialize(JsonObjectRoot, Writer);
-
 	UVistarGameInstance* VistarGI = Cast<UVistarGameInstance>(GetGameInstance());
-
-	if (VistarGI)
+	if (!VistarGI)
 	{
-		VistarGI->SendMessage(JsonOutput);
+		return;
 	}
+
+	FVector location = GetActorLocation();
+	FRotator rotation = GetActorRotation();
+
+	FVistarEntityUpdate Message;
+	Message.Stream = EVistarStream::Create;
+	Message.Id = FVistarEntityId(sObjectId);
+	Message.Class = VistarGI->GetVistarClassType(sObjectClass);
+	Message.Trajectory = FVistarInlineString(sAttachedTrajectoryName);
+	Message.bHasLocation = true;
+	Message.Lon = location.X;
+	Message.Lat = location.Y;
+	Message.Alt = location.Z;
+	Message.bHasRotation = true;
+	Message.Yaw = rotation.Yaw;
+	Message.Pitch = rotation.Pitch;
+	Message.Roll = rotation.Roll;
+
+	// Encoded and queued for the sender thread, the game thread never touches the socket
+	VistarGI->SendEntity(Message, sObjectClass);
 }
\ No newline at end of file
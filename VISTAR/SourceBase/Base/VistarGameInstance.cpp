@@ -3,6 +3,14 @@
 
 #include "VistarGameInstance.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/MemStack.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "../Network/VistarJsonWriter.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
 
 void UVistarGameInstance::Init()
 {
@@ -12,7 +20,21 @@ void UVistarGameInstance::Init()
     _m_listVistarBaseActors.Empty();
     _m_bRecordRefLatLongAlt = false;
     //PopulateActorMap();
+    _m_pIngestPipeline = MakeUnique<FVistarIngestPipeline>(NetworkConfig);
     InitializeNetworkSendRecv();
+    StartAdditionalSources();
+    if (NetworkConfig.bRelayMode || FParse::Param(FCommandLine::Get(), TEXT("VistarRelay")) || IsRunningDedicatedServer()) {
+        _m_pRelay = MakeUnique<FVistarRelay>(NetworkConfig);
+        if (!_m_pRelay->Start()) {
+            _m_pRelay.Reset();
+        }
+    }
+    _m_hIngestTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UVistarGameInstance::TickIngest));
+    _m_hEndFrame = FCoreDelegates::OnEndFrame.AddUObject(this, &UVistarGameInstance::OnEndFrame);
+    _m_CoalescingTable.SetDropStale(NetworkConfig.bDropStaleUpdates);
+    for (EVistarClassType eClass : NetworkConfig.HiddenClasses) {
+        _m_Layers.SetClassVisible(eClass, false);
+    }
 
     //FVector3d Vec1 = LlaToUnreal(13.0, 77, 0,
     //    13, 77, 0);
@@ -29,12 +51,26 @@ void UVistarGameInstance::Init()
 
 void UVistarGameInstance::Shutdown()
 {
+    FTSTicker::GetCoreTicker().RemoveTicker(_m_hIngestTicker);
+    FCoreDelegates::OnEndFrame.Remove(_m_hEndFrame);
+    _m_NetStats.CloseCsv();
+    FlushOutbound();
+    // Drains and joins the sender thread while the socket still exists
+    _m_pSender.Reset();
+    _m_pRelay.Reset();
+    _m_DeltaEncoder.Reset();
+    _m_DeltaState.Reset();
+    _m_Leases.Reset();
+
     if (UdpCommunicator)
     {
         UdpCommunicator->Shutdown();
         delete UdpCommunicator;
         UdpCommunicator = nullptr;
     }
+    _m_arrPipelines.Reset();
+    _m_arrExtraSources.Reset();
+    _m_pIngestPipeline.Reset();
 
     Super::Shutdown();
 }
@@ -64,10 +100,24 @@ void UVistarGameInstance::InitializeNetworkSendRecv() {
 
     UdpCommunicator = new FUdpCommunicator();
 
-    FOnUdpDataReceived Callback;
-    Callback.BindUObject(this, &UVistarGameInstance::ReceiveMessage);
+    _m_IngestCallback.BindRaw(_m_pIngestPipeline.Get(), &FVistarIngestPipeline::HandleDatagram);
 
-    bool bStarted = UdpCommunicator->StartReceiver(8888, Callback);  // Example port
+    bool bStarted = false;
+    if (!NetworkConfig.ReplayFilePath.IsEmpty()) {
+        // Offline run, the capture stands in for the simulator
+        bStarted = UdpCommunicator->StartReplay(NetworkConfig.ReplayFilePath, _m_IngestCallback, NetworkConfig);
+    }
+    else {
+        if (NetworkConfig.Transport == EVistarTransport::SharedMemory) {
+            bStarted = UdpCommunicator->StartSharedMemoryReceiver(_m_IngestCallback, NetworkConfig);
+        }
+        else {
+            bStarted = UdpCommunicator->StartReceiver(NetworkConfig.ListenPort, _m_IngestCallback, NetworkConfig);
+        }
+        if (bStarted && !NetworkConfig.CaptureFilePath.IsEmpty()) {
+            UdpCommunicator->StartCapture(NetworkConfig.CaptureFilePath);
+        }
+    }
 
     if (!bStarted)
     {
@@ -77,22 +127,214 @@ void UVistarGameInstance::InitializeNetworkSendRecv() {
     }
     else
     {
-        bStarted = UdpCommunicator->StartSender("255.0.0.1", 7777);
+        bStarted = UdpCommunicator->StartSender(NetworkConfig.OutboundAddress, NetworkConfig.OutboundPort);
         if (!bStarted)
         {
             UE_LOG(LogTemp, Warning, TEXT("Failed to start UDP Sender!"));
         }
+        else
+        {
+            _m_pSender = MakeUnique<FVistarSender>(UdpCommunicator, NetworkConfig);
+            _m_DeltaEncoder.SetRefreshSeconds(NetworkConfig.DeltaRefreshSeconds);
+        }
         UE_LOG(LogTemp, Log, TEXT("UDP receiver started successfully."));
     }
 }
 
-void UVistarGameInstance::SendMessage(const FString& Message)
+void UVistarGameInstance::StartAdditionalSources()
+{
+    _m_arrPipelines.Add(_m_pIngestPipeline.Get());
+
+    for (const FVistarIngestSourceConfig& SourceConfig : NetworkConfig.AdditionalSources) {
+        TUniquePtr<FVistarIngestSource> Source = MakeUnique<FVistarIngestSource>(SourceConfig, NetworkConfig);
+        if (!Source->Start()) {
+            continue;
+        }
+        _m_arrPipelines.Add(&Source->GetPipeline());
+        _m_arrExtraSources.Add(MoveTemp(Source));
+    }
+
+    _m_arrPipelineMessages.Init(0, _m_arrPipelines.Num());
+    _m_arrIngestSourceStats.SetNum(_m_arrPipelines.Num());
+    _m_arrIngestSourceStats[0].Name = TEXT("primary");
+    for (int32 nSource = 0; nSource < _m_arrExtraSources.Num(); ++nSource) {
+        _m_arrIngestSourceStats[nSource + 1].Name = _m_arrExtraSources[nSource]->GetName();
+    }
+}
+
+void UVistarGameInstance::UpdateIngestSourceStats(double dNow)
+{
+    const double dElapsed = dNow - _m_dLastSourceStats;
+    if (dElapsed < 1.0) {
+        return;
+    }
+    _m_dLastSourceStats = dNow;
+
+    for (int32 nSource = 0; nSource < _m_arrIngestSourceStats.Num(); ++nSource) {
+        FVistarIngestSourceStats& Stats = _m_arrIngestSourceStats[nSource];
+        const FUdpCommunicator* pCommunicator = nSource == 0 ? UdpCommunicator : &_m_arrExtraSources[nSource - 1]->GetCommunicator();
+        FVistarIngestPipeline* pPipeline = _m_arrPipelines[nSource];
+
+        const uint64 nDatagrams = pCommunicator ? pCommunicator->GetReceivedCount() : 0;
+        Stats.DatagramRate = (nDatagrams - Stats.Datagrams) / dElapsed;
+        Stats.MessageRate = (_m_arrPipelineMessages[nSource] - Stats.Messages) / dElapsed;
+        Stats.Datagrams = nDatagrams;
+        Stats.Bytes = pCommunicator ? pCommunicator->GetReceivedBytes() : 0;
+        Stats.Messages = _m_arrPipelineMessages[nSource];
+        Stats.ParseFailures = pPipeline->GetMalformedCount();
+        Stats.QueueDepth = 0;
+        for (int32 nQueue = 0; nQueue < pPipeline->GetNumQueues(); ++nQueue) {
+            Stats.QueueDepth += pPipeline->GetQueue(nQueue).Num();
+        }
+    }
+}
+
+void UVistarGameInstance::StartCapture(const FString& Path)
+{
+    if (UdpCommunicator) {
+        UdpCommunicator->StartCapture(Path.IsEmpty() ? FString::Printf(TEXT("Vistar-%s.vcap"), *FDateTime::Now().ToString()) : Path);
+    }
+}
+
+void UVistarGameInstance::StopCapture()
+{
+    if (UdpCommunicator) {
+        UdpCommunicator->StopCapture();
+    }
+}
+
+void UVistarGameInstance::StartReplay(const FString& Path, float Speed)
+{
+    if (!UdpCommunicator) {
+        return;
+    }
+    FVistarNetworkConfig ReplayConfig = NetworkConfig;
+    ReplayConfig.ReplaySpeed = Speed;
+    UdpCommunicator->StartReplay(Path, _m_IngestCallback, ReplayConfig);
+}
+
+void UVistarGameInstance::StopReplay()
 {
     if (UdpCommunicator) {
-        UdpCommunicator->SendMessage(Message);
+        UdpCommunicator->StopReplay();
+    }
+}
+
+void UVistarGameInstance::SeekReplay(float Seconds)
+{
+    if (UdpCommunicator && UdpCommunicator->GetReplayer()) {
+        UdpCommunicator->GetReplayer()->Seek(Seconds);
+    }
+}
+
+void UVistarGameInstance::SetReplaySpeed(float Speed)
+{
+    if (UdpCommunicator && UdpCommunicator->GetReplayer()) {
+        UdpCommunicator->GetReplayer()->SetSpeed(Speed);
+    }
+}
+
+void UVistarGameInstance::SendMessage(const FString& Message)
+{
+    if (_m_pSender) {
+        FTCHARToUTF8 Utf8(*Message);
+        TArray<uint8> Buffer = _m_pSender->AcquireBuffer();
+        Buffer.Append((const uint8*)Utf8.Get(), Utf8.Length());
+        _m_pSender->Send(MoveTemp(Buffer));
+    }
+}
+
+void UVistarGameInstance::SendBytes(const TArray<uint8>& Data)
+{
+    if (_m_pSender) {
+        TArray<uint8> Buffer = _m_pSender->AcquireBuffer();
+        Buffer.Append(Data);
+        _m_pSender->Send(MoveTemp(Buffer));
+    }
+}
+
+void UVistarGameInstance::SendEntity(const FVistarEntityUpdate& Message, const FString& ClassName)
+{
+    if (!_m_pSender) {
+        return;
+    }
+
+    const bool bState = Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update;
+    if (!NetworkConfig.bSendDeltas || !bState) {
+        if (Message.Stream == EVistarStream::Delete) {
+            _m_DeltaEncoder.Forget(Message.Id);
+        }
+
+        // Encoded straight into a pooled buffer, no FJsonObject or FString on the way
+        TArray<uint8> Buffer = _m_pSender->AcquireBuffer();
+        if (UsesBinaryWireFormat()) {
+            FVistarBinaryCodec::EncodeEntity(Message, GetBinaryOptions(), Buffer);
+        }
+        else {
+            FVistarJsonWriter::WriteEntity(Message, Buffer, &ClassName);
+        }
+        _m_pSender->Send(MoveTemp(Buffer), &Message.Id, Message.Stream);
+        return;
+    }
+
+    FVistarEntityUpdate Delta = Message;
+    const EVistarDeltaSend eSend = _m_DeltaEncoder.Reduce(Delta, FPlatformTime::Seconds());
+    if (eSend == EVistarDeltaSend::None) {
+        return;
+    }
+    const bool bFull = eSend == EVistarDeltaSend::Full;
+
+    TArray<uint8> Buffer = _m_pSender->AcquireBuffer();
+    if (UsesBinaryWireFormat()) {
+        if (bFull) {
+            FVistarBinaryCodec::EncodeEntity(Delta, GetBinaryOptions(), Buffer);
+        }
+        else {
+            FVistarBinaryCodec::EncodeDelta(Delta, GetBinaryOptions(), Buffer);
+        }
+    }
+    else {
+        // JSON has no per component presence, a changed field goes out whole
+        FVistarDeltaEncoder::ExpandToFields(Delta);
+        FVistarJsonWriter::WriteEntity(Delta, Buffer, &ClassName);
+    }
+
+    // Never coalesced, a delta dropped for a newer one would lose the components only it carried
+    _m_pSender->Send(MoveTemp(Buffer), bFull ? &Message.Id : nullptr, Delta.Stream);
+}
+
+void UVistarGameInstance::SendControl(EVistarControl Control)
+{
+    if (!_m_pSender) {
+        return;
+    }
+
+    TArray<uint8> Buffer = _m_pSender->AcquireBuffer();
+    if (UsesBinaryWireFormat()) {
+        FVistarBinaryCodec::EncodeControl(Control, Buffer);
+    }
+    else {
+        FVistarJsonWriter::WriteControl(Control, Buffer);
+    }
+    _m_pSender->Send(MoveTemp(Buffer));
+    FlushOutbound();
+}
+
+void UVistarGameInstance::FlushOutbound()
+{
+    if (_m_pSender) {
+        _m_pSender->Flush();
     }
 }
 
+FVistarBinaryCodec::FOptions UVistarGameInstance::GetBinaryOptions() const
+{
+    FVistarBinaryCodec::FOptions Options;
+    Options.bQuantizePosition = NetworkConfig.bQuantizeBinaryPositions;
+    Options.bQuantizeAngles = NetworkConfig.bQuantizeBinaryAngles;
+    return Options;
+}
+
 
 FVector3d UVistarGameInstance::LlaToUnreal(double lat, double lon, double alt,
     double refLat, double refLon, double refAlt)
@@ -141,106 +383,777 @@ FVector3d UVistarGameInstance::LlaToUnreal(double lat, double lon, double alt,
     );
 }
 
-void UVistarGameInstance::ReceiveMessage(const TSharedPtr<FJsonObject>& JsonObject)
+bool UVistarGameInstance::TickIngest(float DeltaTime)
 {
-    FString sStream = JsonObject->GetStringField("STREAM");
-    FString sId = JsonObject->GetStringField("ID");
-    FString sClass = JsonObject->GetStringField("CLASS");
-    if (sClass.Equals("route")) {
+    TRACE_CPUPROFILER_EVENT_SCOPE(UVistarGameInstance::TickIngest);
+
+    // Whatever the frame queued for sending goes out in as few datagrams as possible
+    FlushOutbound();
+
+    if (!_m_pIngestPipeline) {
+        return true;
+    }
+
+    LLM_SCOPE_BYTAG(VistarIngest);
+
+    // Per-frame arena for the decoded messages, released in one step when Mark goes out of scope
+    FMemMark Mark(FMemStack::Get());
+    TArray<FVistarEntityUpdate, TMemStackAllocator<>> arrFrameEvents;
+    TArray<FVistarEntityUpdate, TMemStackAllocator<>> arrFrameUpdates;
+
+    FVistarIngestFrameStats Stats;
+    const uint64 nCollapsedBefore = _m_CoalescingTable.GetCollapsedCount();
+    const uint64 nStaleBefore = GetTotalStaleUpdates();
+    const SIZE_T nTableBytesBefore = _m_CoalescingTable.GetAllocatedSize() + _m_mapLastApplied.GetAllocatedSize();
+
+    const double dNow = FPlatformTime::Seconds();
+
+    // Keyframes first, the changes queued behind them apply on top
+    TArray<FVistarEntityUpdate> arrKeyframe;
+    for (int32 nPipeline = 0; nPipeline < _m_arrPipelines.Num(); ++nPipeline) {
+        if (_m_arrPipelines[nPipeline]->TakeKeyframe(arrKeyframe)) {
+            for (const FVistarEntityUpdate& Entry : arrKeyframe) {
+                _m_Leases.Renew(Entry.Id, nPipeline, dNow);
+            }
+            Stats.KeyframeEntities += ApplyKeyframe(arrKeyframe);
+        }
+    }
+
+    // Only take what is queued now, anything the receiver adds meanwhile waits for the next frame.
+    // One queue per decode worker of each source, each entity only ever appears in one of them. Control
+    // lanes go first so a burst of updates cannot hold back an event
+    FVistarEntityUpdate Message;
+    uint32 nQueueDepth = 0;
+    for (EVistarLane eLane : { EVistarLane::Control, EVistarLane::Bulk }) {
+        for (int32 nPipeline = 0; nPipeline < _m_arrPipelines.Num(); ++nPipeline) {
+            FVistarIngestPipeline* pPipeline = _m_arrPipelines[nPipeline];
+            for (int32 nQueue = 0; nQueue < pPipeline->GetNumQueues(); ++nQueue) {
+                FVistarIngestQueue& IngestQueue = pPipeline->GetQueue(nQueue);
+                const uint32 nLaneDepth = IngestQueue.Num(eLane);
+                nQueueDepth += nLaneDepth;
+                _m_arrPipelineMessages[nPipeline] += nLaneDepth;
+                if (eLane == EVistarLane::Control) {
+                    Stats.ControlDepth += nLaneDepth;
+                }
+                for (uint32 nPending = nLaneDepth; nPending > 0 && IngestQueue.Pop(eLane, Message); --nPending) {
+                    ++Stats.Drained;
+                    if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update) {
+                        _m_Leases.Renew(Message.Id, nPipeline, dNow);
+                    }
+                    else if (Message.Stream == EVistarStream::Delete) {
+                        _m_Leases.Forget(Message.Id);
+                    }
+                    if (Message.Stream == EVistarStream::Create) {
+                        _m_Layers.NoteEntity(Message.Id, Message.Class, Message.ParentId);
+                    }
+                    // Hidden layers keep the latest state and skip everything below
+                    const bool bHidden = _m_Layers.AnyHidden() && _m_Layers.Absorb(Message);
+                    if (Message.Stream == EVistarStream::Delete) {
+                        _m_Layers.ForgetEntity(Message.Id);
+                    }
+                    if (bHidden) {
+                        ++Stats.UpdatesHidden;
+                        continue;
+                    }
+                    if (Message.IsEvent()) {
+                        arrFrameEvents.Add(MoveTemp(Message));
+                    }
+                    else {
+                        _m_CoalescingTable.Add(MoveTemp(Message));
+                    }
+                }
+            }
+        }
+    }
+
+    // Events pass through untouched and in order
+    for (const FVistarEntityUpdate& Event : arrFrameEvents) {
+        ReceiveMessage(Event);
+        if (Event.Stream == EVistarStream::Delete) {
+            // A pending update must not respawn a deleted entity
+            _m_CoalescingTable.Remove(Event.Id);
+            _m_mapLastApplied.Remove(Event.Id);
+            _m_mapRecentDeletes.Add(Event.Id, dNow);
+        }
+        else if (Event.Stream == EVistarStream::Create) {
+            _m_mapRecentDeletes.Remove(Event.Id);
+            AcceptSequenced(Event);
+        }
+    }
+    ResolveDeferredAttach();
+    Stats.Events = arrFrameEvents.Num();
+
+    _m_CoalescingTable.Flush(arrFrameUpdates, NetworkConfig.MaxUpdatesPerFrame);
+    for (FVistarEntityUpdate& Update : arrFrameUpdates) {
+        // A reordered datagram that arrived a frame late would move the entity backwards
+        if (AcceptAfterDelete(Update, dNow) && AcceptSequenced(Update)) {
+            ReceiveMessage(Update);
+            ++Stats.UpdatesApplied;
+        }
+        else {
+            Update.Stream = EVistarStream::None;
+        }
+    }
+
+    // Whole swarms after the frame's events, so a swarm created this frame is in place first
+    for (int32 nPipeline = 0; nPipeline < _m_arrPipelines.Num(); ++nPipeline) {
+        if (_m_arrPipelines[nPipeline]->TakeSwarms(_m_arrSwarms)) {
+            for (const FVistarSwarmUpdate& Swarm : _m_arrSwarms) {
+                _m_Leases.Renew(Swarm.Reference.Id, nPipeline, dNow);
+                Stats.SwarmMembers += ApplySwarm(Swarm, dNow);
+            }
+            _m_arrSwarms.Reset();
+        }
+    }
+
+    // Heartbeats after everything that renews on its own, then a slice of the leases
+    for (int32 nPipeline = 0; nPipeline < _m_arrPipelines.Num(); ++nPipeline) {
+        if (_m_arrPipelines[nPipeline]->TakeHeartbeats(_m_arrHeartbeats)) {
+            for (const FVistarHeartbeat& Heartbeat : _m_arrHeartbeats) {
+                _m_Leases.ApplyHeartbeat(Heartbeat, nPipeline, dNow);
+            }
+            _m_arrHeartbeats.Reset();
+        }
+    }
+    Stats.EntitiesExpired = RetireExpired(dNow);
+
+    // One timestamp for the frame, the apply loops above are short next to the latencies measured
+    const int64 nNowUs = FVistarSequence::GetLocalTimeUs();
+    for (const FVistarEntityUpdate& Event : arrFrameEvents) {
+        RecordApplied(Event, nNowUs);
+    }
+    for (const FVistarEntityUpdate& Update : arrFrameUpdates) {
+        RecordApplied(Update, nNowUs);
+    }
+
+    // The relay publishes at its own rate, whatever was applied since goes out together
+    if (_m_pRelay) {
+        _m_pRelay->Tick(dNow);
+    }
+
+    Stats.UpdatesCollapsed = static_cast<int32>(_m_CoalescingTable.GetCollapsedCount() - nCollapsedBefore);
+    Stats.UpdatesDeferred = _m_CoalescingTable.Num();
+    Stats.UpdatesStale = static_cast<int32>(GetTotalStaleUpdates() - nStaleBefore);
+
+    const uint64 nAllocTotal = GetIngestAllocStats().Total();
+    Stats.HeapAllocations = static_cast<int32>(nAllocTotal - _m_nLastAllocTotal);
+    _m_nLastAllocTotal = nAllocTotal;
+    const SIZE_T nTableBytes = _m_CoalescingTable.GetAllocatedSize() + _m_mapLastApplied.GetAllocatedSize();
+    Stats.TableBytesGrown = static_cast<int32>(FMath::Max<int64>(0, (int64)nTableBytes - (int64)nTableBytesBefore));
+    _m_LastIngestStats = Stats;
+
+    UE_LOG(LogTemp, Verbose, TEXT("VistarIngest: drained %d, events %d, applied %d, collapsed %d, deferred %d, stale %d, hidden %d, allocs %d"),
+        Stats.Drained, Stats.Events, Stats.UpdatesApplied, Stats.UpdatesCollapsed, Stats.UpdatesDeferred, Stats.UpdatesStale, Stats.UpdatesHidden,
+        Stats.HeapAllocations);
+
+    FVistarNetSample NetSample;
+    GatherNetSample(NetSample, nQueueDepth);
+    UpdateIngestSourceStats(dNow);
+    _m_NetStats.Tick(DeltaTime, NetSample, NetworkConfig, _m_arrIngestSourceStats);
+
+    if (NetworkConfig.bPublishInterest) {
+        PublishInterest(dNow);
+    }
+    return true;
+}
+
+void UVistarGameInstance::GatherNetSample(FVistarNetSample& OutSample, uint32 nQueueDepth)
+{
+    if (UdpCommunicator) {
+        OutSample.Datagrams = UdpCommunicator->GetReceivedCount();
+        OutSample.Bytes = UdpCommunicator->GetReceivedBytes();
+        OutSample.Truncated = UdpCommunicator->GetTruncatedCount();
+        OutSample.SocketDrops = UdpCommunicator->GetSocketDropCount();
+    }
+
+    for (const TUniquePtr<FVistarIngestSource>& Source : _m_arrExtraSources) {
+        const FUdpCommunicator& Communicator = Source->GetCommunicator();
+        OutSample.Datagrams += Communicator.GetReceivedCount();
+        OutSample.Bytes += Communicator.GetReceivedBytes();
+        OutSample.Truncated += Communicator.GetTruncatedCount();
+        OutSample.SocketDrops += Communicator.GetSocketDropCount();
+    }
+
+    for (FVistarIngestPipeline* pPipeline : _m_arrPipelines) {
+        OutSample.ParseFailures += pPipeline->GetMalformedCount();
+        pPipeline->GetSourceStats(_m_arrSourceStats);
+        for (const FVistarSourceStats& Source : _m_arrSourceStats) {
+            OutSample.Lost += Source.Lost;
+            OutSample.Reordered += Source.Reordered;
+        }
+    }
+
+    OutSample.Coalesced = _m_CoalescingTable.GetCollapsedCount();
+    OutSample.Stale = GetTotalStaleUpdates();
+    OutSample.Spawned = _m_nSpawned;
+    OutSample.Destroyed = _m_nDestroyed;
+    FMemory::Memcpy(OutSample.ClassMessages, _m_arrClassMessages, sizeof(_m_arrClassMessages));
+
+    const FVistarInterestReport Interest = _m_pIngestPipeline->GetInterestReport();
+    OutSample.InterestPassed = Interest.Passed;
+    OutSample.InterestSuppressed = Interest.Suppressed;
+    OutSample.InterestSuppressedBytes = Interest.SuppressedBytes;
+
+    OutSample.QueueDepth = nQueueDepth;
+    OutSample.Entities = _m_pRelay ? _m_pRelay->GetNumEntities() : _m_listVistarBaseActors.Num();
+    OutSample.ReceiveToApplyP95Ms = _m_ReceiveToApply.GetPercentile(0.95);
+    OutSample.ControlReceiveToApplyP95Ms = _m_ControlReceiveToApply.GetPercentile(0.95);
+    OutSample.SendToRenderP95Ms = _m_SendToRender.GetPercentile(0.95);
+}
+
+void UVistarGameInstance::UnrealToLla(const FVector3d& Location, double& OutLat, double& OutLon, double& OutAlt) const
+{
+    // ReceiveMessage passes (lon, lat) to LlaToUnreal, so X runs along latitude and Y along longitude.
+    // First order inverse, good to a few meters over the size of an interest area
+    const double a = 6378137.0;
+    const double dEast = Location.X / 100.0;
+    const double dNorth = Location.Y / 100.0;
+    OutLat = _m_dRefLat + FMath::RadiansToDegrees(dEast / (a * FMath::Cos(FMath::DegreesToRadians(_m_dRefLon))));
+    OutLon = _m_dRefLon + FMath::RadiansToDegrees(dNorth / a);
+    OutAlt = _m_dRefAlt + (Location.Z + 5250.0) / 100.0;
+}
+
+void UVistarGameInstance::PublishInterest(double dNow)
+{
+    // No reference point before the first entity, and nothing to filter yet either
+    if (!UdpCommunicator || !_m_bRecordRefLatLongAlt) {
+        return;
+    }
+    APlayerController* pController = GetFirstLocalPlayerController();
+    if (!pController || !pController->PlayerCameraManager) {
         return;
     }
 
-    ABaseActor* baseActor = getVistarObjectById(sId);
+    const FVector3d vCamera = pController->PlayerCameraManager->GetCameraLocation();
+    const FVector3d vForward = pController->PlayerCameraManager->GetCameraRotation().Vector();
+    const double dMaxDistance = NetworkConfig.InterestMaxRadiusMeters * 100.0;
+
+    // Centre on where the view hits the ground, the camera itself when looking at the horizon
+    const double dGroundZ = -_m_dRefAlt * 100.0 - 5250.0;
+    FVector3d vCenter = vCamera;
+    double dDistance = FMath::Max(vCamera.Z - dGroundZ, 0.0);
+    if (vForward.Z < -0.05) {
+        dDistance = FMath::Min((dGroundZ - vCamera.Z) / vForward.Z, dMaxDistance);
+        vCenter = vCamera + vForward * dDistance;
+    }
+
+    // Generous, the footprint of a tilted view is longer than it is wide
+    const double dHalfFov = FMath::DegreesToRadians(pController->PlayerCameraManager->GetFOVAngle() * 0.5);
+    const float fRadius = FMath::Clamp(static_cast<float>(dDistance / 100.0 * FMath::Tan(dHalfFov) * 2.0),
+        NetworkConfig.InterestMinRadiusMeters, FMath::Max(NetworkConfig.InterestMinRadiusMeters, NetworkConfig.InterestMaxRadiusMeters));
+
+    FVistarInterestArea Area;
+    Area.ViewerId = NetworkConfig.InterestViewerId > 0 ? static_cast<uint32>(NetworkConfig.InterestViewerId) : FPlatformProcess::GetCurrentProcessId();
+    double dAlt;
+    UnrealToLla(vCenter, Area.Lat, Area.Lon, dAlt);
+    Area.RadiusMeters = fRadius;
+    Area.OutsideRateHz = NetworkConfig.InterestOutsideRateHz;
+    for (EVistarClassType eClass : NetworkConfig.InterestClasses) {
+        Area.ClassMask |= 1u << static_cast<uint32>(eClass);
+    }
+
+    // Between periodic messages only a real change of view is worth one
+    const bool bDue = dNow - _m_dLastInterestPublish >= NetworkConfig.InterestPublishSeconds;
+    FVistarInterestArea QuarterArea = _m_LastInterest;
+    QuarterArea.RadiusMeters *= 0.25f;
+    const bool bMoved = !QuarterArea.Contains(Area.Lat, Area.Lon)
+        || FMath::Abs(Area.RadiusMeters - _m_LastInterest.RadiusMeters) > 0.25f * _m_LastInterest.RadiusMeters;
+    if (!bDue && !bMoved) {
+        return;
+    }
+
+    // Straight out as its own datagram, never bundled or sequenced, a filter reads it without our pipeline
+    TArray<uint8> arrBuffer;
+    FVistarInterest::WriteArea(Area, arrBuffer);
+    UdpCommunicator->SendBytes(arrBuffer.GetData(), arrBuffer.Num());
+    _m_LastInterest = Area;
+    _m_dLastInterestPublish = dNow;
+}
+
+FVistarInterestReport UVistarGameInstance::GetInterestReport() const
+{
+    return _m_pIngestPipeline ? _m_pIngestPipeline->GetInterestReport() : FVistarInterestReport();
+}
+
+bool UVistarGameInstance::AcceptAfterDelete(const FVistarEntityUpdate& Message, double dNow)
+{
+    if (_m_mapRecentDeletes.Num() == 0) {
+        return true;
+    }
+
+    // Entities deleted long ago are forgotten once a second, the map only holds recent churn
+    if (dNow - _m_dLastDeletePurge >= 1.0) {
+        _m_dLastDeletePurge = dNow;
+        for (auto It = _m_mapRecentDeletes.CreateIterator(); It; ++It) {
+            if (dNow - It.Value() >= NetworkConfig.DeleteHoldSeconds) {
+                It.RemoveCurrent();
+            }
+        }
+    }
+
+    const double* pDeletedAt = _m_mapRecentDeletes.Find(Message.Id);
+    if (pDeletedAt && dNow - *pDeletedAt < NetworkConfig.DeleteHoldSeconds) {
+        ++_m_nStaleApplied;
+        return false;
+    }
+    return true;
+}
+
+bool UVistarGameInstance::AcceptSequenced(const FVistarEntityUpdate& Message)
+{
+    if (!Message.Meta.bHasSequence) {
+        return true;
+    }
+
+    FVistarDatagramMeta& Last = _m_mapLastApplied.FindOrAdd(Message.Id, Message.Meta);
+    if (NetworkConfig.bDropStaleUpdates && FVistarCoalescingTable::IsStale(Message.Meta, Last)) {
+        ++_m_nStaleApplied;
+        return false;
+    }
+    Last = Message.Meta;
+    return true;
+}
+
+void UVistarGameInstance::RecordApplied(const FVistarEntityUpdate& Message, int64 nNowUs)
+{
+    // Dropped as stale, never applied
+    if (Message.Stream == EVistarStream::None) {
+        return;
+    }
+    ++_m_arrClassMessages[FMath::Min(static_cast<int32>(Message.Class), VistarClassCount - 1)];
+    if (Message.Meta.ReceiveTimeUs != 0) {
+        const double dMs = (nNowUs - Message.Meta.ReceiveTimeUs) / 1000.0;
+        _m_ReceiveToApply.Add(dMs);
+        if (VistarLaneOf(Message.Stream) == EVistarLane::Control) {
+            _m_ControlReceiveToApply.Add(dMs);
+        }
+    }
+    if (Message.Meta.SendTimeLocalUs != 0) {
+        _m_arrPendingRenderSamples.Add(Message.Meta.SendTimeLocalUs);
+    }
+}
+
+void UVistarGameInstance::OnEndFrame()
+{
+    if (_m_arrPendingRenderSamples.Num() > 0) {
+        const int64 nNowUs = FVistarSequence::GetLocalTimeUs();
+        for (int64 nSendUs : _m_arrPendingRenderSamples) {
+            _m_SendToRender.Add((nNowUs - nSendUs) / 1000.0);
+        }
+        _m_arrPendingRenderSamples.Reset();
+    }
+
+    // Running summary, the histograms keep accumulating until ResetLatencyHistograms
+    const double dNow = FPlatformTime::Seconds();
+    if (dNow - _m_dLastLatencyLog >= 10.0 && _m_ReceiveToApply.GetCount() > 0) {
+        _m_dLastLatencyLog = dNow;
+        UE_LOG(LogTemp, Log, TEXT("VistarIngest: receive->apply ms %s"), *_m_ReceiveToApply.ToString());
+        if (_m_ControlReceiveToApply.GetCount() > 0) {
+            // Control events should land within the frame they arrived in
+            UE_LOG(LogTemp, Log, TEXT("VistarIngest: control lane receive->apply ms %s, frame %.1f ms"),
+                *_m_ControlReceiveToApply.ToString(), FApp::GetDeltaTime() * 1000.0);
+        }
+        if (_m_SendToRender.GetCount() > 0) {
+            UE_LOG(LogTemp, Log, TEXT("VistarIngest: send->render ms %s"), *_m_SendToRender.ToString());
+        }
+    }
+}
+
+void UVistarGameInstance::ResetLatencyHistograms()
+{
+    _m_ReceiveToApply.Reset();
+    _m_ControlReceiveToApply.Reset();
+    _m_SendToRender.Reset();
+}
+
+void UVistarGameInstance::ReceiveMessage(const FVistarEntityUpdate& Message)
+{
+    if (Message.Class == EVistarClassType::VISTAR_TYPE_ROUTE) {
+        return;
+    }
+
+    // A delta is completed from the entity's last state, everything below sees whole fields. One that
+    // cannot be completed waits for the next full refresh or keyframe, it would spawn a classless actor
+    if (Message.DeltaMask != 0) {
+        FVistarEntityUpdate Resolved = Message;
+        if (_m_DeltaState.Resolve(Resolved)) {
+            ReceiveMessage(Resolved);
+        }
+        else {
+            UE_LOG(LogTemp, Verbose, TEXT("VistarIngest: delta for %s without known state dropped, %llu in total"),
+                *Message.Id.ToString(), _m_DeltaState.GetUnresolvedCount());
+        }
+        return;
+    }
+    if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update) {
+        _m_DeltaState.Record(Message);
+    }
+    else if (Message.Stream == EVistarStream::Delete) {
+        _m_DeltaState.Forget(Message.Id);
+        // Members are entities of their own that no sender deletes once their swarm is gone
+        DeleteSwarmMembers(Message.Id);
+    }
+
+    // A relay converts once for every display node and spawns nothing itself
+    if (_m_pRelay) {
+        FVistarLocalPose Pose;
+        if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update) {
+            ResolvePose(Message, Pose);
+        }
+        _m_pRelay->Apply(Message, Pose);
+        return;
+    }
+
+    ABaseActor* baseActor = getVistarObjectById(Message.Id);
     if (IsValid(baseActor)) {
-        if (sStream.Equals("create") || sStream.Equals("update")) {
-            UpdateVistarObject(JsonObject, baseActor, true);
+        if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update) {
+            UpdateVistarObject(Message, baseActor, true);
         }
-        else if (sStream.Equals("delete")) {
-            AsyncTask(ENamedThreads::GameThread, [this, sId,baseActor]()
-                {
-                    _m_listVistarBaseActors.Remove(sId);
-                    baseActor->Reset();
-                    baseActor->Destroy();
-                });
+        else if (Message.Stream == EVistarStream::Delete) {
+            _m_listVistarBaseActors.Remove(Message.Id);
+            baseActor->Reset();
+            baseActor->Destroy();
+            ++_m_nDestroyed;
         }
         else {
-            FString sAction = JsonObject->GetStringField("ACTION");
-            baseActor->ProcessAction(sAction);
+            baseActor->ProcessAction(Message.Action.ToString());
         }
     }
-    else {
-        AsyncTask(ENamedThreads::GameThread, [this, sId, sClass, sStream,JsonObject]()
-            {
-                ABaseActor* newActor = createNewVistarObject(sId, sClass);
-                if (newActor) {
-                    bool bRefresh = true;
-                    if (sStream.Equals("create")) {
-                        FString ParentId = JsonObject->GetStringField("PARENT");
-                        int childId = JsonObject->GetNumberField("CHILD_ID");
-                        newActor->setParentInfo(ParentId, childId);
-                        if (!ParentId.IsEmpty()) {
-                            ABaseActor* parentActor = getVistarObjectById(ParentId);
-                            if (parentActor) {
-                                newActor->setParentInfo(ParentId, childId);
-                                FString sSocketId = FString::Printf(TEXT("Child_%d"), childId);
-                                parentActor->attachChildtoSocket(newActor, sSocketId);
-                            }
-                            
-                            bRefresh = false;
-                        }
+    else if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update) {
+        ABaseActor* newActor = createNewVistarObject(Message.Id, Message.Class);
+        if (newActor) {
+            bool bRefresh = true;
+            if (Message.Stream == EVistarStream::Create) {
+                FString ParentId = Message.ParentId.ToString();
+                newActor->setParentInfo(ParentId, Message.ChildId);
+                if (!Message.ParentId.IsEmpty()) {
+                    ABaseActor* parentActor = getVistarObjectById(Message.ParentId);
+                    if (parentActor) {
+                        newActor->setParentInfo(ParentId, Message.ChildId);
+                        FString sSocketId = FString::Printf(TEXT("Child_%d"), Message.ChildId);
+                        parentActor->attachChildtoSocket(newActor, sSocketId);
+                    }
+                    else {
+                        _m_arrDeferredAttach.Add({ Message.Id, Message.ParentId, Message.ChildId });
                     }
-                    UpdateVistarObject(JsonObject, newActor, bRefresh);
+
+                    bRefresh = false;
                 }
-            });
+            }
+            UpdateVistarObject(Message, newActor, bRefresh);
+        }
     }
 }
 
-void UVistarGameInstance::UpdateVistarObject(const TSharedPtr<FJsonObject>& JsonObject,ABaseActor* baseActor, bool bRefresh) {
+int32 UVistarGameInstance::ApplyKeyframe(TArray<FVistarEntityUpdate>& arrEntries)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UVistarGameInstance::ApplyKeyframe);
+    const double dNow = FPlatformTime::Seconds();
 
-    TSharedPtr<FJsonObject> jsonLocation = JsonObject->GetObjectField("LOCATION");
+    // Depth within the keyframe, parents are spawned before their children so every attach finds its parent
+    TMap<FVistarEntityId, int32> mapIndex;
+    mapIndex.Reserve(arrEntries.Num());
+    for (int32 i = 0; i < arrEntries.Num(); ++i) {
+        mapIndex.Add(arrEntries[i].Id, i);
+    }
+    TArray<TPair<int32, int32>> arrOrder;
+    arrOrder.Reserve(arrEntries.Num());
+    for (int32 i = 0; i < arrEntries.Num(); ++i) {
+        int32 nDepth = 0;
+        for (const int32* pParent = mapIndex.Find(arrEntries[i].ParentId); pParent && nDepth < 8; pParent = mapIndex.Find(arrEntries[*pParent].ParentId)) {
+            ++nDepth;
+        }
+        arrOrder.Emplace(nDepth, i);
+    }
+    arrOrder.StableSort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B) { return A.Key < B.Key; });
 
-    double dLon = static_cast<double>(FCString::Atof(*jsonLocation->GetStringField("X")));
-    double dLat = static_cast<double>(FCString::Atof(*jsonLocation->GetStringField("Y")));
-    double dAlt = static_cast<double>(FCString::Atof(*jsonLocation->GetStringField("Z")));
+    // Spawn pass
+    TArray<int32> arrApply;
+    arrApply.Reserve(arrEntries.Num());
+    int32 nSpawned = 0;
+    for (const TPair<int32, int32>& Order : arrOrder) {
+        FVistarEntityUpdate& Entry = arrEntries[Order.Value];
+        if (Entry.Class == EVistarClassType::VISTAR_TYPE_ROUTE || !AcceptAfterDelete(Entry, dNow) || !AcceptSequenced(Entry)) {
+            continue;
+        }
+        _m_Layers.NoteEntity(Entry.Id, Entry.Class, Entry.ParentId);
+        if (_m_Layers.AnyHidden() && _m_Layers.Absorb(Entry)) {
+            continue;
+        }
+        if (_m_pRelay) {
+            // The relay passes on creates for what its displays have not seen yet, state for the rest
+            Entry.Stream = _m_pRelay->HasEntity(Entry.Id) ? EVistarStream::Update : EVistarStream::Create;
+            ReceiveMessage(Entry);
+            continue;
+        }
+        if (!IsValid(getVistarObjectById(Entry.Id))) {
+            if (!createNewVistarObject(Entry.Id, Entry.Class)) {
+                continue;
+            }
+            ++nSpawned;
+        }
+        arrApply.Add(Order.Value);
+    }
 
-    if (!_m_bRecordRefLatLongAlt) {
-        _m_bRecordRefLatLongAlt = true;
-        _m_dRefLon = dLon;
-        _m_dRefLat = dLat;
-        _m_dRefAlt = 0;
+    // Attach pass, also repairs children whose create was lost
+    int32 nAttached = 0;
+    for (int32 nIndex : arrApply) {
+        const FVistarEntityUpdate& Entry = arrEntries[nIndex];
+        if (Entry.ParentId.IsEmpty()) {
+            continue;
+        }
+        ABaseActor* childActor = getVistarObjectById(Entry.Id);
+        ABaseActor* parentActor = getVistarObjectById(Entry.ParentId);
+        if (IsValid(childActor) && IsValid(parentActor) && childActor->GetAttachParentActor() != parentActor) {
+            childActor->setParentInfo(Entry.ParentId.ToString(), Entry.ChildId);
+            FString sSocketId = FString::Printf(TEXT("Child_%d"), Entry.ChildId);
+            parentActor->attachChildtoSocket(childActor, sSocketId);
+            ++nAttached;
+        }
     }
 
-    FVector3d vectorXYZ = LlaToUnreal(dLon, dLat, dAlt, _m_dRefLon, _m_dRefLat, _m_dRefAlt);
+    // State pass, children stay on their sockets
+    for (int32 nIndex : arrApply) {
+        const FVistarEntityUpdate& Entry = arrEntries[nIndex];
+        _m_DeltaState.Record(Entry);
+        UpdateVistarObject(Entry, getVistarObjectById(Entry.Id), Entry.ParentId.IsEmpty());
+    }
 
-    double X = vectorXYZ.X;
-    double Y = vectorXYZ.Y;
-    double Z = vectorXYZ.Z;
+    UE_LOG(LogTemp, Log, TEXT("VistarIngest: keyframe of %d entities, %d applied, %d spawned, %d attached"),
+        arrEntries.Num(), arrApply.Num(), nSpawned, nAttached);
+    return arrApply.Num();
+}
 
+int32 UVistarGameInstance::ApplySwarm(const FVistarSwarmUpdate& Swarm, double dNow)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UVistarGameInstance::ApplySwarm);
+    const FVistarEntityUpdate& Reference = Swarm.Reference;
+    if (!AcceptAfterDelete(Reference, dNow)) {
+        return 0;
+    }
 
-    TSharedPtr<FJsonObject> jsonRotation = JsonObject->GetObjectField("ROTATION");
+    // The one geodetic conversion of the message
+    FVistarLocalPose RefPose;
+    ResolvePose(Reference, RefPose);
 
-    double Yaw = static_cast<double>(FCString::Atof(*jsonRotation->GetStringField("YAW")));
-    double Pitch = static_cast<double>(FCString::Atof(*jsonRotation->GetStringField("PITCH")));
-    double Roll = static_cast<double>(FCString::Atof(*jsonRotation->GetStringField("ROLL")));
+    const bool bLayers = _m_Layers.AnyHidden();
+    if (_m_pRelay) {
+        _m_pRelay->Apply(Reference, RefPose);
+    }
+    else if (!(bLayers && _m_Layers.Absorb(Reference))) {
+        ABaseActor* swarmActor = getVistarObjectById(Reference.Id);
+        if (!IsValid(swarmActor)) {
+            swarmActor = createNewVistarObject(Reference.Id, Reference.Class);
+        }
+        if (swarmActor) {
+            swarmActor->UpdatePositionXYZ(RefPose.Location.X, RefPose.Location.Y, RefPose.Location.Z);
+            swarmActor->Refresh();
+        }
+    }
 
-    TSharedPtr<FJsonObject> jsonSlew = JsonObject->GetObjectField("SLEW");
+    TArray<TWeakObjectPtr<ABaseActor>>& arrMembers = _m_mapSwarmMembers.FindOrAdd(Reference.Id);
+    if (arrMembers.Num() < Swarm.FirstMember + Swarm.Num()) {
+        arrMembers.SetNum(Swarm.FirstMember + Swarm.Num());
+    }
 
-    double SlewAz = static_cast<double>(FCString::Atof(*jsonSlew->GetStringField("SLEW_AZ")));
-    double SlewElev = static_cast<double>(FCString::Atof(*jsonSlew->GetStringField("SLEW_ELEV")));
+    const bool bAttitudes = Swarm.Attitudes.Num() == Swarm.Num();
+    FVistarEntityUpdate Member;
+    Member.Stream = EVistarStream::Update;
+    Member.Class = Swarm.MemberClass;
+    Member.ParentId = Reference.Id;
+    int32 nApplied = 0;
+    for (int32 i = 0; i < Swarm.Num(); ++i) {
+        // Offsets are east/north/up meters, the local frame is east/north/up centimeters
+        const FVector3d Location = RefPose.Location + FVector3d(Swarm.Offsets[i]) * 100.0;
+        TWeakObjectPtr<ABaseActor>& Cached = arrMembers[Swarm.FirstMember + i];
+        ABaseActor* memberActor = Cached.Get();
 
-    if (IsValid(baseActor)) {
-        baseActor->UpdatePositionXYZ(X,Y,Z);
-        baseActor->UpdateRotationYPR(Yaw,Pitch,Roll);
-        baseActor->UpdateSlew(SlewAz, SlewElev);
-        if (bRefresh) {
-            baseActor->unsetParentInfo();
-            baseActor->Refresh();
+        // Relay and hidden layers take the member as a message, the common case never builds one
+        if (_m_pRelay || bLayers || !IsValid(memberActor)) {
+            FVistarSwarm::MakeMemberId(Reference.Id, Swarm.FirstMember + i, Member.Id);
+            FVistarLocalPose Pose;
+            Pose.bHasLocation = true;
+            Pose.Location = Location;
+            Pose.bHasRotation = bAttitudes;
+            Pose.Rotation = bAttitudes ? FVector3d(Swarm.Attitudes[i]) : FVector3d::ZeroVector;
+            if (_m_pRelay) {
+                _m_pRelay->Apply(Member, Pose);
+                ++nApplied;
+                continue;
+            }
+            if (bLayers) {
+                _m_Layers.NoteEntity(Member.Id, Member.Class, Reference.Id);
+                Member.bHasLocal = true;
+                Member.Local = Location;
+                Member.bHasRotation = bAttitudes;
+                Member.Yaw = Pose.Rotation.X;
+                Member.Pitch = Pose.Rotation.Y;
+                Member.Roll = Pose.Rotation.Z;
+                if (_m_Layers.Absorb(Member)) {
+                    continue;
+                }
+            }
+            if (!IsValid(memberActor)) {
+                memberActor = getVistarObjectById(Member.Id);
+                if (!IsValid(memberActor)) {
+                    memberActor = createNewVistarObject(Member.Id, Member.Class);
+                    _m_Layers.NoteEntity(Member.Id, Member.Class, Reference.Id);
+                }
+                Cached = memberActor;
+            }
+            if (!memberActor) {
+                continue;
+            }
+        }
+
+        memberActor->UpdatePositionXYZ(Location.X, Location.Y, Location.Z);
+        if (bAttitudes) {
+            memberActor->UpdateRotationYPR(Swarm.Attitudes[i].X, Swarm.Attitudes[i].Y, Swarm.Attitudes[i].Z);
         }
+        memberActor->Refresh();
+        ++nApplied;
     }
+    return nApplied;
 }
 
-ABaseActor* UVistarGameInstance::getVistarObjectById(FString sObjectId) {
-    if (ABaseActor** baseActorPtr = _m_listVistarBaseActors.Find(sObjectId)) {
+void UVistarGameInstance::DeleteSwarmMembers(const FVistarEntityId& Id)
+{
+    // Taken out first, the member deletes below come back through ReceiveMessage
+    TArray<TWeakObjectPtr<ABaseActor>> arrMembers;
+    if (!_m_mapSwarmMembers.RemoveAndCopyValue(Id, arrMembers)) {
+        return;
+    }
+
+    FVistarEntityUpdate Delete;
+    Delete.Stream = EVistarStream::Delete;
+    for (int32 i = 0; i < arrMembers.Num(); ++i) {
+        if (FVistarSwarm::MakeMemberId(Id, i, Delete.Id)) {
+            ReceiveMessage(Delete);
+            _m_Layers.ForgetEntity(Delete.Id);
+        }
+    }
+}
+
+int32 UVistarGameInstance::RetireExpired(double dNow)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UVistarGameInstance::RetireExpired);
+    _m_arrExpired.Reset();
+    _m_Leases.Sweep(dNow, NetworkConfig.EntityLeaseSeconds, NetworkConfig.LeaseSweepPerFrame, NetworkConfig.MaxExpiredPerFrame,
+        [this](const FVistarEntityId& Id) {
+            ABaseActor* baseActor = getVistarObjectById(Id);
+            return !IsValid(baseActor) || !IsValid(baseActor->GetAttachParentActor());
+        },
+        _m_arrExpired);
+
+    FVistarEntityUpdate Delete;
+    Delete.Stream = EVistarStream::Delete;
+    for (const FVistarEntityId& Id : _m_arrExpired) {
+        // Swarm members never had leases of their own, the delete takes them with the swarm
+        Delete.Id = Id;
+        ReceiveMessage(Delete);
+        _m_Layers.ForgetEntity(Id);
+        // Not held like a sent delete, an entity that was only quiet comes back with its next update
+        _m_CoalescingTable.Remove(Id);
+        _m_mapLastApplied.Remove(Id);
+    }
+
+    if (_m_arrExpired.Num() > 0) {
+        UE_LOG(LogTemp, Log, TEXT("VistarIngest: %d entities expired, %d leases held, %llu expired in total"),
+            _m_arrExpired.Num(), _m_Leases.Num(), _m_Leases.GetExpiredCount());
+    }
+    return _m_arrExpired.Num();
+}
+
+void UVistarGameInstance::ResolveDeferredAttach()
+{
+    // Parents still missing after this frame's events never arrived, same as the single queue case
+    for (const FDeferredAttach& Attach : _m_arrDeferredAttach) {
+        ABaseActor* childActor = getVistarObjectById(Attach.ChildId);
+        ABaseActor* parentActor = getVistarObjectById(Attach.ParentId);
+        if (IsValid(childActor) && IsValid(parentActor)) {
+            childActor->setParentInfo(Attach.ParentId.ToString(), Attach.SocketIndex);
+            FString sSocketId = FString::Printf(TEXT("Child_%d"), Attach.SocketIndex);
+            parentActor->attachChildtoSocket(childActor, sSocketId);
+        }
+    }
+    _m_arrDeferredAttach.Reset();
+}
+
+void UVistarGameInstance::UpdateVistarObject(const FVistarEntityUpdate& Message, ABaseActor* baseActor, bool bRefresh) {
+
+    if (!IsValid(baseActor)) {
+        return;
+    }
+
+    FVistarLocalPose Pose;
+    ResolvePose(Message, Pose);
+    if (Pose.bHasLocation) {
+        baseActor->UpdatePositionXYZ(Pose.Location.X, Pose.Location.Y, Pose.Location.Z);
+    }
+    if (Pose.bHasRotation) {
+        baseActor->UpdateRotationYPR(Pose.Rotation.X, Pose.Rotation.Y, Pose.Rotation.Z);
+    }
+
+    if (Message.bHasSlew) {
+        baseActor->UpdateSlew(Message.SlewAz, Message.SlewElev);
+    }
+
+    if (bRefresh) {
+        baseActor->unsetParentInfo();
+        baseActor->Refresh();
+    }
+}
+
+void UVistarGameInstance::ResolvePose(const FVistarEntityUpdate& Message, FVistarLocalPose& OutPose)
+{
+    if (Message.bHasLocation) {
+        if (!_m_bRecordRefLatLongAlt) {
+            RecordReference(Message.Lon, Message.Lat);
+        }
+
+        OutPose.bHasLocation = true;
+        OutPose.Location = LlaToUnreal(Message.Lon, Message.Lat, Message.Alt, _m_dRefLon, _m_dRefLat, _m_dRefAlt);
+    }
+
+    if (Message.bHasRotation) {
+        OutPose.bHasRotation = true;
+        OutPose.Rotation = FVector3d(Message.Yaw, Message.Pitch, Message.Roll);
+    }
+
+    // DIS is already earth-fixed, straight into the local frame without going through lat/lon
+    if (Message.bHasEcef) {
+        if (!_m_bRecordRefLatLongAlt) {
+            double dLat, dLon, dAlt;
+            FVistarDis::EcefToGeodetic(Message.Ecef, dLat, dLon, dAlt);
+            // LlaToUnreal takes _m_dRefLon as the latitude
+            RecordReference(dLat, dLon);
+        }
+
+        OutPose.bHasLocation = true;
+        OutPose.Location = _m_EnuFrame.ToUnreal(Message.Ecef);
+        OutPose.bHasRotation = true;
+        _m_EnuFrame.ToYawPitchRoll(Message.EcefEuler, OutPose.Rotation.X, OutPose.Rotation.Y, OutPose.Rotation.Z);
+    }
+
+    // Converted by the relay already, in the relay's frame
+    if (Message.bHasLocal) {
+        OutPose.bHasLocation = true;
+        OutPose.Location = Message.Local;
+    }
+}
+
+void UVistarGameInstance::RecordReference(double dLon, double dLat)
+{
+    // Same argument order as the LlaToUnreal call in UpdateVistarObject, so both paths share one frame
+    _m_bRecordRefLatLongAlt = true;
+    _m_dRefLon = dLon;
+    _m_dRefLat = dLat;
+    _m_dRefAlt = 0;
+    _m_EnuFrame.Set(_m_dRefLon, _m_dRefLat, _m_dRefAlt);
+}
+
+ABaseActor* UVistarGameInstance::getVistarObjectById(const FVistarEntityId& ObjectId) {
+    if (ABaseActor** baseActorPtr = _m_listVistarBaseActors.Find(ObjectId)) {
         if (baseActorPtr != nullptr) {
             ABaseActor* baseActor = *baseActorPtr;
             return baseActor;
@@ -249,35 +1162,117 @@ ABaseActor* UVistarGameInstance::getVistarObjectById(FString sObjectId) {
     return nullptr;
 }
 
-ABaseActor* UVistarGameInstance::createNewVistarObject(FString sObjectId,FString sClass) {
+ABaseActor* UVistarGameInstance::createNewVistarObject(const FVistarEntityId& ObjectId, EVistarClassType eClass) {
 
-    ABaseActor* actor = spawnVistarObjectBP(GetVistarClassType(sClass));
+    ABaseActor* actor = spawnVistarObjectBP(eClass);
     if (actor) {
-        actor->SetObjectId(sObjectId);
-        _m_listVistarBaseActors.Add(sObjectId, actor);
+        _m_Layers.NoteEntity(ObjectId, eClass, FVistarEntityId());
+        actor->SetObjectId(ObjectId.ToString());
+        _m_listVistarBaseActors.Add(ObjectId, actor);
+        ++_m_nSpawned;
     }
     return actor;
 }
 
+FVistarIngestAllocStats UVistarGameInstance::GetIngestAllocStats() const
+{
+    FVistarIngestAllocStats Stats;
+    for (const FVistarIngestPipeline* pPipeline : _m_arrPipelines) {
+        Stats += pPipeline->GetAllocStats();
+    }
+    return Stats;
+}
+
+void UVistarGameInstance::GetDecodeWorkerStats(TArray<FVistarDecodeWorkerStats>& OutStats) const
+{
+    OutStats.Reset();
+    TArray<FVistarDecodeWorkerStats> arrPipelineStats;
+    for (const FVistarIngestPipeline* pPipeline : _m_arrPipelines) {
+        pPipeline->GetWorkerStats(arrPipelineStats);
+        OutStats.Append(arrPipelineStats);
+    }
+}
+
+void UVistarGameInstance::GetSourceStats(TArray<FVistarSourceStats>& OutStats) const
+{
+    OutStats.Reset();
+    TArray<FVistarSourceStats> arrPipelineStats;
+    for (const FVistarIngestPipeline* pPipeline : _m_arrPipelines) {
+        pPipeline->GetSourceStats(arrPipelineStats);
+        OutStats.Append(arrPipelineStats);
+    }
+}
+
+void UVistarGameInstance::SetClassLayerVisible(EVistarClassType eClass, bool bVisible)
+{
+    _m_Layers.SetClassVisible(eClass, bVisible);
+    ApplyLayers();
+}
+
+void UVistarGameInstance::SetHierarchyLayerVisible(const FString& RootId, bool bVisible)
+{
+    _m_Layers.SetHierarchyVisible(FVistarEntityId(RootId), bVisible);
+    ApplyLayers();
+}
+
+void UVistarGameInstance::HideLayer(const FString& Name)
+{
+    const EVistarClassType eClass = GetVistarClassType(Name.ToLower());
+    if (eClass != EVistarClassType::VISTAR_TYPE_NONE) {
+        SetClassLayerVisible(eClass, false);
+    }
+    else {
+        SetHierarchyLayerVisible(Name, false);
+    }
+}
+
+void UVistarGameInstance::ShowLayer(const FString& Name)
+{
+    const EVistarClassType eClass = GetVistarClassType(Name.ToLower());
+    if (eClass != EVistarClassType::VISTAR_TYPE_NONE) {
+        SetClassLayerVisible(eClass, true);
+    }
+    else {
+        SetHierarchyLayerVisible(Name, true);
+    }
+}
+
+void UVistarGameInstance::ApplyLayers()
+{
+    // Actors that already exist are only hidden, the state they miss meanwhile goes to the layer store
+    for (const TPair<FVistarEntityId, ABaseActor*>& Elem : _m_listVistarBaseActors) {
+        ABaseActor* baseActor = Elem.Value;
+        const bool bHide = _m_Layers.IsHidden(Elem.Key);
+        if (IsValid(baseActor) && baseActor->IsHidden() != bHide) {
+            baseActor->SetActorHiddenInGame(bHide);
+            baseActor->SetActorEnableCollision(!bHide);
+            baseActor->SetActorTickEnabled(!bHide);
+        }
+    }
+
+    // Everything visible again catches up in one pass, parents first so children can attach
+    TArray<FVistarEntityUpdate> arrRevealed;
+    _m_Layers.TakeRevealed(arrRevealed);
+    for (const FVistarEntityUpdate& Message : arrRevealed) {
+        ReceiveMessage(Message);
+    }
+    ResolveDeferredAttach();
+
+    UE_LOG(LogTemp, Log, TEXT("VistarIngest: layers changed, %d entities rebuilt, %d still hidden with stored state"),
+        arrRevealed.Num(), _m_Layers.NumStored());
+}
+
 EVistarClassType UVistarGameInstance::GetVistarClassType(FString Str)
 {
-    if (Str.Equals(TEXT("drone")))               return EVistarClassType::VISTAR_TYPE_DRONE;
-    else if (Str.Equals(TEXT("drone_swarm")))    return EVistarClassType::VISTAR_TYPE_DRONE_SWARM;
-    else if (Str.Equals(TEXT("fighter")))        return EVistarClassType::VISTAR_TYPE_FIGHTER;
-    else if (Str.Equals(TEXT("uav")))            return EVistarClassType::VISTAR_TYPE_UAV;
-    else if (Str.Equals(TEXT("radar")))          return EVistarClassType::VISTAR_TYPE_RADAR;
-    else if (Str.Equals(TEXT("launcher")))       return EVistarClassType::VISTAR_TYPE_LAUNCHER;
-    else if (Str.Equals(TEXT("missile")))        return EVistarClassType::VISTAR_TYPE_MISSILE;
-    else if (Str.Equals(TEXT("route")))          return EVistarClassType::VISTAR_TYPE_ROUTE;
-    else                                         return EVistarClassType::VISTAR_TYPE_NONE;
+    FTCHARToUTF8 Utf8(*Str);
+    return VistarClassFromName(Utf8.Get(), Utf8.Length());
 }
 
 void UVistarGameInstance::InitializeObjects()
 {
     PopulateActorMap();
-    for (const TPair<FString, ABaseActor*>& Elem : _m_listVistarBaseActors)
+    for (const TPair<FVistarEntityId, ABaseActor*>& Elem : _m_listVistarBaseActors)
     {
-        const FString& Key = Elem.Key;
         ABaseActor* baseActor = Elem.Value;
 
         if (baseActor)
@@ -285,38 +1280,15 @@ void UVistarGameInstance::InitializeObjects()
             baseActor->TransmitSelfInfo();
         }
     }
+    FlushOutbound();
 }
 
 void UVistarGameInstance::Start()
 {
-    FString JsonOutput;
-
-    TSharedRef<FJsonObject> JsonObjectRoot = MakeShared<FJsonObject>();
-
-    // Add key-value pairs
-    JsonObjectRoot->SetStringField(TEXT("STREAM"), TEXT("Event"));
-    JsonObjectRoot->SetStringField(TEXT("TYPE"), TEXT("Start"));
-
-    // Convert to string
-    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonOutput);
-    FJsonSerializer::Serialize(JsonObjectRoot, Writer);
-
-    SendMessage(JsonOutput);
+    SendControl(EVistarControl::Start);
 }
 
 void UVistarGameInstance::Stop()
 {
-    FString JsonOutput;
-
-    TSharedRef<FJsonObject> JsonObjectRoot = MakeShared<FJsonObject>();
-
-    // Add key-value pairs
-    JsonObjectRoot->SetStringField(TEXT("STREAM"), TEXT("Event"));
-    JsonObjectRoot->SetStringField(TEXT("TYPE"), TEXT("Stop"));
-
-    // Convert to string
-    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonOutput);
-    FJsonSerializer::Serialize(JsonObjectRoot, Writer);
-
-    SendMessage(JsonOutput);
-}
\ No newline at end of file
+    SendControl(EVistarControl::Stop);
+}
@@ -5,6 +5,21 @@
 #include "CoreMinimal.h"
 #include "Engine/GameInstance.h"
 #include "../Network/FUdpCommunicator.h"  // Your communicator header
+#include "../Network/VistarMessage.h"
+#include "../Network/VistarBinaryCodec.h"
+#include "../Network/VistarIngestPipeline.h"
+#include "../Network/VistarSender.h"
+#include "../Network/VistarCoalescingTable.h"
+#include "../Network/VistarLatencyHistogram.h"
+#include "../Network/VistarNetStats.h"
+#include "../Network/VistarInterest.h"
+#include "../Network/VistarLayers.h"
+#include "../Network/VistarIngestSource.h"
+#include "../Network/VistarDis.h"
+#include "../Network/VistarRelay.h"
+#include "../Network/VistarDelta.h"
+#include "../Network/VistarLease.h"
+#include "Containers/Ticker.h"
 #include "BaseActor.h"
 #include "VistarGameInstance.generated.h"
 
@@ -12,18 +27,35 @@
  * 
  */
 
-UENUM(BlueprintType)
-enum class EVistarClassType : uint8
+/**
+ * Ingest figures for the last drained frame
+ */
+struct FVistarIngestFrameStats
 {
-	VISTAR_TYPE_NONE        UMETA(DisplayName = "NONE"),
-	VISTAR_TYPE_FIGHTER     UMETA(DisplayName = "FIGHTER"),
-	VISTAR_TYPE_UAV			UMETA(DisplayName = "UAV"),
-	VISTAR_TYPE_DRONE       UMETA(DisplayName = "DRONE"),
-	VISTAR_TYPE_DRONE_SWARM UMETA(DisplayName = "DRONE_SWARM"),
-	VISTAR_TYPE_RADAR		UMETA(DisplayName = "RADAR"),
-	VISTAR_TYPE_LAUNCHER	UMETA(DisplayName = "LAUNCHER"),
-	VISTAR_TYPE_MISSILE		UMETA(DisplayName = "MISSILE"),
-	VISTAR_TYPE_ROUTE		UMETA(DisplayName = "ROUTE"),
+	int32 Drained = 0;
+	int32 Events = 0;
+	// Control lane messages waiting when the frame started, see EVistarLane
+	int32 ControlDepth = 0;
+	int32 UpdatesApplied = 0;
+	// Updates absorbed by a newer one for the same entity
+	int32 UpdatesCollapsed = 0;
+	// Updates left pending because the frame budget ran out
+	int32 UpdatesDeferred = 0;
+	// Sequenced updates dropped because a later datagram already updated the entity,
+	// and updates for an entity deleted within DeleteHoldSeconds
+	int32 UpdatesStale = 0;
+	// Messages for hidden layers, stored as latest state instead of applied
+	int32 UpdatesHidden = 0;
+	// Entities of the keyframes applied this frame
+	int32 KeyframeEntities = 0;
+	// Swarm members placed from swarm messages this frame
+	int32 SwarmMembers = 0;
+	// Entities deleted because their lease ran out or a heartbeat left them out
+	int32 EntitiesExpired = 0;
+	// Heap allocations on the ingest threads since the previous frame, 0 in steady state
+	int32 HeapAllocations = 0;
+	// Growth of the persistent game-thread tables, 0 once the entity count has settled
+	int32 TableBytesGrown = 0;
 };
 
 UCLASS()
@@ -37,13 +69,40 @@ public:
 
 	void SendMessage(const FString& Message);
 
-	void ReceiveMessage(const TSharedPtr<FJsonObject>& JsonObject);
+	// Already encoded outbound message
+	void SendBytes(const TArray<uint8>& Data);
+
+	// Encodes in the configured wire format straight into a pooled buffer and queues it for the
+	// sender thread. ClassName is written as CLASS in JSON, binary uses Message.Class.
+	// With NetworkConfig.bSendDeltas repeated creates and updates go out as deltas, unchanged ones not at all
+	void SendEntity(const FVistarEntityUpdate& Message, const FString& ClassName);
+
+	void SendControl(EVistarControl Control);
+
+	// Push out a partial outbound bundle, the sender thread does this itself when async
+	void FlushOutbound();
+
+	bool UsesBinaryWireFormat() const { return NetworkConfig.OutboundWireFormat == EVistarWireFormat::Binary; }
+
+	FVistarBinaryCodec::FOptions GetBinaryOptions() const;
 
-	void UpdateVistarObject(const TSharedPtr<FJsonObject>& JsonObject, ABaseActor* baseActor, bool bRefresh);
+	// Game thread, applies one decoded message
+	void ReceiveMessage(const FVistarEntityUpdate& Message);
+
+	void UpdateVistarObject(const FVistarEntityUpdate& Message, ABaseActor* baseActor, bool bRefresh);
+
+	// Position and rotation of a message in the local frame, from LOCATION, DIS or a relay entry
+	void ResolvePose(const FVistarEntityUpdate& Message, FVistarLocalPose& OutPose);
+
+	// Ingesting for display nodes instead of showing the entities here, see FVistarRelay
+	bool IsRelayMode() const { return _m_pRelay.IsValid(); }
 
 	FVector3d LlaToUnreal(double lat, double lon, double alt,
 		double refLat, double refLon, double refAlt);
 
+	// Approximate inverse of LlaToUnreal around the reference point, only valid once it is recorded
+	void UnrealToLla(const FVector3d& Location, double& OutLat, double& OutLon, double& OutAlt) const;
+
 	EVistarClassType GetVistarClassType(FString Str);
 
 	UFUNCTION(BlueprintCallable, Category = "Info")
@@ -53,12 +112,80 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Info")
 	void Stop();
 
-	ABaseActor* getVistarObjectById(FString sObjectId);
-	ABaseActor* createNewVistarObject(FString sObjectId,FString sClass);
+	ABaseActor* getVistarObjectById(const FVistarEntityId& ObjectId);
+	ABaseActor* createNewVistarObject(const FVistarEntityId& ObjectId, EVistarClassType eClass);
+
+	// Record live traffic to a capture file, relative paths go under Saved/Captures
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void StartCapture(const FString& Path);
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void StopCapture();
+
+	// Feed a capture file through the ingest path in place of the socket, Speed 0 = as fast as possible
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void StartReplay(const FString& Path, float Speed = 1.0f);
+	// Back to live traffic
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void StopReplay();
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void SeekReplay(float Seconds);
+	UFUNCTION(Exec, BlueprintCallable, Category = "Capture")
+	void SetReplaySpeed(float Speed);
+
+	// Visibility layers. Hidden entities keep only their latest state, no conversion or actor work,
+	// and are rebuilt in one batch when shown again
+	UFUNCTION(BlueprintCallable, Category = "Layers")
+	void SetClassLayerVisible(EVistarClassType eClass, bool bVisible);
+	UFUNCTION(BlueprintCallable, Category = "Layers")
+	bool IsClassLayerVisible(EVistarClassType eClass) const { return _m_Layers.IsClassVisible(eClass); }
+	// The entity and everything attached below it
+	UFUNCTION(BlueprintCallable, Category = "Layers")
+	void SetHierarchyLayerVisible(const FString& RootId, bool bVisible);
+
+	// Console versions, Name is a class (radar, drone_swarm, ...) or an entity ID
+	UFUNCTION(Exec, Category = "Layers")
+	void HideLayer(const FString& Name);
+	UFUNCTION(Exec, Category = "Layers")
+	void ShowLayer(const FString& Name);
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Info")
 	ABaseActor* spawnVistarObjectBP(EVistarClassType eClass);
 
+	const FVistarIngestFrameStats& GetLastIngestStats() const { return _m_LastIngestStats; }
+
+	// Running allocation counters of the receive and decode threads
+	FVistarIngestAllocStats GetIngestAllocStats() const;
+
+	uint64 GetTotalCollapsedUpdates() const { return _m_CoalescingTable.GetCollapsedCount(); }
+
+	// Per decode worker queue depth and decoded totals, empty when decoding on the receiver thread
+	void GetDecodeWorkerStats(TArray<FVistarDecodeWorkerStats>& OutStats) const;
+
+	// Loss, reordering, duplicates and clock offset per source of sequenced datagrams
+	void GetSourceStats(TArray<FVistarSourceStats>& OutStats) const;
+
+	// Datagrams, messages and rates per ingest source, the primary receiver first, then
+	// NetworkConfig.AdditionalSources in order
+	void GetIngestSourceStats(TArray<FVistarIngestSourceStats>& OutStats) const { OutStats = _m_arrIngestSourceStats; }
+
+	uint64 GetTotalStaleUpdates() const { return _m_CoalescingTable.GetStaleCount() + _m_nStaleApplied; }
+
+	// Receiver thread read to game thread apply, every message
+	const FVistarLatencyHistogram& GetReceiveToApplyLatency() const { return _m_ReceiveToApply; }
+	// The same for the control lane only (create, delete, action)
+	const FVistarLatencyHistogram& GetControlReceiveToApplyLatency() const { return _m_ControlReceiveToApply; }
+	// Sender timestamp to the end of the frame that applied it, sequenced messages only
+	const FVistarLatencyHistogram& GetSendToRenderLatency() const { return _m_SendToRender; }
+
+	void ResetLatencyHistograms();
+
+	// Totals of the interest filter upstream, how much traffic the published area kept away
+	FVistarInterestReport GetInterestReport() const;
+
+	// Receiver tuning, set in the Blueprint class defaults
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network")
+	FVistarNetworkConfig NetworkConfig;
+
 private :
 	// Pointer to your communicator
 	FUdpCommunicator* UdpCommunicator;
@@ -66,10 +193,138 @@ private :
 
 	bool _m_bRecordRefLatLongAlt;
 	double _m_dRefLat, _m_dRefLon, _m_dRefAlt;
+	// The frame LlaToUnreal builds around the reference, precomputed for DIS positions
+	FVistarEnuFrame _m_EnuFrame;
+
+	// First position seen, in the (LOCATION.X, LOCATION.Y) order the JSON path keeps it
+	void RecordReference(double dLon, double dLat);
 
 	void PopulateActorMap();
 
 	void InitializeNetworkSendRecv();
 
-	TMap<FString, ABaseActor*> _m_listVistarBaseActors;
+	// Receivers of NetworkConfig.AdditionalSources, each with its own pipeline
+	void StartAdditionalSources();
+
+	// Per-source totals and rates, refreshed once a second
+	void UpdateIngestSourceStats(double dNow);
+
+	// Drains the ingest queues once per frame, control lanes first then coalesced state updates
+	bool TickIngest(float DeltaTime);
+
+	// False for an update of an entity deleted within DeleteHoldSeconds
+	bool AcceptAfterDelete(const FVistarEntityUpdate& Message, double dNow);
+
+	// False when a sequenced update is older than the last one applied to its entity
+	bool AcceptSequenced(const FVistarEntityUpdate& Message);
+
+	// Latency samples and per-class counts of a message applied this frame
+	void RecordApplied(const FVistarEntityUpdate& Message, int64 nNowUs);
+
+	// Running network totals for the VistarNet stats
+	void GatherNetSample(FVistarNetSample& OutSample, uint32 nQueueDepth);
+
+	// End of the game thread frame, the applied state is in this frame's render commands
+	void OnEndFrame();
+
+	// Applies a keyframe in one batch, spawning what is missing parents first, then attaching and
+	// updating. Entities with newer state than the keyframe keep it. Returns the entities applied
+	int32 ApplyKeyframe(TArray<FVistarEntityUpdate>& arrEntries);
+
+	// Converts the reference point once and places every member relative to it, spawning members
+	// seen for the first time. Returns the members applied
+	int32 ApplySwarm(const FVistarSwarmUpdate& Swarm, double dNow);
+
+	// Deletes the member actors of a swarm and drops its member cache, nothing when Id is no swarm
+	void DeleteSwarmMembers(const FVistarEntityId& Id);
+
+	// Deletes a bounded number of entities whose lease ran out, as if their sender had deleted them.
+	// Actors attached to a live parent follow it and never expire on their own. Returns the entities deleted
+	int32 RetireExpired(double dNow);
+
+	// Sends the camera footprint as an interest area when due or when the view moved
+	void PublishInterest(double dNow);
+
+	// Hides and shows actors after a layer change and rebuilds what became visible
+	void ApplyLayers();
+
+	// Receiver-thread decode and the queue it feeds
+	TUniquePtr<FVistarIngestPipeline> _m_pIngestPipeline;
+	// Bound to the pipeline, shared by the socket receiver and replay
+	FOnUdpDataReceived _m_IngestCallback;
+	// Federated simulators beyond the primary receiver
+	TArray<TUniquePtr<FVistarIngestSource>> _m_arrExtraSources;
+	// Every pipeline the game thread drains, the primary first
+	TArray<FVistarIngestPipeline*> _m_arrPipelines;
+	// Messages drained per pipeline, same order
+	TArray<uint64> _m_arrPipelineMessages;
+	TArray<FVistarIngestSourceStats> _m_arrIngestSourceStats;
+	double _m_dLastSourceStats = 0.0;
+	// Bundles, fragments and writes outbound messages, on its own thread with NetworkConfig.bAsyncSend
+	TUniquePtr<FVistarSender> _m_pSender;
+	// Set in relay mode, takes every applied message in place of the actors
+	TUniquePtr<FVistarRelay> _m_pRelay;
+	// Swarms taken from the pipelines this frame, kept to reuse the allocation
+	TArray<FVistarSwarmUpdate> _m_arrSwarms;
+	// Member actors per swarm by member index, so a swarm message needs no ID lookups
+	TMap<FVistarEntityId, TArray<TWeakObjectPtr<ABaseActor>>> _m_mapSwarmMembers;
+	// Last applied components per entity, completes inbound deltas
+	FVistarDeltaState _m_DeltaState;
+	// Last sent components per entity, for outbound deltas
+	FVistarDeltaEncoder _m_DeltaEncoder;
+	// When each network entity was last heard of, by message or heartbeat
+	FVistarLeaseTable _m_Leases;
+	TArray<FVistarHeartbeat> _m_arrHeartbeats;
+	TArray<FVistarEntityId> _m_arrExpired;
+	FTSTicker::FDelegateHandle _m_hIngestTicker;
+	FDelegateHandle _m_hEndFrame;
+
+	// Latest pending state per entity, survives across frames when over budget
+	FVistarCoalescingTable _m_CoalescingTable;
+	FVistarIngestFrameStats _m_LastIngestStats;
+
+	// FVistarIngestAllocStats::Total() at the previous frame
+	uint64 _m_nLastAllocTotal = 0;
+
+	// Sequence of the newest update applied per entity, only entities with sequenced traffic
+	TMap<FVistarEntityId, FVistarDatagramMeta> _m_mapLastApplied;
+	uint64 _m_nStaleApplied = 0;
+	// When each entity was deleted, until a create brings it back or DeleteHoldSeconds pass
+	TMap<FVistarEntityId, double> _m_mapRecentDeletes;
+	double _m_dLastDeletePurge = 0.0;
+
+	FVistarLatencyHistogram _m_ReceiveToApply;
+	FVistarLatencyHistogram _m_ControlReceiveToApply;
+	FVistarLatencyHistogram _m_SendToRender;
+	// Send times (local clock) of this frame's applied messages, turned into samples in OnEndFrame
+	TArray<int64> _m_arrPendingRenderSamples;
+	double _m_dLastLatencyLog = 0.0;
+
+	// "stat VistarNet", overlay and CSV
+	FVistarNetStats _m_NetStats;
+	uint64 _m_nSpawned = 0;
+	uint64 _m_nDestroyed = 0;
+	uint64 _m_arrClassMessages[VistarClassCount] = { 0 };
+	TArray<FVistarSourceStats> _m_arrSourceStats;
+
+	// Hidden classes and hierarchies, with the latest state of their entities
+	FVistarLayers _m_Layers;
+
+	// Last published interest area
+	FVistarInterestArea _m_LastInterest;
+	double _m_dLastInterestPublish = 0.0;
+
+	// Children created this frame before their parent. With decode workers a parent and its
+	// child can sit in different queues, the attach is retried once the frame's events are applied
+	struct FDeferredAttach
+	{
+		FVistarEntityId ChildId;
+		FVistarEntityId ParentId;
+		int32 SocketIndex;
+	};
+	TArray<FDeferredAttach> _m_arrDeferredAttach;
+
+	void ResolveDeferredAttach();
+
+	TMap<FVistarEntityId, ABaseActor*> _m_listVistarBaseActors;
 };
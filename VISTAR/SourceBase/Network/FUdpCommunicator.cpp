@@ -2,6 +2,277 @@
 
 
 #include "FUdpCommunicator.h"
+#include "VistarSequence.h"
+
+#if VISTAR_WITH_RECVMMSG
+#include "BSDSockets/SocketsBSD.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+struct FUdpCommunicator::FReceiverRunnable::FBatchState
+{
+	TArray<mmsghdr> Headers;
+	TArray<iovec> Vectors;
+	// Ancillary data per datagram, carries the socket drop counter
+	TArray<uint8> Control;
+	int32 ControlSize = 0;
+};
+#endif
+
+FUdpCommunicator::FReceiverRunnable::FReceiverRunnable(FSocket* InSocket, FOnUdpDataReceived InCallback, const FVistarNetworkConfig& InConfig)
+	: Socket(InSocket), Ring(nullptr), Thread(nullptr), bStop(false), OnDataReceived(InCallback), Config(InConfig)
+{
+	Config.ReceiveBatchSize = FMath::Max(Config.ReceiveBatchSize, 1);
+	Config.MaxDatagramsPerWakeup = FMath::Max(Config.MaxDatagramsPerWakeup, 1);
+	Config.MaxDatagramSize = FMath::Clamp(Config.MaxDatagramSize, 576, 65507);
+
+	// One spare byte per slot, a read that fills it was cut short by the kernel
+	SlotSize = Config.MaxDatagramSize + 1;
+
+#if VISTAR_WITH_RECVMMSG
+	RecvStorage.SetNumZeroed(SlotSize * Config.ReceiveBatchSize);
+
+	// The slots never move, so the scatter vectors are built once up front
+	Batch = MakeUnique<FBatchState>();
+	Batch->Headers.SetNumZeroed(Config.ReceiveBatchSize);
+	Batch->Vectors.SetNumZeroed(Config.ReceiveBatchSize);
+	Batch->ControlSize = CMSG_SPACE(sizeof(uint32));
+	Batch->Control.SetNumZeroed(Batch->ControlSize * Config.ReceiveBatchSize);
+	for (int32 i = 0; i < Config.ReceiveBatchSize; ++i)
+	{
+		Batch->Vectors[i].iov_base = RecvStorage.GetData() + i * SlotSize;
+		Batch->Vectors[i].iov_len = SlotSize;
+		Batch->Headers[i].msg_hdr.msg_iov = &Batch->Vectors[i];
+		Batch->Headers[i].msg_hdr.msg_iovlen = 1;
+		Batch->Headers[i].msg_hdr.msg_control = Batch->Control.GetData() + i * Batch->ControlSize;
+	}
+
+#ifdef SO_RXQ_OVFL
+	// The kernel then attaches its running drop count for this socket to every datagram
+	const int Enable = 1;
+	if (setsockopt(static_cast<FSocketBSD*>(Socket)->GetNativeSocket(), SOL_SOCKET, SO_RXQ_OVFL, &Enable, sizeof(Enable)) != 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UdpCommunicator: SO_RXQ_OVFL not available, socket drops will not be reported"));
+	}
+#endif
+#else
+	RecvStorage.SetNumZeroed(SlotSize);
+#endif
+
+	// Start the thread last, Run() relies on the buffers above
+	Thread = FRunnableThread::Create(this, TEXT("FReceiverRunnable"), 0,
+		FVistarNetworkConfig::ToThreadPriority(Config.ReceiverThreadPriority),
+		FVistarNetworkConfig::ToAffinityMask(Config.ReceiverThreadAffinityMask));
+}
+
+FUdpCommunicator::FReceiverRunnable::FReceiverRunnable(FVistarShmRing* InRing, FOnUdpDataReceived InCallback, const FVistarNetworkConfig& InConfig)
+	: Socket(nullptr), Ring(InRing), Thread(nullptr), bStop(false), OnDataReceived(InCallback), Config(InConfig), SlotSize(0)
+{
+	Config.MaxDatagramsPerWakeup = FMath::Max(Config.MaxDatagramsPerWakeup, 1);
+	Config.MaxDatagramSize = FMath::Clamp(Config.MaxDatagramSize, 576, 65507);
+
+	// Records are read in place, no receive slots
+	Thread = FRunnableThread::Create(this, TEXT("FReceiverRunnable"), 0,
+		FVistarNetworkConfig::ToThreadPriority(Config.ReceiverThreadPriority),
+		FVistarNetworkConfig::ToAffinityMask(Config.ReceiverThreadAffinityMask));
+}
+
+FUdpCommunicator::FReceiverRunnable::~FReceiverRunnable()
+{
+	if (Thread) { Thread->Kill(true); delete Thread; }
+	StopCapture();
+}
+
+bool FUdpCommunicator::FReceiverRunnable::StartCapture(const FString& Path)
+{
+	TUniquePtr<FVistarCaptureWriter> Writer = MakeUnique<FVistarCaptureWriter>(Path);
+	if (!Writer->IsOpen())
+	{
+		return false;
+	}
+
+	TUniquePtr<FVistarCaptureWriter> Previous;
+	{
+		FScopeLock Lock(&CaptureLock);
+		Previous = MoveTemp(Capture);
+		Capture = MoveTemp(Writer);
+		bCapturing = true;
+	}
+	// Finishing a file joins its writer thread, not under the lock
+	Previous.Reset();
+	return true;
+}
+
+void FUdpCommunicator::FReceiverRunnable::StopCapture()
+{
+	TUniquePtr<FVistarCaptureWriter> Previous;
+	{
+		FScopeLock Lock(&CaptureLock);
+		Previous = MoveTemp(Capture);
+		bCapturing = false;
+	}
+	Previous.Reset();
+}
+
+uint32 FUdpCommunicator::FReceiverRunnable::Run()
+{
+	const FTimespan WaitTime = FTimespan::FromMilliseconds(Config.ReceiveWaitTimeoutMs);
+
+	while (!bStop)
+	{
+		if (Ring)
+		{
+			// Nothing to block on across processes, poll. An empty ring costs two loads per pass
+			if (DrainRing() == 0)
+			{
+				FPlatformProcess::SleepNoStats(0.0002f);
+			}
+			continue;
+		}
+
+		if (!Socket)
+		{
+			FPlatformProcess::Sleep(0.01f);
+			continue;
+		}
+
+		if (Config.bEventDrivenReceive)
+		{
+			// Wakes as soon as the socket is readable, the timeout only exists to observe bStop
+			if (!Socket->Wait(ESocketWaitConditions::WaitForRead, WaitTime))
+			{
+				continue;
+			}
+		}
+		else
+		{
+			uint32 Pending = 0;
+			if (!Socket->HasPendingData(Pending) || Pending == 0)
+			{
+				FPlatformProcess::Sleep(0.01f);
+				continue;
+			}
+		}
+
+#if VISTAR_WITH_RECVMMSG
+		DrainSocketBatched();
+#else
+		DrainSocket();
+#endif
+	}
+	return 0;
+}
+
+int32 FUdpCommunicator::FReceiverRunnable::DrainSocket()
+{
+	uint8* Slot = RecvStorage.GetData();
+	int32 Drained = 0;
+
+	// The socket is non-blocking so Recv fails with EWOULDBLOCK once the queue is empty
+	while (!bStop && Drained < Config.MaxDatagramsPerWakeup)
+	{
+		int32 Read = 0;
+		if (!Socket->Recv(Slot, SlotSize, Read) || Read <= 0)
+		{
+			break;
+		}
+		HandleDatagram(Slot, Read);
+		++Drained;
+	}
+	return Drained;
+}
+
+int32 FUdpCommunicator::FReceiverRunnable::DrainRing()
+{
+	return Ring->Drain([this](const uint8* Data, int32 Size) { HandleDatagram(Data, Size); }, Config.MaxDatagramsPerWakeup);
+}
+
+#if VISTAR_WITH_RECVMMSG
+int32 FUdpCommunicator::FReceiverRunnable::DrainSocketBatched()
+{
+	const int NativeSocket = static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+	const int32 BatchSize = Config.ReceiveBatchSize;
+	int32 Drained = 0;
+
+	while (!bStop && Drained < Config.MaxDatagramsPerWakeup)
+	{
+		// The kernel shrinks msg_controllen to what it wrote, give every slot its full size back
+		for (int32 i = 0; i < BatchSize; ++i)
+		{
+			Batch->Headers[i].msg_hdr.msg_controllen = Batch->ControlSize;
+		}
+
+		const int Received = recvmmsg(NativeSocket, Batch->Headers.GetData(), BatchSize, MSG_DONTWAIT, nullptr);
+		if (Received <= 0)
+		{
+			break;
+		}
+
+#ifdef SO_RXQ_OVFL
+		// The counter is cumulative, the newest datagram has the current value
+		msghdr& Last = Batch->Headers[Received - 1].msg_hdr;
+		for (cmsghdr* Cmsg = CMSG_FIRSTHDR(&Last); Cmsg; Cmsg = CMSG_NXTHDR(&Last, Cmsg))
+		{
+			if (Cmsg->cmsg_level == SOL_SOCKET && Cmsg->cmsg_type == SO_RXQ_OVFL)
+			{
+				uint32 Dropped = 0;
+				FMemory::Memcpy(&Dropped, CMSG_DATA(Cmsg), sizeof(Dropped));
+				SocketDropCount.store(Dropped, std::memory_order_relaxed);
+			}
+		}
+#endif
+
+		for (int i = 0; i < Received; ++i)
+		{
+			HandleDatagram(RecvStorage.GetData() + i * SlotSize, static_cast<int32>(Batch->Headers[i].msg_len));
+		}
+		Drained += Received;
+
+		// A short batch means the kernel queue is empty
+		if (Received < BatchSize)
+		{
+			break;
+		}
+	}
+	return Drained;
+}
+#endif
+
+void FUdpCommunicator::FReceiverRunnable::HandleDatagram(const uint8* Data, int32 Read)
+{
+	if (Read <= 0)
+	{
+		return;
+	}
+	ReceivedCount.fetch_add(1, std::memory_order_relaxed);
+	ReceivedBytes.fetch_add(Read, std::memory_order_relaxed);
+
+	// Never hand a partial datagram to the decoders
+	if (Read > Config.MaxDatagramSize)
+	{
+		const uint64 Count = ++TruncatedCount;
+		if (Count == 1 || Count % 1000 == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("UdpCommunicator: dropped datagram larger than MaxDatagramSize (%d bytes), %llu so far"), Config.MaxDatagramSize, Count);
+		}
+		return;
+	}
+
+	if (bCapturing.load(std::memory_order_relaxed))
+	{
+		FScopeLock Lock(&CaptureLock);
+		if (Capture)
+		{
+			Capture->Append(Data, Read, FVistarSequence::GetLocalTimeUs());
+		}
+	}
+
+	// Decoding happens in the bound callback, straight from the receive slot
+	if (OnDataReceived.IsBound())
+	{
+		OnDataReceived.Execute(Data, Read);
+	}
+}
 
 FUdpCommunicator::FUdpCommunicator()
 	: SenderSocket(nullptr), ReceiverSocket(nullptr), Receiver(nullptr)
@@ -37,21 +308,120 @@ bool FUdpCommunicator::StartSender(const FString& TargetIP, int32 TargetPort)
 	return SenderSocket != nullptr;
 }
 
+bool FUdpCommunicator::StartSharedMemorySender(const FString& Name)
+{
+	SenderRing = FVistarShmRing::OpenProducer(Name);
+	return SenderRing.IsValid();
+}
+
 bool FUdpCommunicator::SendMessage(const FString& Message)
 {
+	FTCHARToUTF8 Utf8(*Message);
+	return SendBytes((const uint8*)Utf8.Get(), Utf8.Length());
+}
+
+bool FUdpCommunicator::SendBytes(const uint8* Data, int32 Size)
+{
+	if (SenderRing)
+	{
+		return SenderRing->Write(Data, Size);
+	}
 	if (!SenderSocket || !RemoteAddress.IsValid())
 	{
 		return false;
 	}
 
-	FTCHARToUTF8 Utf8(*Message);
-	int32 Size = Utf8.Length();
 	int32 Sent = 0;
+	return SenderSocket->SendTo(Data, Size, Sent, *RemoteAddress) && Sent == Size;
+}
+
+uint64 FUdpCommunicator::GetTruncatedCount() const
+{
+	return Receiver ? Receiver->GetTruncatedCount() : 0;
+}
+
+uint64 FUdpCommunicator::GetReceivedCount() const
+{
+	if (Replayer)
+	{
+		return Replayer->GetDeliveredCount();
+	}
+	return Receiver ? Receiver->GetReceivedCount() : 0;
+}
 
-	return SenderSocket->SendTo((uint8*)Utf8.Get(), Size, Sent, *RemoteAddress) && Sent == Size;
+uint64 FUdpCommunicator::GetReceivedBytes() const
+{
+	if (Replayer)
+	{
+		return Replayer->GetDeliveredBytes();
+	}
+	return Receiver ? Receiver->GetReceivedBytes() : 0;
 }
 
-bool FUdpCommunicator::StartReceiver(int32 ListenPort, FOnUdpDataReceived Callback)
+bool FUdpCommunicator::StartCapture(const FString& Path)
+{
+	if (!Receiver)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UdpCommunicator: no live receiver to capture from"));
+		return false;
+	}
+	return Receiver->StartCapture(Path);
+}
+
+void FUdpCommunicator::StopCapture()
+{
+	if (Receiver)
+	{
+		Receiver->StopCapture();
+	}
+}
+
+bool FUdpCommunicator::StartReplay(const FString& Path, FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config)
+{
+	Replayer.Reset();
+
+	// The receiver thread is joined first, the replay thread takes over as the only producer
+	if (Receiver)
+	{
+		Receiver->Stop();
+		Receiver->Wait();
+		delete Receiver;
+		Receiver = nullptr;
+	}
+
+	Replayer = MakeUnique<FVistarReplayer>(Path,
+		[Callback](const uint8* Data, int32 Size) { Callback.ExecuteIfBound(Data, Size); },
+		Config.ReplaySpeed, Config.bLoopReplay);
+	if (!Replayer->IsOpen())
+	{
+		Replayer.Reset();
+		StopReplay();
+		return false;
+	}
+	return true;
+}
+
+void FUdpCommunicator::StopReplay()
+{
+	Replayer.Reset();
+
+	// Back to live traffic when there is a socket or ring to listen on
+	if (ReceiverRing && !Receiver)
+	{
+		Receiver = new FReceiverRunnable(ReceiverRing.Get(), ReceiverCallback, ReceiverConfig);
+	}
+	else if (ReceiverSocket && !Receiver)
+	{
+		Receiver = new FReceiverRunnable(ReceiverSocket, ReceiverCallback, ReceiverConfig);
+	}
+}
+
+uint64 FUdpCommunicator::GetSocketDropCount() const
+{
+	return Receiver ? Receiver->GetSocketDropCount() : 0;
+}
+
+bool FUdpCommunicator::StartReceiver(int32 ListenPort, FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config)
 {
 	//FIPv4Address Addr = FIPv4Address::Any;
 	//FIPv4Address::Parse(TEXT("192.168.29.58"), Addr); // Listen on all interfaces
@@ -65,24 +435,41 @@ bool FUdpCommunicator::StartReceiver(int32 ListenPort, FOnUdpDataReceived Callba
 		.AsReusable()
 		.BoundToAddress(FIPv4Address::Any)
 		.BoundToPort(ListenPort)
-		.WithReceiveBufferSize(2 * 1024 * 1024);
+		.WithReceiveBufferSize(Config.ReceiveBufferSize);
 
 
+	if (!ReceiverSocket) return false;
+
 	bool bValid;
 
 	// Join multicast group
-	TSharedRef<FInternetAddr> GroupAddr = SocketSubsystem->CreateInternetAddr();
-	GroupAddr->SetIp(TEXT("225.0.0.1"), bValid);
-	GroupAddr->SetPort(ListenPort);
-
-	bool bBindAll = false;
-	TSharedRef<FInternetAddr> LocalInterface = SocketSubsystem->GetLocalHostAddr(*GLog, bBindAll);
-	ReceiverSocket->JoinMulticastGroup(*GroupAddr);
+	if (!Config.MulticastGroup.IsEmpty())
+	{
+		TSharedRef<FInternetAddr> GroupAddr = SocketSubsystem->CreateInternetAddr();
+		GroupAddr->SetIp(*Config.MulticastGroup, bValid);
+		GroupAddr->SetPort(ListenPort);
 
-	if (!ReceiverSocket) return false;
+		bool bBindAll = false;
+		TSharedRef<FInternetAddr> LocalInterface = SocketSubsystem->GetLocalHostAddr(*GLog, bBindAll);
+		ReceiverSocket->JoinMulticastGroup(*GroupAddr);
+	}
 
 	ReceiverSocket->SetMulticastLoopback(true);
-	Receiver = new FReceiverRunnable(ReceiverSocket, Callback);
+	ReceiverCallback = Callback;
+	ReceiverConfig = Config;
+	Receiver = new FReceiverRunnable(ReceiverSocket, Callback, Config);
+	return true;
+}
+
+bool FUdpCommunicator::StartSharedMemoryReceiver(FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config)
+{
+	ReceiverRing = FVistarShmRing::CreateConsumer(Config.SharedMemoryName, Config.SharedMemorySize);
+	if (!ReceiverRing) return false;
+
+	UE_LOG(LogTemp, Log, TEXT("UdpCommunicator: receiving from shared memory '%s', %llu byte ring"), *Config.SharedMemoryName, ReceiverRing->GetCapacity());
+	ReceiverCallback = Callback;
+	ReceiverConfig = Config;
+	Receiver = new FReceiverRunnable(ReceiverRing.Get(), Callback, Config);
 	return true;
 }
 
@@ -94,7 +481,9 @@ void FUdpCommunicator::Shutdown()
 		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(SenderSocket);
 		SenderSocket = nullptr;
 	}
+	SenderRing.Reset();
 
+	Replayer.Reset();
 	if (Receiver)
 	{
 		Receiver->Stop();
@@ -108,4 +497,6 @@ void FUdpCommunicator::Shutdown()
 		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ReceiverSocket);
 		ReceiverSocket = nullptr;
 	}
+	// After the receiver thread is gone, it reads the ring in place
+	ReceiverRing.Reset();
 }
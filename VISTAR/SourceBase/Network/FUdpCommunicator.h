@@ -7,12 +7,17 @@
 #include "Sockets.h"
 #include "SocketSubsystem.h"
 #include "Networking.h"
+#include "VistarNetworkConfig.h"
+#include "VistarCapture.h"
+#include "VistarShmRing.h"
+#include <atomic>
 \
 /**
  * 
  */
 
-DECLARE_DELEGATE_OneParam(FOnUdpDataReceived, const TSharedPtr<FJsonObject>& /*Data*/);
+// Raw datagram, only valid for the duration of the call
+DECLARE_DELEGATE_TwoParams(FOnUdpDataReceived, const uint8* /*Data*/, int32 /*Size*/);
 
 class VISTAR_API FUdpCommunicator
 {
@@ -23,78 +28,60 @@ private:
 	class FReceiverRunnable : public FRunnable
 	{
 	public:
-		FReceiverRunnable(FSocket* InSocket, FOnUdpDataReceived InCallback)
-			: Socket(InSocket), bStop(false), OnDataReceived(InCallback)
-		{
-			Thread = FRunnableThread::Create(this, TEXT("FReceiverRunnable"));
-		}
-		virtual ~FReceiverRunnable()
-		{
-			if (Thread) { Thread->Kill(true); delete Thread; }
-		}
-		virtual uint32 Run() override
-		{
-			//TArray<uint8> Buffer;
-			//Buffer.SetNumUninitialized(1024);
-			char Buffer[10000] = { 0 };
-			while (!bStop)
-			{
-				uint32 Pending = 0;
-				if (Socket && Socket->HasPendingData(Pending) && Pending > 0)
-				{
-
-					//Buffer.SetNumUninitialized(FMath::Min(Pending, 65507u));
-					int32 Read = 0;
-					if (Socket->Recv(reinterpret_cast<uint8*>(Buffer), sizeof(Buffer), Read) && Read > 0)
-					{
-						int32 size = sizeof(Buffer) - 1;
-						Buffer[FMath::Min(Read, size)] = '\0';
-						FString ReceivedString = FString(UTF8_TO_TCHAR(Buffer));
-						// Convert bytes to FString (assuming UTF8)
-						//FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Buffer.GetData()), Read);
-						//FString ReceivedString(Converter.Get(), Converter.Length());
-						//FString ReceivedString = FString(UTF8_TO_TCHAR(Buffer.GetData()));
-
-						if (OnDataReceived.IsBound())
-						{
-							//FString AsString;
-							//TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&AsString);
-							//FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
-
-							//const char* JsonData = reinterpret_cast<const char*>(Buffer);
-							TSharedPtr<FJsonObject> JsonObject;
-							TSharedRef<TJsonReader<TCHAR>> Reader = TJsonReaderFactory<TCHAR>::Create(ReceivedString);
-							bool bValid = FJsonSerializer::Deserialize(Reader, JsonObject);
-							if (bValid) {
-								// Call delegate on game thread asynchronously
-								//AsyncTask(ENamedThreads::GameThread, [JsonObject, Callback = OnDataReceived]()
-									//{
-								UE_LOG(LogTemp, Log, TEXT("Recvd JSON string!"));
-								OnDataReceived.Execute(JsonObject);//UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON string!"));
-									//});
-							}
-							else {
-								UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON string!"));
-							}
-						}
-					}
-				}
-				else
-				{
-					FPlatformProcess::Sleep(0.01f);
-				}
-			}
-			return 0;
-		}
+		FReceiverRunnable(FSocket* InSocket, FOnUdpDataReceived InCallback, const FVistarNetworkConfig& InConfig);
+		// Reads the shared memory ring instead of a socket
+		FReceiverRunnable(FVistarShmRing* InRing, FOnUdpDataReceived InCallback, const FVistarNetworkConfig& InConfig);
+		virtual ~FReceiverRunnable();
+		virtual uint32 Run() override;
 		virtual void Stop() override { bStop = true; }
 		void Wait() { if (Thread) Thread->WaitForCompletion(); }
+		uint64 GetTruncatedCount() const { return TruncatedCount.load(std::memory_order_relaxed); }
+		uint64 GetReceivedCount() const { return ReceivedCount.load(std::memory_order_relaxed); }
+		uint64 GetReceivedBytes() const { return ReceivedBytes.load(std::memory_order_relaxed); }
+		uint64 GetSocketDropCount() const { return SocketDropCount.load(std::memory_order_relaxed); }
+
+		// Any thread. Records every datagram handed to the callback from now on
+		bool StartCapture(const FString& Path);
+		void StopCapture();
 
 	private:
+		// Read every datagram currently queued on the socket, returns the count drained
+		int32 DrainSocket();
+		// Hands every record in the ring to the callback in place
+		int32 DrainRing();
+#if VISTAR_WITH_RECVMMSG
+		// Linux fast path, pulls up to ReceiveBatchSize datagrams per recvmmsg() call
+		int32 DrainSocketBatched();
+
+		struct FBatchState;
+		TUniquePtr<FBatchState> Batch;
+#endif
+		void HandleDatagram(const uint8* Data, int32 Read);
+
 		FSocket* Socket;
+		FVistarShmRing* Ring;
 		FRunnableThread* Thread;
 		FThreadSafeBool bStop;
 		// Delegate to bind your callback
 		FOnUdpDataReceived OnDataReceived;
+
+		FVistarNetworkConfig Config;
+
+		// One slot per datagram of a batch, MaxDatagramSize + 1 bytes each
+		TArray<uint8> RecvStorage;
+		int32 SlotSize;
+
+		// Datagrams dropped for exceeding MaxDatagramSize
+		std::atomic<uint64> TruncatedCount{ 0 };
+		std::atomic<uint64> ReceivedCount{ 0 };
+		std::atomic<uint64> ReceivedBytes{ 0 };
+		// Datagrams the kernel dropped because the socket buffer was full (SO_RXQ_OVFL, Linux only)
+		std::atomic<uint64> SocketDropCount{ 0 };
+
+		// Only locked while capturing, the flag keeps the lock off the normal path
+		FCriticalSection CaptureLock;
+		TUniquePtr<FVistarCaptureWriter> Capture;
+		std::atomic<bool> bCapturing{ false };
 	};
 
 
@@ -106,17 +93,58 @@ public:
 	bool StartSender(const FString& TargetIP, int32 TargetPort);
 
 	// Initialize receiver
-	bool StartReceiver(int32 ListenPort, FOnUdpDataReceived Callback);
+	bool StartReceiver(int32 ListenPort, FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config = FVistarNetworkConfig());
+
+	// Receive from the shared memory ring named in Config instead of a socket, for a simulator on the
+	// same machine. Creates the ring, the simulator attaches with StartSharedMemorySender
+	bool StartSharedMemoryReceiver(FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config = FVistarNetworkConfig());
+
+	// Send into a ring created by a receiver on this machine, in place of a socket
+	bool StartSharedMemorySender(const FString& Name);
 
 	// Send a message
 	bool SendMessage(const FString& Message);
 
+	// Send an already encoded datagram
+	bool SendBytes(const uint8* Data, int32 Size);
+
+	// Datagrams the receiver dropped for exceeding FVistarNetworkConfig::MaxDatagramSize
+	uint64 GetTruncatedCount() const;
+
+	// Datagrams and bytes read from the receive socket (truncated ones included) or replayed
+	uint64 GetReceivedCount() const;
+	uint64 GetReceivedBytes() const;
+
+	// Datagrams the kernel dropped before the receiver could read them. Only reported on Linux
+	// (SO_RXQ_OVFL), 0 elsewhere
+	uint64 GetSocketDropCount() const;
+
+	// Record received datagrams to a capture file, see FVistarCapture. Live traffic only
+	bool StartCapture(const FString& Path);
+	void StopCapture();
+
+	// Feed a capture file to Callback in place of the socket. A running receiver is paused and
+	// resumes on StopReplay, so the callback only ever has one producer thread
+	bool StartReplay(const FString& Path, FOnUdpDataReceived Callback, const FVistarNetworkConfig& Config = FVistarNetworkConfig());
+	void StopReplay();
+	bool IsReplaying() const { return Replayer.IsValid(); }
+	// Null when not replaying
+	FVistarReplayer* GetReplayer() const { return Replayer.Get(); }
+
 	// Cleanup
 	void Shutdown();
 
 private:
 	FSocket* SenderSocket;
 	FSocket* ReceiverSocket;
+	TUniquePtr<FVistarShmRing> SenderRing;
+	TUniquePtr<FVistarShmRing> ReceiverRing;
 	FReceiverRunnable *Receiver;
 	TSharedPtr<FInternetAddr> RemoteAddress;
+
+	// Kept to resume the receiver after a replay
+	FOnUdpDataReceived ReceiverCallback;
+	FVistarNetworkConfig ReceiverConfig;
+
+	TUniquePtr<FVistarReplayer> Replayer;
 };
@@ -0,0 +1,524 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarBinaryCodec.h"
+
+namespace
+{
+	enum EVistarBinaryFlags : uint16
+	{
+		Flag_Parent				= 1 << 0,
+		Flag_Action				= 1 << 1,
+		Flag_Trajectory			= 1 << 2,
+		Flag_Location			= 1 << 3,
+		Flag_Rotation			= 1 << 4,
+		Flag_Slew				= 1 << 5,
+		Flag_Points				= 1 << 6,
+		Flag_QuantizedPosition	= 1 << 8,
+		Flag_QuantizedAngles	= 1 << 9,
+	};
+
+	enum EVistarDeltaFlags : uint8
+	{
+		DeltaFlag_QuantizedPosition	= 1 << 0,
+		DeltaFlag_QuantizedAngles	= 1 << 1,
+	};
+
+	constexpr int32 EntityHeaderSize = 7;
+	constexpr int32 ControlHeaderSize = 4;
+	constexpr int32 DeltaHeaderSize = 5;
+
+	constexpr double LatLonScale = 1e7;
+	constexpr double AltitudeScale = 100.0;
+	constexpr double AngleScale = 65536.0 / 360.0;
+
+	// All supported targets are little-endian, values are written as they sit in memory
+	template <typename T>
+	FORCEINLINE void Write(TArray<uint8>& Buffer, T Value)
+	{
+		const int32 Offset = Buffer.AddUninitialized(sizeof(T));
+		FMemory::Memcpy(Buffer.GetData() + Offset, &Value, sizeof(T));
+	}
+
+	void WriteString(TArray<uint8>& Buffer, const FVistarInlineString& Str)
+	{
+		Write<uint8>(Buffer, static_cast<uint8>(Str.Len()));
+		Buffer.Append(reinterpret_cast<const uint8*>(Str.GetData()), Str.Len());
+	}
+
+	FORCEINLINE int16 QuantizeAngle(double Degrees)
+	{
+		return static_cast<int16>(FMath::RoundToInt(FRotator::NormalizeAxis(Degrees) * AngleScale));
+	}
+
+	struct FBinaryReader
+	{
+		const uint8* P;
+		const uint8* End;
+
+		template <typename T>
+		bool Read(T& OutValue)
+		{
+			if (End - P < static_cast<int64>(sizeof(T)))
+			{
+				return false;
+			}
+			FMemory::Memcpy(&OutValue, P, sizeof(T));
+			P += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(FVistarInlineString& OutStr)
+		{
+			uint8 Length = 0;
+			if (!Read(Length) || End - P < Length)
+			{
+				return false;
+			}
+			const bool bFits = OutStr.Set(reinterpret_cast<const ANSICHAR*>(P), Length);
+			P += Length;
+			return bFits;
+		}
+
+		bool ReadAngle(bool bQuantized, double& OutValue)
+		{
+			if (bQuantized)
+			{
+				int16 Quantized = 0;
+				if (!Read(Quantized))
+				{
+					return false;
+				}
+				OutValue = Quantized / AngleScale;
+				return true;
+			}
+			return Read(OutValue);
+		}
+	};
+
+	// Whether the position of Message fits the quantized encoding. Values past the int32 range (Unreal
+	// centimetres, or anything but degrees) go out as doubles for that message instead of overflowing
+	bool QuantizesPosition(const FVistarEntityUpdate& Message, const FVistarBinaryCodec::FOptions& Options)
+	{
+		if (!Options.bQuantizePosition)
+		{
+			return false;
+		}
+		const uint8 Components = Message.GetComponents();
+		for (int32 Index = 0; Index < 3; ++Index)
+		{
+			const double Scaled = FMath::RoundToDouble(Message.GetComponent(Index) * (Index == 2 ? AltitudeScale : LatLonScale));
+			// NaN fails the comparison too
+			if ((Components & (1 << Index)) && !(FMath::Abs(Scaled) <= MAX_int32))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint16 GetFlags(const FVistarEntityUpdate& Message, const FVistarBinaryCodec::FOptions& Options)
+	{
+		uint16 Flags = 0;
+		Flags |= !Message.ParentId.IsEmpty() ? Flag_Parent : 0;
+		Flags |= !Message.Action.IsEmpty() ? Flag_Action : 0;
+		Flags |= !Message.Trajectory.IsEmpty() ? Flag_Trajectory : 0;
+		Flags |= Message.bHasLocation ? Flag_Location : 0;
+		Flags |= Message.bHasRotation ? Flag_Rotation : 0;
+		Flags |= Message.bHasSlew ? Flag_Slew : 0;
+		Flags |= Message.Points.Num() > 0 ? Flag_Points : 0;
+		Flags |= QuantizesPosition(Message, Options) ? Flag_QuantizedPosition : 0;
+		Flags |= Options.bQuantizeAngles ? Flag_QuantizedAngles : 0;
+		return Flags;
+	}
+
+	// Where the ID length byte sits, 0 for messages without an entity
+	int32 GetIdOffset(const uint8* Data, int32 Size)
+	{
+		if (Size < ControlHeaderSize || Data[0] != FVistarBinaryCodec::Magic)
+		{
+			return 0;
+		}
+		if (Data[2] == static_cast<uint8>(FVistarBinaryCodec::EType::Entity))
+		{
+			return EntityHeaderSize;
+		}
+		if (Data[2] == static_cast<uint8>(FVistarBinaryCodec::EType::Delta))
+		{
+			return DeltaHeaderSize;
+		}
+		return 0;
+	}
+
+	// Encoded size of component bit Index
+	FORCEINLINE int32 GetComponentSize(int32 Index, bool bQuantizePosition, const FVistarBinaryCodec::FOptions& Options)
+	{
+		if (Index < 3)
+		{
+			return bQuantizePosition ? sizeof(int32) : sizeof(double);
+		}
+		return Options.bQuantizeAngles ? sizeof(int16) : sizeof(double);
+	}
+}
+
+int32 FVistarBinaryCodec::GetEncodedSize(const FVistarEntityUpdate& Message, const FOptions& Options)
+{
+	const uint16 Flags = GetFlags(Message, Options);
+	const int32 AngleSize = (Flags & Flag_QuantizedAngles) ? sizeof(int16) : sizeof(double);
+
+	int32 Size = EntityHeaderSize + 1 + Message.Id.Len();
+	Size += (Flags & Flag_Parent) ? 1 + Message.ParentId.Len() + sizeof(int32) : 0;
+	Size += (Flags & Flag_Action) ? 1 + Message.Action.Len() : 0;
+	Size += (Flags & Flag_Trajectory) ? 1 + Message.Trajectory.Len() : 0;
+	Size += (Flags & Flag_Location) ? ((Flags & Flag_QuantizedPosition) ? 3 * sizeof(int32) : 3 * sizeof(double)) : 0;
+	Size += (Flags & Flag_Rotation) ? 3 * AngleSize : 0;
+	Size += (Flags & Flag_Slew) ? 2 * AngleSize : 0;
+	Size += (Flags & Flag_Points) ? sizeof(uint16) + FMath::Min(Message.Points.Num(), (int32)MAX_uint16) * 3 * sizeof(double) : 0;
+	return Size;
+}
+
+void FVistarBinaryCodec::EncodeEntity(const FVistarEntityUpdate& Message, const FOptions& Options, TArray<uint8>& OutBuffer)
+{
+	const uint16 Flags = GetFlags(Message, Options);
+	OutBuffer.Reserve(OutBuffer.Num() + GetEncodedSize(Message, Options));
+
+	Write<uint8>(OutBuffer, Magic);
+	Write<uint8>(OutBuffer, Version);
+	Write<uint8>(OutBuffer, static_cast<uint8>(EType::Entity));
+	Write<uint8>(OutBuffer, static_cast<uint8>(Message.Stream));
+	Write<uint8>(OutBuffer, static_cast<uint8>(Message.Class));
+	Write<uint16>(OutBuffer, Flags);
+
+	WriteString(OutBuffer, Message.Id);
+	if (Flags & Flag_Parent)
+	{
+		WriteString(OutBuffer, Message.ParentId);
+		Write<int32>(OutBuffer, Message.ChildId);
+	}
+	if (Flags & Flag_Action)
+	{
+		WriteString(OutBuffer, Message.Action);
+	}
+	if (Flags & Flag_Trajectory)
+	{
+		WriteString(OutBuffer, Message.Trajectory);
+	}
+
+	if (Flags & Flag_Location)
+	{
+		if (Flags & Flag_QuantizedPosition)
+		{
+			Write<int32>(OutBuffer, static_cast<int32>(FMath::RoundToDouble(Message.Lon * LatLonScale)));
+			Write<int32>(OutBuffer, static_cast<int32>(FMath::RoundToDouble(Message.Lat * LatLonScale)));
+			Write<int32>(OutBuffer, static_cast<int32>(FMath::RoundToDouble(Message.Alt * AltitudeScale)));
+		}
+		else
+		{
+			Write<double>(OutBuffer, Message.Lon);
+			Write<double>(OutBuffer, Message.Lat);
+			Write<double>(OutBuffer, Message.Alt);
+		}
+	}
+
+	const bool bQuantizeAngles = (Flags & Flag_QuantizedAngles) != 0;
+	auto WriteAngle = [&OutBuffer, bQuantizeAngles](double Degrees)
+		{
+			if (bQuantizeAngles)
+			{
+				Write<int16>(OutBuffer, QuantizeAngle(Degrees));
+			}
+			else
+			{
+				Write<double>(OutBuffer, Degrees);
+			}
+		};
+
+	if (Flags & Flag_Rotation)
+	{
+		WriteAngle(Message.Yaw);
+		WriteAngle(Message.Pitch);
+		WriteAngle(Message.Roll);
+	}
+	if (Flags & Flag_Slew)
+	{
+		WriteAngle(Message.SlewAz);
+		WriteAngle(Message.SlewElev);
+	}
+
+	if (Flags & Flag_Points)
+	{
+		const int32 NumPoints = FMath::Min(Message.Points.Num(), (int32)MAX_uint16);
+		Write<uint16>(OutBuffer, static_cast<uint16>(NumPoints));
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			Write<double>(OutBuffer, Message.Points[i].X);
+			Write<double>(OutBuffer, Message.Points[i].Y);
+			Write<double>(OutBuffer, Message.Points[i].Z);
+		}
+	}
+}
+
+void FVistarBinaryCodec::EncodeControl(EVistarControl Control, TArray<uint8>& OutBuffer)
+{
+	Write<uint8>(OutBuffer, Magic);
+	Write<uint8>(OutBuffer, Version);
+	Write<uint8>(OutBuffer, static_cast<uint8>(EType::Control));
+	Write<uint8>(OutBuffer, static_cast<uint8>(Control));
+}
+
+void FVistarBinaryCodec::EncodeDelta(const FVistarEntityUpdate& Message, const FOptions& Options, TArray<uint8>& OutBuffer)
+{
+	const uint8 Components = Message.GetComponents();
+	OutBuffer.Reserve(OutBuffer.Num() + GetEncodedDeltaSize(Message, Options));
+
+	const bool bQuantizePosition = QuantizesPosition(Message, Options);
+	uint8 Flags = 0;
+	Flags |= bQuantizePosition ? DeltaFlag_QuantizedPosition : 0;
+	Flags |= Options.bQuantizeAngles ? DeltaFlag_QuantizedAngles : 0;
+
+	Write<uint8>(OutBuffer, Magic);
+	Write<uint8>(OutBuffer, Version);
+	Write<uint8>(OutBuffer, static_cast<uint8>(EType::Delta));
+	Write<uint8>(OutBuffer, Flags);
+	Write<uint8>(OutBuffer, Components);
+	WriteString(OutBuffer, Message.Id);
+
+	// Components follow in bit order, Lon first
+	for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+	{
+		if (!(Components & (1 << Index)))
+		{
+			continue;
+		}
+		const double Value = Message.GetComponent(Index);
+		if (Index < 3)
+		{
+			if (bQuantizePosition)
+			{
+				Write<int32>(OutBuffer, static_cast<int32>(FMath::RoundToDouble(Value * (Index == 2 ? AltitudeScale : LatLonScale))));
+			}
+			else
+			{
+				Write<double>(OutBuffer, Value);
+			}
+		}
+		else if (Options.bQuantizeAngles)
+		{
+			Write<int16>(OutBuffer, QuantizeAngle(Value));
+		}
+		else
+		{
+			Write<double>(OutBuffer, Value);
+		}
+	}
+}
+
+int32 FVistarBinaryCodec::GetEncodedDeltaSize(const FVistarEntityUpdate& Message, const FOptions& Options)
+{
+	const uint8 Components = Message.GetComponents();
+	const bool bQuantizePosition = QuantizesPosition(Message, Options);
+	int32 Size = DeltaHeaderSize + 1 + Message.Id.Len();
+	for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+	{
+		Size += (Components & (1 << Index)) ? GetComponentSize(Index, bQuantizePosition, Options) : 0;
+	}
+	return Size;
+}
+
+bool FVistarBinaryCodec::PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength)
+{
+	// The ID always directly follows the entity or delta header
+	const int32 IdOffset = GetIdOffset(Data, Size);
+	if (IdOffset == 0 || Size <= IdOffset)
+	{
+		return false;
+	}
+	const int32 Length = Data[IdOffset];
+	if (Length == 0 || IdOffset + 1 + Length > Size)
+	{
+		return false;
+	}
+	OutId = reinterpret_cast<const ANSICHAR*>(Data + IdOffset + 1);
+	OutLength = Length;
+	return true;
+}
+
+bool FVistarBinaryCodec::PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream)
+{
+	// Deltas are always updates
+	if (Size >= DeltaHeaderSize && Data[0] == Magic && Data[2] == static_cast<uint8>(EType::Delta))
+	{
+		OutStream = EVistarStream::Update;
+		return true;
+	}
+
+	// STREAM is the first byte after the common header
+	if (Size < EntityHeaderSize || Data[0] != Magic || Data[2] != static_cast<uint8>(EType::Entity)
+		|| Data[3] > static_cast<uint8>(EVistarStream::Action))
+	{
+		return false;
+	}
+	OutStream = static_cast<EVistarStream>(Data[3]);
+	return true;
+}
+
+EVistarDecodeResult FVistarBinaryCodec::Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage)
+{
+	if (Size < ControlHeaderSize || Data[0] != Magic || Data[1] != Version)
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	if (Data[2] == static_cast<uint8>(EType::Control))
+	{
+		return EVistarDecodeResult::Ignored;
+	}
+	if (Data[2] == static_cast<uint8>(EType::Delta))
+	{
+		return DecodeDelta(Data, Size, OutMessage);
+	}
+	if (Data[2] != static_cast<uint8>(EType::Entity) || Size < EntityHeaderSize)
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	FBinaryReader Reader{ Data + 3, Data + Size };
+	uint8 Stream = 0, Class = 0;
+	uint16 Flags = 0;
+	Reader.Read(Stream);
+	Reader.Read(Class);
+	Reader.Read(Flags);
+
+	if (Stream > static_cast<uint8>(EVistarStream::Action) || Class > static_cast<uint8>(EVistarClassType::VISTAR_TYPE_ROUTE))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	OutMessage.Stream = static_cast<EVistarStream>(Stream);
+	OutMessage.Class = static_cast<EVistarClassType>(Class);
+
+	if (!Reader.ReadString(OutMessage.Id) || OutMessage.Id.IsEmpty())
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	if ((Flags & Flag_Parent) && (!Reader.ReadString(OutMessage.ParentId) || !Reader.Read(OutMessage.ChildId)))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	if ((Flags & Flag_Action) && !Reader.ReadString(OutMessage.Action))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	if ((Flags & Flag_Trajectory) && !Reader.ReadString(OutMessage.Trajectory))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	if (Flags & Flag_Location)
+	{
+		if (Flags & Flag_QuantizedPosition)
+		{
+			int32 Lon = 0, Lat = 0, Alt = 0;
+			if (!Reader.Read(Lon) || !Reader.Read(Lat) || !Reader.Read(Alt))
+			{
+				return EVistarDecodeResult::Malformed;
+			}
+			OutMessage.Lon = Lon / LatLonScale;
+			OutMessage.Lat = Lat / LatLonScale;
+			OutMessage.Alt = Alt / AltitudeScale;
+		}
+		else if (!Reader.Read(OutMessage.Lon) || !Reader.Read(OutMessage.Lat) || !Reader.Read(OutMessage.Alt))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		OutMessage.bHasLocation = true;
+	}
+
+	const bool bQuantizedAngles = (Flags & Flag_QuantizedAngles) != 0;
+	if (Flags & Flag_Rotation)
+	{
+		if (!Reader.ReadAngle(bQuantizedAngles, OutMessage.Yaw) || !Reader.ReadAngle(bQuantizedAngles, OutMessage.Pitch)
+			|| !Reader.ReadAngle(bQuantizedAngles, OutMessage.Roll))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		OutMessage.bHasRotation = true;
+	}
+	if (Flags & Flag_Slew)
+	{
+		if (!Reader.ReadAngle(bQuantizedAngles, OutMessage.SlewAz) || !Reader.ReadAngle(bQuantizedAngles, OutMessage.SlewElev))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		OutMessage.bHasSlew = true;
+	}
+
+	if (Flags & Flag_Points)
+	{
+		uint16 NumPoints = 0;
+		if (!Reader.Read(NumPoints) || Reader.End - Reader.P < static_cast<int64>(NumPoints) * 3 * sizeof(double))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		OutMessage.Points.SetNumUninitialized(NumPoints);
+		for (FVector3d& Point : OutMessage.Points)
+		{
+			Reader.Read(Point.X);
+			Reader.Read(Point.Y);
+			Reader.Read(Point.Z);
+		}
+	}
+
+	return EVistarDecodeResult::Ok;
+}
+
+EVistarDecodeResult FVistarBinaryCodec::DecodeDelta(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage)
+{
+	if (Size < DeltaHeaderSize)
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	FBinaryReader Reader{ Data + 3, Data + Size };
+	uint8 Flags = 0, Components = 0;
+	Reader.Read(Flags);
+	Reader.Read(Components);
+
+	OutMessage.Stream = EVistarStream::Update;
+	if (!Reader.ReadString(OutMessage.Id) || OutMessage.Id.IsEmpty())
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	const bool bQuantizedPosition = (Flags & DeltaFlag_QuantizedPosition) != 0;
+	const bool bQuantizedAngles = (Flags & DeltaFlag_QuantizedAngles) != 0;
+	for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+	{
+		if (!(Components & (1 << Index)))
+		{
+			continue;
+		}
+		double& Value = OutMessage.GetComponent(Index);
+		if (Index >= 3)
+		{
+			if (!Reader.ReadAngle(bQuantizedAngles, Value))
+			{
+				return EVistarDecodeResult::Malformed;
+			}
+		}
+		else if (bQuantizedPosition)
+		{
+			int32 Quantized = 0;
+			if (!Reader.Read(Quantized))
+			{
+				return EVistarDecodeResult::Malformed;
+			}
+			Value = Quantized / (Index == 2 ? AltitudeScale : LatLonScale);
+		}
+		else if (!Reader.Read(Value))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+	}
+	OutMessage.SetComponents(Components);
+	return EVistarDecodeResult::Ok;
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarJsonDecoder.h"
+
+/**
+ * Control messages that carry no entity (the JSON {"STREAM":"Event","TYPE":...} messages)
+ */
+enum class EVistarControl : uint8
+{
+	None	= 0,
+	Start	= 1,
+	Stop	= 2,
+};
+
+/**
+ * Compact binary encoding of the VISTAR message types, see README_Network.md for the layout
+ * A datagram whose first byte is Magic is binary, JSON always starts with '{' or whitespace
+ */
+class VISTAR_API FVistarBinaryCodec
+{
+public:
+	static constexpr uint8 Magic = 0xB5;
+	static constexpr uint8 Version = 1;
+
+	enum class EType : uint8
+	{
+		Entity	= 1,
+		Control	= 2,
+		// Update carrying only the changed EVistarComponents of an entity
+		Delta	= 3,
+	};
+
+	struct FOptions
+	{
+		// Lat/lon as 1e-7 degree and altitude as cm in int32 instead of doubles
+		bool bQuantizePosition = false;
+		// Angles as int16 over 360 degrees (~0.0055 degree steps) instead of doubles
+		bool bQuantizeAngles = false;
+	};
+
+	static bool IsBinary(const uint8* Data, int32 Size) { return Size > 0 && Data[0] == Magic; }
+
+	// Append one encoded message to OutBuffer
+	static void EncodeEntity(const FVistarEntityUpdate& Message, const FOptions& Options, TArray<uint8>& OutBuffer);
+	static void EncodeControl(EVistarControl Control, TArray<uint8>& OutBuffer);
+
+	// Only the components of Message.GetComponents(), decodes to an Update with DeltaMask set
+	static void EncodeDelta(const FVistarEntityUpdate& Message, const FOptions& Options, TArray<uint8>& OutBuffer);
+
+	// Control messages decode to Ignored, nothing in them applies to the scene
+	static EVistarDecodeResult Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage);
+
+	// Entity ID bytes of an entity message without decoding the rest, false for control messages
+	static bool PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength);
+
+	// STREAM of an entity message without decoding the rest, false for control messages
+	static bool PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream);
+
+	// Size of the encoded entity message without building it
+	static int32 GetEncodedSize(const FVistarEntityUpdate& Message, const FOptions& Options);
+	static int32 GetEncodedDeltaSize(const FVistarEntityUpdate& Message, const FOptions& Options);
+
+private:
+	static EVistarDecodeResult DecodeDelta(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage);
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarBundle.h"
+
+FVistarBundler::FVistarBundler(int32 InMaxDatagramSize, FSendFunction InSend)
+	: Count(0)
+	, MaxDatagramSize(FMath::Clamp(InMaxDatagramSize, FVistarBundle::HeaderSize + FVistarBundle::EntryHeaderSize + 1, 65507))
+	, Send(MoveTemp(InSend))
+{
+	Buffer.Reserve(MaxDatagramSize);
+}
+
+void FVistarBundler::Add(const uint8* Data, int32 Size)
+{
+	// Too big to share a datagram, goes out on its own
+	if (Size > MaxDatagramSize - FVistarBundle::HeaderSize - FVistarBundle::EntryHeaderSize)
+	{
+		Flush();
+		Send(Data, Size);
+		return;
+	}
+
+	if (Count > 0 && Buffer.Num() + FVistarBundle::EntryHeaderSize + Size > MaxDatagramSize)
+	{
+		Flush();
+	}
+
+	if (Count == 0)
+	{
+		Buffer.Reset();
+		Buffer.AddZeroed(FVistarBundle::HeaderSize);
+		Buffer[0] = FVistarBundle::Magic;
+		Buffer[1] = FVistarBundle::Version;
+	}
+
+	const uint16 Length = static_cast<uint16>(Size);
+	const int32 Offset = Buffer.AddUninitialized(FVistarBundle::EntryHeaderSize);
+	FMemory::Memcpy(Buffer.GetData() + Offset, &Length, sizeof(Length));
+	Buffer.Append(Data, Size);
+	++Count;
+}
+
+void FVistarBundler::Flush()
+{
+	if (Count == 0)
+	{
+		return;
+	}
+
+	if (Count == 1)
+	{
+		const int32 Offset = FVistarBundle::HeaderSize + FVistarBundle::EntryHeaderSize;
+		Send(Buffer.GetData() + Offset, Buffer.Num() - Offset);
+	}
+	else
+	{
+		const uint16 BundleCount = static_cast<uint16>(Count);
+		FMemory::Memcpy(Buffer.GetData() + 2, &BundleCount, sizeof(BundleCount));
+		Send(Buffer.GetData(), Buffer.Num());
+	}
+
+	Buffer.Reset();
+	Count = 0;
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bundle frame packing many VISTAR messages into one datagram
+ *   u8 Magic (0xB6), u8 Version, u16 Count, then Count x (u16 Length, Length bytes)
+ * Every bundled message is a complete JSON or binary message
+ */
+class VISTAR_API FVistarBundle
+{
+public:
+	static constexpr uint8 Magic = 0xB6;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 4;
+	static constexpr int32 EntryHeaderSize = 2;
+
+	static bool IsBundle(const uint8* Data, int32 Size) { return Size >= HeaderSize && Data[0] == Magic; }
+
+	// Calls Visitor(Data, Size) for every bundled message. Returns false on a malformed frame,
+	// the messages in front of the damage have been visited by then
+	template <typename FVisitor>
+	static bool ForEachMessage(const uint8* Data, int32 Size, FVisitor&& Visitor)
+	{
+		if (!IsBundle(Data, Size) || Data[1] != Version)
+		{
+			return false;
+		}
+
+		uint16 Count = 0;
+		FMemory::Memcpy(&Count, Data + 2, sizeof(Count));
+
+		int32 Offset = HeaderSize;
+		for (uint16 i = 0; i < Count; ++i)
+		{
+			if (Size - Offset < EntryHeaderSize)
+			{
+				return false;
+			}
+			uint16 Length = 0;
+			FMemory::Memcpy(&Length, Data + Offset, sizeof(Length));
+			Offset += EntryHeaderSize;
+
+			if (Size - Offset < Length)
+			{
+				return false;
+			}
+			Visitor(Data + Offset, static_cast<int32>(Length));
+			Offset += Length;
+		}
+		return Offset == Size;
+	}
+};
+
+/**
+ * Outbound side of FVistarBundle
+ * Packs messages until the next one would exceed MaxDatagramSize, then hands the datagram to Send
+ * A flush holding a single message sends it bare so peers without bundle support still understand it
+ */
+class VISTAR_API FVistarBundler
+{
+public:
+	using FSendFunction = TFunction<void(const uint8* /*Data*/, int32 /*Size*/)>;
+
+	FVistarBundler(int32 InMaxDatagramSize, FSendFunction InSend);
+
+	void Add(const uint8* Data, int32 Size);
+
+	void Flush();
+
+	int32 GetMaxDatagramSize() const { return MaxDatagramSize; }
+
+private:
+	TArray<uint8> Buffer;
+	int32 Count;
+	int32 MaxDatagramSize;
+	FSendFunction Send;
+};
@@ -0,0 +1,440 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarCapture.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Algo/BinarySearch.h"
+
+namespace
+{
+	const uint8 CaptureMagic[8] = { 'V', 'S', 'T', 'R', 'C', 'A', 'P', '1' };
+
+	// Chunks go to disk when full or after a second, whichever comes first
+	constexpr int32 ChunkSize = 256 * 1024;
+	constexpr int64 ChunkMaxAgeUs = 1000000;
+	// 16 MB waiting for the disk, past that records are dropped rather than growing without bound
+	constexpr int32 MaxPendingChunks = 64;
+
+	// Anything larger is a corrupt record, no datagram gets near it
+	constexpr uint32 MaxRecordSize = 65536;
+
+	// One index entry per second of capture
+	constexpr int64 IndexIntervalUs = 1000000;
+
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+}
+
+void FVistarCapture::WriteFileHeader(uint8* Out)
+{
+	FMemory::Memcpy(Out, CaptureMagic, sizeof(CaptureMagic));
+	WriteAt<uint32>(Out, 8, Version);
+	WriteAt<uint32>(Out, 12, 0);
+}
+
+bool FVistarCapture::IsValidFileHeader(const uint8* Data)
+{
+	uint32 FileVersion = 0;
+	FMemory::Memcpy(&FileVersion, Data + 8, sizeof(FileVersion));
+	return FMemory::Memcmp(Data, CaptureMagic, sizeof(CaptureMagic)) == 0 && FileVersion == Version;
+}
+
+FString FVistarCapture::ResolvePath(const FString& Path)
+{
+	return FPaths::IsRelative(Path) ? FPaths::ProjectSavedDir() / TEXT("Captures") / Path : Path;
+}
+
+FVistarCaptureWriter::FVistarCaptureWriter(const FString& InPath)
+	: Path(FVistarCapture::ResolvePath(InPath))
+	, File(nullptr)
+	, ChunkStartUs(0)
+	, PendingChunks(0)
+	, Thread(nullptr)
+	, WakeEvent(nullptr)
+	, bStop(false)
+	, Records(0)
+	, BytesWritten(0)
+	, Dropped(0)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+	File = IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_AllowRead);
+	if (!File)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarCapture: cannot create %s"), *Path);
+		return;
+	}
+
+	uint8 Header[FVistarCapture::FileHeaderSize];
+	FVistarCapture::WriteFileHeader(Header);
+	File->Serialize(Header, sizeof(Header));
+
+	Chunk.Reserve(ChunkSize);
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("VistarCaptureWriter"), 0, TPri_BelowNormal);
+	UE_LOG(LogTemp, Log, TEXT("VistarCapture: recording to %s"), *Path);
+}
+
+FVistarCaptureWriter::~FVistarCaptureWriter()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WakeEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = nullptr;
+	}
+
+	if (File)
+	{
+		// Both threads are done, the tail chunk can go straight out from here
+		if (Chunk.Num() > 0)
+		{
+			Full.Enqueue(MoveTemp(Chunk));
+		}
+		WriteChunks();
+		File->Close();
+		delete File;
+		File = nullptr;
+
+		UE_LOG(LogTemp, Log, TEXT("VistarCapture: %llu datagrams, %llu bytes written to %s, %llu dropped"),
+			GetRecordCount(), GetBytesWritten(), *Path, GetDroppedCount());
+	}
+}
+
+void FVistarCaptureWriter::Stop()
+{
+	bStop = true;
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void FVistarCaptureWriter::Append(const uint8* Data, int32 Size, int64 ReceiveTimeUs)
+{
+	if (!File)
+	{
+		return;
+	}
+
+	if (Chunk.Num() + FVistarCapture::RecordHeaderSize + Size > ChunkSize && Chunk.Num() > 0)
+	{
+		Submit();
+	}
+	if (PendingChunks.load(std::memory_order_relaxed) >= MaxPendingChunks)
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (Chunk.Num() == 0)
+	{
+		ChunkStartUs = ReceiveTimeUs;
+	}
+
+	const int32 Offset = Chunk.AddUninitialized(FVistarCapture::RecordHeaderSize + Size);
+	uint8* Out = Chunk.GetData() + Offset;
+	WriteAt<int64>(Out, 0, ReceiveTimeUs);
+	WriteAt<uint32>(Out, 8, static_cast<uint32>(Size));
+	FMemory::Memcpy(Out + FVistarCapture::RecordHeaderSize, Data, Size);
+	Records.fetch_add(1, std::memory_order_relaxed);
+
+	// Slow traffic still reaches the disk within about a second
+	if (ReceiveTimeUs - ChunkStartUs >= ChunkMaxAgeUs)
+	{
+		Submit();
+	}
+}
+
+void FVistarCaptureWriter::Submit()
+{
+	PendingChunks.fetch_add(1, std::memory_order_relaxed);
+	Full.Enqueue(MoveTemp(Chunk));
+
+	if (TOptional<TArray<uint8>> Recycled = Empty.Dequeue())
+	{
+		Chunk = MoveTemp(Recycled.GetValue());
+	}
+	else
+	{
+		Chunk = TArray<uint8>();
+		Chunk.Reserve(ChunkSize);
+	}
+	WakeEvent->Trigger();
+}
+
+uint32 FVistarCaptureWriter::Run()
+{
+	while (!bStop)
+	{
+		WriteChunks();
+		WakeEvent->Wait(FTimespan::FromMilliseconds(100));
+	}
+	WriteChunks();
+	return 0;
+}
+
+void FVistarCaptureWriter::WriteChunks()
+{
+	bool bWrote = false;
+	while (TOptional<TArray<uint8>> Written = Full.Dequeue())
+	{
+		TArray<uint8>& Data = Written.GetValue();
+		File->Serialize(Data.GetData(), Data.Num());
+		BytesWritten.fetch_add(Data.Num(), std::memory_order_relaxed);
+		PendingChunks.fetch_sub(1, std::memory_order_relaxed);
+
+		Data.Reset();
+		Empty.Enqueue(MoveTemp(Data));
+		bWrote = true;
+	}
+
+	// Keep the file readable up to the last chunk while the capture is still running
+	if (bWrote)
+	{
+		File->Flush();
+	}
+}
+
+FVistarCaptureReader::FVistarCaptureReader(const FString& Path)
+	: File(nullptr)
+	, ValidEnd(0)
+	, FirstTimeUs(0)
+	, LastTimeUs(0)
+	, RecordCount(0)
+{
+	const FString FullPath = FVistarCapture::ResolvePath(Path);
+	File = IFileManager::Get().CreateFileReader(*FullPath);
+	if (!File)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarCapture: cannot open %s"), *FullPath);
+		return;
+	}
+
+	uint8 Header[FVistarCapture::FileHeaderSize];
+	if (File->TotalSize() < FVistarCapture::FileHeaderSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarCapture: %s is not a capture file"), *FullPath);
+		delete File;
+		File = nullptr;
+		return;
+	}
+	File->Serialize(Header, sizeof(Header));
+	if (!FVistarCapture::IsValidFileHeader(Header))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarCapture: %s is not a version %u capture file"), *FullPath, FVistarCapture::Version);
+		delete File;
+		File = nullptr;
+		return;
+	}
+
+	// One pass over the record headers for the duration and the seek index
+	const int64 FileSize = File->TotalSize();
+	int64 Offset = FVistarCapture::FileHeaderSize;
+	while (Offset + FVistarCapture::RecordHeaderSize <= FileSize)
+	{
+		File->Seek(Offset);
+		int64 TimeUs = 0;
+		uint32 Size = 0;
+		if (!ReadRecordHeader(TimeUs, Size) || Offset + FVistarCapture::RecordHeaderSize + Size > FileSize)
+		{
+			// Cut short while recording
+			break;
+		}
+
+		if (RecordCount == 0)
+		{
+			FirstTimeUs = TimeUs;
+		}
+		if (Index.Num() == 0 || TimeUs - Index.Last().TimeUs >= IndexIntervalUs)
+		{
+			Index.Add({ TimeUs, Offset });
+		}
+		LastTimeUs = TimeUs;
+		++RecordCount;
+		Offset += FVistarCapture::RecordHeaderSize + Size;
+	}
+	ValidEnd = Offset;
+
+	File->Seek(FVistarCapture::FileHeaderSize);
+	UE_LOG(LogTemp, Log, TEXT("VistarCapture: %s, %llu datagrams over %.1f s"), *FullPath, RecordCount, GetDurationSeconds());
+}
+
+FVistarCaptureReader::~FVistarCaptureReader()
+{
+	delete File;
+}
+
+bool FVistarCaptureReader::ReadRecordHeader(int64& OutTimeUs, uint32& OutSize)
+{
+	uint8 Header[FVistarCapture::RecordHeaderSize];
+	File->Serialize(Header, sizeof(Header));
+	FMemory::Memcpy(&OutTimeUs, Header, sizeof(OutTimeUs));
+	FMemory::Memcpy(&OutSize, Header + 8, sizeof(OutSize));
+	return !File->IsError() && OutSize <= MaxRecordSize;
+}
+
+bool FVistarCaptureReader::ReadNext(const uint8*& OutData, int32& OutSize, int64& OutReceiveTimeUs)
+{
+	if (!File || File->Tell() + FVistarCapture::RecordHeaderSize > ValidEnd)
+	{
+		return false;
+	}
+
+	uint32 Size = 0;
+	if (!ReadRecordHeader(OutReceiveTimeUs, Size))
+	{
+		return false;
+	}
+	Buffer.SetNumUninitialized(Size, EAllowShrinking::No);
+	File->Serialize(Buffer.GetData(), Size);
+
+	OutData = Buffer.GetData();
+	OutSize = static_cast<int32>(Size);
+	return true;
+}
+
+void FVistarCaptureReader::Seek(double Seconds)
+{
+	if (!File || Index.Num() == 0)
+	{
+		return;
+	}
+
+	// Last indexed record at or before the target, then walk forward record by record
+	const int64 TargetUs = FirstTimeUs + static_cast<int64>(FMath::Max(Seconds, 0.0) * 1000000.0);
+	int32 Entry = Algo::UpperBoundBy(Index, TargetUs, &FIndexEntry::TimeUs) - 1;
+	File->Seek(Index[FMath::Max(Entry, 0)].Offset);
+
+	while (File->Tell() + FVistarCapture::RecordHeaderSize <= ValidEnd)
+	{
+		const int64 RecordStart = File->Tell();
+		int64 TimeUs = 0;
+		uint32 Size = 0;
+		if (!ReadRecordHeader(TimeUs, Size) || TimeUs >= TargetUs)
+		{
+			File->Seek(RecordStart);
+			return;
+		}
+		File->Seek(RecordStart + FVistarCapture::RecordHeaderSize + Size);
+	}
+}
+
+FVistarReplayer::FVistarReplayer(const FString& Path, FDeliver InDeliver, float InSpeed, bool bInLoop)
+	: Reader(Path)
+	, Deliver(MoveTemp(InDeliver))
+	, bLoop(bInLoop)
+	, Thread(nullptr)
+	, bStop(false)
+	, bFinished(false)
+	, Speed(FMath::Max(InSpeed, 0.0f))
+	, SeekRequest(-1.0)
+	, Position(0.0)
+	, Delivered(0)
+	, DeliveredBytes(0)
+{
+	if (Reader.IsOpen())
+	{
+		Thread = FRunnableThread::Create(this, TEXT("VistarReplay"), 0, TPri_Normal);
+	}
+}
+
+FVistarReplayer::~FVistarReplayer()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+uint32 FVistarReplayer::Run()
+{
+	const uint8* Data = nullptr;
+	int32 Size = 0;
+	int64 TimeUs = 0;
+
+	// Wall clock and capture time of the record playback was last aligned on
+	double WallBase = 0.0;
+	int64 CaptureBaseUs = 0;
+	bool bRebase = true;
+	float CurrentSpeed = Speed.load();
+
+	while (!bStop)
+	{
+		const double SeekTo = SeekRequest.exchange(-1.0);
+		if (SeekTo >= 0.0)
+		{
+			Reader.Seek(SeekTo);
+			bRebase = true;
+		}
+		if (Speed.load() != CurrentSpeed)
+		{
+			CurrentSpeed = Speed.load();
+			bRebase = true;
+		}
+
+		if (!Reader.ReadNext(Data, Size, TimeUs))
+		{
+			if (bLoop && Reader.GetRecordCount() > 0)
+			{
+				Reader.Seek(0.0);
+				bRebase = true;
+				continue;
+			}
+			break;
+		}
+
+		if (bRebase)
+		{
+			WallBase = FPlatformTime::Seconds();
+			CaptureBaseUs = TimeUs;
+			bRebase = false;
+		}
+
+		if (CurrentSpeed > 0.0f)
+		{
+			// Sleep in short steps so Stop, Seek and speed changes are picked up promptly
+			const double Due = WallBase + (TimeUs - CaptureBaseUs) / 1000000.0 / CurrentSpeed;
+			for (double Wait = Due - FPlatformTime::Seconds(); Wait > 0.0; Wait = Due - FPlatformTime::Seconds())
+			{
+				if (bStop || SeekRequest.load() >= 0.0 || Speed.load() != CurrentSpeed)
+				{
+					break;
+				}
+				if (Wait > 0.002)
+				{
+					FPlatformProcess::Sleep(static_cast<float>(FMath::Min(Wait - 0.001, 0.05)));
+				}
+				else
+				{
+					FPlatformProcess::YieldThread();
+				}
+			}
+			// A seek throws away the record that was waiting
+			if (bStop || SeekRequest.load() >= 0.0)
+			{
+				continue;
+			}
+		}
+
+		Deliver(Data, Size);
+		Position.store((TimeUs - Reader.GetFirstTimeUs()) / 1000000.0, std::memory_order_relaxed);
+		Delivered.fetch_add(1, std::memory_order_relaxed);
+		DeliveredBytes.fetch_add(Size, std::memory_order_relaxed);
+	}
+
+	bFinished = true;
+	UE_LOG(LogTemp, Log, TEXT("VistarReplay: stopped at %.1f s after %llu datagrams"), GetPosition(), GetDeliveredCount());
+	return 0;
+}
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Containers/SpscQueue.h"
+#include <atomic>
+
+/**
+ * Capture file of received datagrams
+ *   File header: 8 byte magic "VSTRCAP1", u32 Version, u32 Reserved
+ *   Records:     u64 ReceiveTimeUs (local monotonic clock), u32 Size, Size bytes of datagram
+ * Records are only ever appended, a capture cut short by a crash is valid up to its last whole record.
+ */
+class VISTAR_API FVistarCapture
+{
+public:
+	static constexpr int32 FileHeaderSize = 16;
+	static constexpr int32 RecordHeaderSize = 12;
+	static constexpr uint32 Version = 1;
+
+	static void WriteFileHeader(uint8* Out);
+	static bool IsValidFileHeader(const uint8* Data);
+
+	// Relative paths are placed under Saved/Captures
+	static FString ResolvePath(const FString& Path);
+};
+
+/**
+ * Appends datagrams to a capture file without touching the disk on the calling thread
+ * The receiver thread copies each datagram into a chunk, full chunks go to a writer thread through
+ * a lock-free queue and come back empty for reuse.
+ */
+class VISTAR_API FVistarCaptureWriter : public FRunnable
+{
+public:
+	// Check IsOpen() afterwards
+	explicit FVistarCaptureWriter(const FString& InPath);
+	// Writes out what is still buffered, then joins the thread
+	virtual ~FVistarCaptureWriter();
+
+	bool IsOpen() const { return File != nullptr; }
+
+	// Receiver thread
+	void Append(const uint8* Data, int32 Size, int64 ReceiveTimeUs);
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	uint64 GetRecordCount() const { return Records.load(std::memory_order_relaxed); }
+	uint64 GetBytesWritten() const { return BytesWritten.load(std::memory_order_relaxed); }
+	// Records lost because the disk could not keep up
+	uint64 GetDroppedCount() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+	// Receiver thread, hands the current chunk to the writer
+	void Submit();
+	void WriteChunks();
+
+	FString Path;
+	FArchive* File;
+
+	// Filled by the receiver thread
+	TArray<uint8> Chunk;
+	int64 ChunkStartUs;
+
+	// Receiver thread -> writer thread and back
+	TSpscQueue<TArray<uint8>> Full;
+	TSpscQueue<TArray<uint8>> Empty;
+	std::atomic<int32> PendingChunks;
+
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	std::atomic<bool> bStop;
+
+	std::atomic<uint64> Records;
+	std::atomic<uint64> BytesWritten;
+	std::atomic<uint64> Dropped;
+};
+
+/**
+ * Sequential reader of a capture file with time-based seeking
+ * Opening scans the record headers once and keeps a coarse time index, so a seek reads at most
+ * one second of records. Single threaded.
+ */
+class VISTAR_API FVistarCaptureReader
+{
+public:
+	explicit FVistarCaptureReader(const FString& Path);
+	~FVistarCaptureReader();
+
+	bool IsOpen() const { return File != nullptr; }
+
+	// Next record, false at the end of the file. OutData stays valid until the next call
+	bool ReadNext(const uint8*& OutData, int32& OutSize, int64& OutReceiveTimeUs);
+
+	// Positions on the first record at or after Seconds from the start of the capture
+	void Seek(double Seconds);
+
+	double GetDurationSeconds() const { return (LastTimeUs - FirstTimeUs) / 1000000.0; }
+	int64 GetFirstTimeUs() const { return FirstTimeUs; }
+	uint64 GetRecordCount() const { return RecordCount; }
+
+private:
+	bool ReadRecordHeader(int64& OutTimeUs, uint32& OutSize);
+
+	struct FIndexEntry
+	{
+		int64 TimeUs;
+		int64 Offset;
+	};
+
+	FArchive* File;
+	// End of the last whole record
+	int64 ValidEnd;
+	TArray<FIndexEntry> Index;
+	TArray<uint8> Buffer;
+
+	int64 FirstTimeUs;
+	int64 LastTimeUs;
+	uint64 RecordCount;
+};
+
+/**
+ * Plays a capture file back into an FOnUdpDataReceived callback on its own thread, in place of
+ * the socket receiver, so replayed traffic takes exactly the live decode and apply path.
+ * Speed 1 keeps the recorded timing, N plays N times faster, 0 as fast as possible.
+ */
+class VISTAR_API FVistarReplayer : public FRunnable
+{
+public:
+	using FDeliver = TFunction<void(const uint8* /*Data*/, int32 /*Size*/)>;
+
+	// Check IsOpen() afterwards
+	FVistarReplayer(const FString& Path, FDeliver InDeliver, float InSpeed, bool bInLoop);
+	virtual ~FVistarReplayer();
+
+	bool IsOpen() const { return Reader.IsOpen(); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { bStop = true; }
+
+	// Any thread, applied before the next record
+	void Seek(double Seconds) { SeekRequest.store(Seconds); }
+	void SetSpeed(float InSpeed) { Speed.store(FMath::Max(InSpeed, 0.0f)); }
+
+	// Capture time of the last delivered record, in seconds from the start
+	double GetPosition() const { return Position.load(std::memory_order_relaxed); }
+	double GetDuration() const { return Reader.GetDurationSeconds(); }
+	uint64 GetDeliveredCount() const { return Delivered.load(std::memory_order_relaxed); }
+	uint64 GetDeliveredBytes() const { return DeliveredBytes.load(std::memory_order_relaxed); }
+	bool IsFinished() const { return bFinished.load(); }
+
+private:
+	FVistarCaptureReader Reader;
+	FDeliver Deliver;
+	bool bLoop;
+
+	FRunnableThread* Thread;
+	std::atomic<bool> bStop;
+	std::atomic<bool> bFinished;
+	std::atomic<float> Speed;
+	// Seconds from the start, negative when no seek is pending
+	std::atomic<double> SeekRequest;
+
+	std::atomic<double> Position;
+	std::atomic<uint64> Delivered;
+	std::atomic<uint64> DeliveredBytes;
+};
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarCoalescingTable.h"
+#include "VistarSequence.h"
+
+void FVistarCoalescingTable::Add(FVistarEntityUpdate&& Update)
+{
+	if (int32* SlotIndex = IdToSlot.Find(Update.Id))
+	{
+		FVistarEntityUpdate& Pending = Slots[*SlotIndex];
+
+		// A reordered datagram must not overwrite the newer state already pending
+		if (bDropStale && IsStale(Update.Meta, Pending.Meta))
+		{
+			++StaleCount;
+			return;
+		}
+		Pending.Meta = Update.Meta;
+
+		// Merge per field so an update carrying only SLEW does not discard a pending LOCATION
+		Pending.MergeState(Update);
+		++CollapsedCount;
+		return;
+	}
+
+	IdToSlot.Add(Update.Id, Slots.Num());
+	Slots.Add(MoveTemp(Update));
+}
+
+bool FVistarCoalescingTable::IsStale(const FVistarDatagramMeta& Update, const FVistarDatagramMeta& Latest)
+{
+	if (!Update.bHasSequence || !Latest.bHasSequence || Update.SourceId != Latest.SourceId)
+	{
+		return false;
+	}
+
+	// Messages of one bundle share a sequence and stay in order, a big jump back is a restarted sender
+	const uint32 Behind = Latest.Sequence - Update.Sequence;
+	return Behind != 0 && Behind < FVistarSequence::RestartDistance;
+}
+
+void FVistarCoalescingTable::Remove(const FVistarEntityId& Id)
+{
+	int32 SlotIndex = INDEX_NONE;
+	if (IdToSlot.RemoveAndCopyValue(Id, SlotIndex))
+	{
+		Slots[SlotIndex].Stream = EVistarStream::None;
+	}
+}
+
+FVistarEntityUpdate* FVistarCoalescingTable::NextPending()
+{
+	while (Head < Slots.Num())
+	{
+		FVistarEntityUpdate& Pending = Slots[Head++];
+		if (Pending.Stream != EVistarStream::None)
+		{
+			IdToSlot.Remove(Pending.Id);
+			return &Pending;
+		}
+	}
+	return nullptr;
+}
+
+void FVistarCoalescingTable::FinishFlush()
+{
+	if (Head >= Slots.Num())
+	{
+		// Everything went out, keep the allocation for the next frame
+		Slots.Reset();
+		Head = 0;
+	}
+	else if (Head > 0)
+	{
+		// Over budget, compact the leftovers to the front and re-index them
+		Slots.RemoveAt(0, Head, EAllowShrinking::No);
+		Head = 0;
+		for (int32 i = 0; i < Slots.Num(); ++i)
+		{
+			if (Slots[i].Stream != EVistarStream::None)
+			{
+				IdToSlot[Slots[i].Id] = i;
+			}
+		}
+	}
+}
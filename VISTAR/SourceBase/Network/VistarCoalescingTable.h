@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * Latest-state-wins table for entity state updates
+ * Holds at most one pending update per entity ID, in order of first arrival, so an entity
+ * updated several times between frames is applied once with its newest LOCATION/ROTATION/SLEW
+ * Game thread only
+ */
+class VISTAR_API FVistarCoalescingTable
+{
+public:
+	// Stores the update, merging it over any older pending update for the same entity
+	void Add(FVistarEntityUpdate&& Update);
+
+	// Forget the pending update of an entity, used when it is deleted
+	void Remove(const FVistarEntityId& Id);
+
+	// Move up to MaxCount pending updates into OutUpdates, oldest entity first (0 = no limit)
+	// Whatever is left over stays pending and keeps coalescing with later traffic.
+	// Any allocator works, the game thread flushes into its per-frame FMemStack arena
+	template <typename AllocatorType>
+	int32 Flush(TArray<FVistarEntityUpdate, AllocatorType>& OutUpdates, int32 MaxCount)
+	{
+		int32 Flushed = 0;
+		while (MaxCount <= 0 || Flushed < MaxCount)
+		{
+			FVistarEntityUpdate* Pending = NextPending();
+			if (!Pending)
+			{
+				break;
+			}
+			OutUpdates.Add(MoveTemp(*Pending));
+			++Flushed;
+		}
+		FinishFlush();
+		return Flushed;
+	}
+
+	int32 Num() const { return IdToSlot.Num(); }
+
+	// Heap bytes held, steady once the entity count has settled
+	SIZE_T GetAllocatedSize() const { return Slots.GetAllocatedSize() + IdToSlot.GetAllocatedSize(); }
+
+	// Updates that were absorbed by a newer one for the same entity
+	uint64 GetCollapsedCount() const { return CollapsedCount; }
+
+	// Off keeps every update in arrival order regardless of its sequence
+	void SetDropStale(bool bInDropStale) { bDropStale = bInDropStale; }
+
+	// Updates dropped because a later datagram already updated the same entity
+	uint64 GetStaleCount() const { return StaleCount; }
+
+	// True when Update comes from an earlier datagram of the same source than Latest
+	static bool IsStale(const FVistarDatagramMeta& Update, const FVistarDatagramMeta& Latest);
+
+private:
+	// Next slot to flush, already unmapped, or nullptr when none are left
+	FVistarEntityUpdate* NextPending();
+
+	// Drop flushed slots and re-index the leftovers
+	void FinishFlush();
+
+	// Pending updates, a slot whose Stream is None was removed
+	TArray<FVistarEntityUpdate> Slots;
+	TMap<FVistarEntityId, int32> IdToSlot;
+
+	// First slot that has not been flushed yet
+	int32 Head = 0;
+
+	uint64 CollapsedCount = 0;
+	uint64 StaleCount = 0;
+	bool bDropStale = true;
+};
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarDecodeWorker.h"
+#include "VistarIngestPipeline.h"
+
+FVistarDecodeWorker::FVistarDecodeWorker(int32 InIndex, uint32 InputCapacity, uint32 OutputCapacity, int32 SlotSize, EThreadPriority Priority,
+	const FVistarSourceTransform& InTransform)
+	// One slot per queue entry
+	: Pool(InputCapacity, SlotSize)
+	, Input(InputCapacity + 1)
+	, ControlQueued(0)
+	, Output(OutputCapacity)
+	, Transform(InTransform)
+	, Index(InIndex)
+	, Thread(nullptr)
+	, WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
+	, bStop(false)
+	, bIdle(false)
+	, Decoded(0)
+	, Dropped(0)
+	, Pooled(0)
+	, HeapFallbacks(0)
+{
+	// Start the thread last, Run() relies on the queues above
+	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("VistarDecodeWorker%d"), Index), 0, Priority);
+}
+
+FVistarDecodeWorker::~FVistarDecodeWorker()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+
+	// Heap fallbacks still queued at shutdown
+	FRawMessage Raw;
+	while (Input.Dequeue(Raw))
+	{
+		FMemory::Free(Raw.Heap);
+	}
+	while (TOptional<FRawMessage> Control = ControlInput.Dequeue())
+	{
+		FMemory::Free(Control->Heap);
+	}
+}
+
+void FVistarDecodeWorker::Stop()
+{
+	bStop = true;
+	WakeEvent->Trigger();
+}
+
+bool FVistarDecodeWorker::Push(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, EVistarLane Lane)
+{
+	const bool bControl = Lane == EVistarLane::Control;
+
+	// Only this thread fills the queue, so it cannot turn full between the check and the enqueue
+	if (!bControl && Input.IsFull())
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	FRawMessage Raw;
+	Raw.Size = Size;
+	Raw.Meta = Meta;
+	if (Size <= Pool.GetSlotSize())
+	{
+		// The ring rounds its capacity up, so the slots can run out just before it is full
+		Raw.Slot = Pool.Acquire(Size);
+	}
+	if (Raw.Slot != FVistarMessagePool::InvalidSlot)
+	{
+		FMemory::Memcpy(Pool.GetData(Raw.Slot), Data, Size);
+		Pooled.fetch_add(1, std::memory_order_relaxed);
+	}
+	else if (Size > Pool.GetSlotSize() || bControl)
+	{
+		// Control messages take the heap rather than be dropped when updates hold every slot
+		Raw.Heap = static_cast<uint8*>(FMemory::Malloc(Size));
+		FMemory::Memcpy(Raw.Heap, Data, Size);
+		HeapFallbacks.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (bControl)
+	{
+		ControlQueued.fetch_add(1, std::memory_order_relaxed);
+		ControlInput.Enqueue(Raw);
+	}
+	else
+	{
+		Input.Enqueue(Raw);
+	}
+
+	// A busy worker finds the message on its own, only a sleeping one needs the syscall. The fence pairs
+	// with the one in Run: the queues only order acquire/release, so without it the load of bIdle could
+	// move ahead of the enqueue and miss a worker that is just going to sleep
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (bIdle.load(std::memory_order_relaxed))
+	{
+		WakeEvent->Trigger();
+	}
+	return true;
+}
+
+uint32 FVistarDecodeWorker::Run()
+{
+	LLM_SCOPE_BYTAG(VistarIngest);
+
+	// Updates are decoded in short runs so a control message waits for at most one run
+	constexpr int32 BulkRun = 64;
+
+	FRawMessage Raw;
+	while (!bStop)
+	{
+		bool bMore = true;
+		while (bMore)
+		{
+			while (TOptional<FRawMessage> Control = ControlInput.Dequeue())
+			{
+				ControlQueued.fetch_sub(1, std::memory_order_relaxed);
+				Decode(Control.GetValue());
+			}
+
+			int32 Taken = 0;
+			while (Taken < BulkRun && Input.Dequeue(Raw))
+			{
+				Decode(Raw);
+				++Taken;
+			}
+			bMore = Taken == BulkRun;
+		}
+
+		// Idle first, then the last look at the queues, then sleep. A concurrent Push either lands before
+		// that look or sees bIdle and signals, the event stays set until the Wait consumes it, so no
+		// timeout is needed. Stop signals too. The fence keeps the look from moving ahead of the store
+		bIdle.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (Input.IsEmpty() && ControlInput.IsEmpty() && !bStop)
+		{
+			WakeEvent->Wait();
+		}
+		bIdle.store(false, std::memory_order_relaxed);
+	}
+	return 0;
+}
+
+void FVistarDecodeWorker::Decode(const FRawMessage& Raw)
+{
+	const uint8* Data = Raw.Heap ? Raw.Heap : Pool.GetData(Raw.Slot);
+	FVistarIngestPipeline::DecodeMessage(Data, Raw.Size, Raw.Meta, Transform, Output, Counters);
+
+	if (Raw.Heap)
+	{
+		FMemory::Free(Raw.Heap);
+	}
+	else
+	{
+		Pool.Release(Raw.Slot);
+	}
+	Decoded.fetch_add(1, std::memory_order_relaxed);
+}
+
+FVistarDecodeWorkerStats FVistarDecodeWorker::GetStats() const
+{
+	FVistarDecodeWorkerStats Stats;
+	Stats.ControlDepth = ControlQueued.load(std::memory_order_relaxed);
+	Stats.QueueDepth = Input.Count() + Stats.ControlDepth;
+	Stats.OutputDepth = Output.Num();
+	Stats.Decoded = Decoded.load(std::memory_order_relaxed);
+	Stats.Dropped = Dropped.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+void FVistarDecodeWorker::AccumulateAllocStats(FVistarIngestAllocStats& OutStats) const
+{
+	OutStats.PooledMessages += Pooled.load(std::memory_order_relaxed);
+	OutStats.PoolHeapFallbacks += HeapFallbacks.load(std::memory_order_relaxed);
+	OutStats.DomDecodes += Counters.DomDecodes.load(std::memory_order_relaxed);
+	OutStats.PointArrays += Counters.PointArrays.load(std::memory_order_relaxed);
+}
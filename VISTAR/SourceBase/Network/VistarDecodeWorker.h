@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Containers/CircularQueue.h"
+#include "Containers/SpscQueue.h"
+#include "VistarIngestQueue.h"
+#include "VistarMessagePool.h"
+#include <atomic>
+
+/**
+ * Counters of one decode worker, read from the game thread
+ */
+struct FVistarDecodeWorkerStats
+{
+	// Raw messages waiting to be decoded
+	uint32 QueueDepth = 0;
+	// Of those, control lane messages
+	uint32 ControlDepth = 0;
+	// Decoded messages waiting for the game thread
+	uint32 OutputDepth = 0;
+	uint64 Decoded = 0;
+	// Raw messages dropped because the worker fell behind
+	uint64 Dropped = 0;
+};
+
+/**
+ * One decode thread of FVistarIngestPipeline
+ * The receiver thread copies raw messages into slots of the worker's pool, the worker decodes them
+ * into its own output queue which the game thread drains. Every queue is single-producer/single-consumer.
+ * Control lane messages have their own unbounded input and are decoded ahead of waiting updates.
+ */
+class VISTAR_API FVistarDecodeWorker : public FRunnable
+{
+public:
+	// InTransform belongs to the owning pipeline and outlives the worker
+	FVistarDecodeWorker(int32 InIndex, uint32 InputCapacity, uint32 OutputCapacity, int32 SlotSize, EThreadPriority Priority,
+		const FVistarSourceTransform& InTransform);
+	virtual ~FVistarDecodeWorker();
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	// Receiver thread, copies the message. Returns false when the bulk input queue is full
+	bool Push(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, EVistarLane Lane);
+
+	// Game thread side
+	FVistarIngestQueue& GetOutput() { return Output; }
+
+	FVistarDecodeWorkerStats GetStats() const;
+
+	uint64 GetMalformedCount() const { return Counters.Malformed.load(std::memory_order_relaxed); }
+
+	// Adds this worker's allocation counters to OutStats
+	void AccumulateAllocStats(FVistarIngestAllocStats& OutStats) const;
+
+private:
+	// A raw message lives in a pool slot, or on the heap when it is larger than a slot
+	struct FRawMessage
+	{
+		uint8* Heap = nullptr;
+		uint32 Slot = FVistarMessagePool::InvalidSlot;
+		int32 Size = 0;
+		FVistarDatagramMeta Meta;
+	};
+
+	void Decode(const FRawMessage& Raw);
+
+	FVistarMessagePool Pool;
+	TCircularQueue<FRawMessage> Input;
+	TSpscQueue<FRawMessage> ControlInput;
+	std::atomic<uint32> ControlQueued;
+	FVistarIngestQueue Output;
+
+	const FVistarSourceTransform& Transform;
+	int32 Index;
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	std::atomic<bool> bStop;
+	// Set while the worker waits for input, the producer only signals then
+	std::atomic<bool> bIdle;
+
+	std::atomic<uint64> Decoded;
+	std::atomic<uint64> Dropped;
+	std::atomic<uint64> Pooled;
+	std::atomic<uint64> HeapFallbacks;
+	FVistarDecodeCounters Counters;
+};
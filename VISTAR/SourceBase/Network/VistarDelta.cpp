@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarDelta.h"
+
+namespace
+{
+	const uint8 GFields[] = { Component_Location, Component_Rotation, Component_Slew };
+
+	// Half a binary quantization step, smaller changes would not survive the quantized encoding anyway
+	const double GTolerance[FVistarEntityUpdate::NumComponents] =
+	{
+		0.5e-7,				// Lon, 1e-7 degree
+		0.5e-7,				// Lat
+		0.005,				// Alt, cm
+		0.5 * 360.0 / 65536.0,	// Yaw
+		0.5 * 360.0 / 65536.0,	// Pitch
+		0.5 * 360.0 / 65536.0,	// Roll
+		0.5 * 360.0 / 65536.0,	// SlewAz
+		0.5 * 360.0 / 65536.0,	// SlewElev
+	};
+
+	FORCEINLINE bool HasChanged(int32 Index, double Value, double Last)
+	{
+		// Angles wrap, 359.99 and -0.01 are the same heading
+		const double Difference = Index < 3 ? Value - Last : FRotator::NormalizeAxis(Value - Last);
+		return FMath::Abs(Difference) > GTolerance[Index];
+	}
+}
+
+bool FVistarDeltaState::Resolve(FVistarEntityUpdate& Message)
+{
+	// Without the entity's last state there is no class to spawn it with and no values to fill in
+	const FState* State = States.Find(Message.Id);
+	if (!State || (Message.Class == EVistarClassType::VISTAR_TYPE_NONE && State->Class == EVistarClassType::VISTAR_TYPE_NONE))
+	{
+		++UnresolvedCount;
+		return false;
+	}
+	if (Message.Class == EVistarClassType::VISTAR_TYPE_NONE)
+	{
+		Message.Class = State->Class;
+	}
+
+	uint8 Components = Message.GetComponents();
+	for (const uint8 Field : GFields)
+	{
+		const uint8 Present = Components & Field;
+		if (Present == 0 || Present == Field)
+		{
+			continue;
+		}
+		const uint8 Missing = Field & ~Present;
+		if ((State->Known & Missing) != Missing)
+		{
+			++UnresolvedCount;
+			return false;
+		}
+		for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+		{
+			if (Missing & (1 << Index))
+			{
+				Message.GetComponent(Index) = State->Values[Index];
+			}
+		}
+		Components |= Field;
+	}
+	Message.SetComponents(Components);
+	return true;
+}
+
+void FVistarDeltaState::Record(const FVistarEntityUpdate& Message)
+{
+	FState& State = States.FindOrAdd(Message.Id);
+	if (Message.Class != EVistarClassType::VISTAR_TYPE_NONE)
+	{
+		State.Class = Message.Class;
+	}
+
+	const uint8 Components = Message.GetComponents();
+	for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+	{
+		if (Components & (1 << Index))
+		{
+			State.Values[Index] = Message.GetComponent(Index);
+		}
+	}
+	State.Known |= Components;
+}
+
+EVistarDeltaSend FVistarDeltaEncoder::Reduce(FVistarEntityUpdate& Message, double Now)
+{
+	const uint8 Components = Message.GetComponents();
+	// Routes are all points, those have no delta form
+	if (Components == 0 || Message.Points.Num() > 0)
+	{
+		++FullCount;
+		return EVistarDeltaSend::Full;
+	}
+
+	// Only the components may be reduced away, a create that attaches or changes anything else goes out whole
+	FSent* Last = Sent.Find(Message.Id);
+	const bool bCreateChanged = Last && Message.Stream == EVistarStream::Create
+		&& (Message.Class != Last->Class || Message.ParentId != Last->ParentId || Message.ChildId != Last->ChildId
+			|| Message.Trajectory != Last->Trajectory);
+	if (!Last || bCreateChanged || Now - Last->LastFull >= RefreshSeconds)
+	{
+		FSent& Entry = Last ? *Last : Sent.Add(Message.Id);
+		for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+		{
+			Entry.Values[Index] = Message.GetComponent(Index);
+		}
+		Entry.LastFull = Now;
+		if (Message.Stream == EVistarStream::Create)
+		{
+			Entry.Class = Message.Class;
+			Entry.ParentId = Message.ParentId;
+			Entry.ChildId = Message.ChildId;
+			Entry.Trajectory = Message.Trajectory;
+		}
+		++FullCount;
+		return EVistarDeltaSend::Full;
+	}
+
+	uint8 Changed = 0;
+	for (int32 Index = 0; Index < FVistarEntityUpdate::NumComponents; ++Index)
+	{
+		const uint8 Bit = 1 << Index;
+		if ((Components & Bit) && HasChanged(Index, Message.GetComponent(Index), Last->Values[Index]))
+		{
+			// Only what was sent is remembered, slow drift adds up until it crosses the tolerance
+			Last->Values[Index] = Message.GetComponent(Index);
+			Changed |= Bit;
+		}
+	}
+	if (Changed == 0)
+	{
+		++SkippedCount;
+		return EVistarDeltaSend::None;
+	}
+
+	// The viewer already has everything else from the full message
+	Message.Stream = EVistarStream::Update;
+	Message.ParentId = FVistarEntityId();
+	Message.ChildId = 0;
+	Message.Trajectory = FVistarInlineString();
+	Message.Points.Reset();
+	Message.bHasEcef = false;
+	Message.bHasLocal = false;
+	Message.SetComponents(Changed);
+	++DeltaCount;
+	return EVistarDeltaSend::Delta;
+}
+
+void FVistarDeltaEncoder::ExpandToFields(FVistarEntityUpdate& Message)
+{
+	uint8 Components = Message.GetComponents();
+	for (const uint8 Field : GFields)
+	{
+		Components |= (Components & Field) ? Field : 0;
+	}
+	Message.SetComponents(Components);
+}
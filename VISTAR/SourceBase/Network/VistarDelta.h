@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * Receive side of delta updates, the last value of every component per entity
+ * A delta leaves out the components that did not change since the sender's previous message, they are
+ * taken from here before the update is applied. Game thread only.
+ */
+class VISTAR_API FVistarDeltaState
+{
+public:
+	// Fills the components Message leaves out from the entity's last state, a missing class included.
+	// False when there is no state or a field cannot be completed (late join, lost full update), the
+	// delta must then be dropped until the next full refresh or keyframe
+	bool Resolve(FVistarEntityUpdate& Message);
+
+	// Keeps the components and class of an applied create or update
+	void Record(const FVistarEntityUpdate& Message);
+
+	void Forget(const FVistarEntityId& Id) { States.Remove(Id); }
+	void Reset() { States.Reset(); UnresolvedCount = 0; }
+
+	int32 Num() const { return States.Num(); }
+	uint64 GetUnresolvedCount() const { return UnresolvedCount; }
+
+private:
+	struct FState
+	{
+		double Values[FVistarEntityUpdate::NumComponents] = { 0.0 };
+		uint8 Known = 0;
+		EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+	};
+	TMap<FVistarEntityId, FState> States;
+	uint64 UnresolvedCount = 0;
+};
+
+/**
+ * What FVistarDeltaEncoder::Reduce left to send
+ */
+enum class EVistarDeltaSend : uint8
+{
+	// Nothing changed
+	None,
+	// The message as given
+	Full,
+	// An Update with the changed components
+	Delta,
+};
+
+/**
+ * Send side of delta updates, turns repeated full updates of an entity into updates of the components
+ * that changed by more than the binary quantization step since they were last sent
+ * The first message of an entity and one every RefreshSeconds go out whole so a viewer that missed a
+ * delta or joined late converges.
+ */
+class VISTAR_API FVistarDeltaEncoder
+{
+public:
+	explicit FVistarDeltaEncoder(double InRefreshSeconds = 5.0) : RefreshSeconds(InRefreshSeconds) {}
+
+	void SetRefreshSeconds(double InRefreshSeconds) { RefreshSeconds = InRefreshSeconds; }
+
+	// Create or update. Left whole when due for a full send, carrying points, or a create whose CLASS,
+	// PARENT, CHILD_ID or TRAJECTORY differ from the last sent, otherwise reduced to an Update carrying
+	// only the changed components
+	EVistarDeltaSend Reduce(FVistarEntityUpdate& Message, double Now);
+
+	// A deleted entity starts over with a full message
+	void Forget(const FVistarEntityId& Id) { Sent.Remove(Id); }
+	void Reset() { Sent.Reset(); }
+
+	// Widens partial fields back to whole ones, for formats without per component presence (JSON)
+	static void ExpandToFields(FVistarEntityUpdate& Message);
+
+	uint64 GetFullCount() const { return FullCount; }
+	uint64 GetDeltaCount() const { return DeltaCount; }
+	uint64 GetSkippedCount() const { return SkippedCount; }
+
+private:
+	struct FSent
+	{
+		double Values[FVistarEntityUpdate::NumComponents] = { 0.0 };
+		double LastFull = 0.0;
+		// What a delta leaves out, a create changing any of it goes out whole
+		EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+		FVistarEntityId ParentId;
+		int32 ChildId = 0;
+		FVistarInlineString Trajectory;
+	};
+	TMap<FVistarEntityId, FSent> Sent;
+
+	double RefreshSeconds;
+
+	uint64 FullCount = 0;
+	uint64 DeltaCount = 0;
+	uint64 SkippedCount = 0;
+};
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarDeltaBenchCommandlet.h"
+#include "VistarBinaryCodec.h"
+#include "VistarCapture.h"
+#include "VistarDelta.h"
+#include "VistarIngestPipeline.h"
+#include "VistarNetStats.h"
+#include "Misc/Parse.h"
+
+namespace
+{
+	struct FClassBytes
+	{
+		uint64 Messages = 0;
+		uint64 FullBytes = 0;
+		uint64 DeltaBytes = 0;
+		uint64 Deltas = 0;
+		uint64 Skipped = 0;
+	};
+}
+
+UVistarDeltaBenchCommandlet::UVistarDeltaBenchCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UVistarDeltaBenchCommandlet::Main(const FString& Params)
+{
+	FString CapturePath;
+	float RefreshSeconds = 5.0f;
+	FParse::Value(*Params, TEXT("capture="), CapturePath);
+	FParse::Value(*Params, TEXT("refresh="), RefreshSeconds);
+
+	FVistarBinaryCodec::FOptions Options;
+	Options.bQuantizePosition = FParse::Param(*Params, TEXT("quantize"));
+	Options.bQuantizeAngles = Options.bQuantizePosition;
+
+	FVistarCaptureReader Reader(CapturePath);
+	if (!Reader.IsOpen())
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarDeltaBench: cannot open capture '%s', pass -capture=<file>"), *CapturePath);
+		return 1;
+	}
+
+	// Datagrams are decoded one at a time and drained right away, nothing is dropped
+	FVistarNetworkConfig Config;
+	Config.DecodeWorkerCount = 0;
+	FVistarIngestPipeline Pipeline(Config);
+	FVistarIngestQueue& Queue = Pipeline.GetQueue(0);
+
+	FVistarDeltaEncoder Encoder(RefreshSeconds);
+	FClassBytes Classes[VistarClassCount];
+	uint64 CaptureBytes = 0;
+	uint64 Records = 0;
+
+	TArray<uint8> Buffer;
+	FVistarEntityUpdate Message;
+	const uint8* Data = nullptr;
+	int32 Size = 0;
+	int64 ReceiveTimeUs = 0;
+	while (Reader.ReadNext(Data, Size, ReceiveTimeUs))
+	{
+		CaptureBytes += Size;
+		++Records;
+		Pipeline.HandleDatagram(Data, Size);
+
+		for (EVistarLane Lane : { EVistarLane::Control, EVistarLane::Bulk })
+		{
+			while (Queue.Pop(Lane, Message))
+			{
+				FClassBytes& Bytes = Classes[static_cast<int32>(Message.Class)];
+				++Bytes.Messages;
+
+				Buffer.Reset();
+				FVistarBinaryCodec::EncodeEntity(Message, Options, Buffer);
+				Bytes.FullBytes += Buffer.Num();
+
+				if (Message.Stream == EVistarStream::Delete)
+				{
+					Encoder.Forget(Message.Id);
+				}
+				if (Message.Stream != EVistarStream::Create && Message.Stream != EVistarStream::Update)
+				{
+					Bytes.DeltaBytes += Buffer.Num();
+					continue;
+				}
+
+				// Same choice as UVistarGameInstance::SendEntity
+				switch (Encoder.Reduce(Message, ReceiveTimeUs / 1000000.0))
+				{
+				case EVistarDeltaSend::None:
+					++Bytes.Skipped;
+					break;
+				case EVistarDeltaSend::Full:
+					Bytes.DeltaBytes += Buffer.Num();
+					break;
+				case EVistarDeltaSend::Delta:
+					Bytes.DeltaBytes += FVistarBinaryCodec::GetEncodedDeltaSize(Message, Options);
+					++Bytes.Deltas;
+					break;
+				}
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VistarDeltaBench: %llu records, %llu bytes captured, refresh %.1f s, %s"),
+		Records, CaptureBytes, RefreshSeconds, Options.bQuantizePosition ? TEXT("quantized") : TEXT("doubles"));
+
+	FClassBytes Total;
+	for (int32 Index = 0; Index < VistarClassCount; ++Index)
+	{
+		const FClassBytes& Bytes = Classes[Index];
+		Total.Messages += Bytes.Messages;
+		Total.FullBytes += Bytes.FullBytes;
+		Total.DeltaBytes += Bytes.DeltaBytes;
+		Total.Deltas += Bytes.Deltas;
+		Total.Skipped += Bytes.Skipped;
+		if (Bytes.Messages == 0)
+		{
+			continue;
+		}
+		UE_LOG(LogTemp, Display, TEXT("VistarDeltaBench: %-12s %9llu msgs, full %6.1f bytes/msg, delta %6.1f bytes/msg (%5.1f%%), %llu deltas, %llu skipped"),
+			ANSI_TO_TCHAR(VistarClassToName(static_cast<EVistarClassType>(Index))), Bytes.Messages,
+			static_cast<double>(Bytes.FullBytes) / Bytes.Messages, static_cast<double>(Bytes.DeltaBytes) / Bytes.Messages,
+			100.0 * Bytes.DeltaBytes / FMath::Max<uint64>(Bytes.FullBytes, 1), Bytes.Deltas, Bytes.Skipped);
+	}
+	UE_LOG(LogTemp, Display, TEXT("VistarDeltaBench: total %llu msgs, captured %llu bytes, full binary %llu bytes, delta %llu bytes (%.1f%% of full)"),
+		Total.Messages, CaptureBytes, Total.FullBytes, Total.DeltaBytes, 100.0 * Total.DeltaBytes / FMath::Max<uint64>(Total.FullBytes, 1));
+	return 0;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VistarDeltaBenchCommandlet.generated.h"
+
+/**
+ * Bandwidth of delta updates on captured traffic. Every message of the capture is decoded and
+ * re-encoded as full binary and through FVistarDeltaEncoder, bytes are reported per class.
+ * Relative capture paths are under Saved/Captures
+ *   UnrealEditor-Cmd VISTAR.uproject -run=VistarDeltaBench -capture=run1 -refresh=5 -quantize
+ */
+UCLASS()
+class VISTAR_API UVistarDeltaBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVistarDeltaBenchCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
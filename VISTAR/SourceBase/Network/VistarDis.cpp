@@ -0,0 +1,435 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarDis.h"
+
+namespace
+{
+	constexpr double WgsA = 6378137.0;
+	constexpr double WgsE2 = 6.69437999014e-3;
+
+	// Offsets into the PDUs, see IEEE 1278.1 section 7
+	constexpr int32 PduTypeOffset = 2;
+	constexpr int32 FamilyOffset = 3;
+	constexpr int32 LengthOffset = 8;
+
+	constexpr int32 EntityIdOffset = 12;
+	constexpr int32 EntityTypeOffset = 20;
+	constexpr int32 LocationOffset = 48;
+	constexpr int32 OrientationOffset = 72;
+	constexpr int32 AppearanceOffset = 84;
+
+	constexpr int32 FiringIdOffset = 12;
+	constexpr int32 MunitionIdOffset = 24;
+	constexpr int32 DetonationMunitionTypeOffset = 72;
+	constexpr int32 FireSize = 96;
+	constexpr int32 DetonationSize = 104;
+
+	constexpr int32 ReceivingIdOffset = 18;
+	constexpr int32 RemoveEntitySize = 28;
+
+	constexpr int32 EntityIdSize = 6;
+
+	// General appearance bit 23, the entity has left the exercise
+	constexpr uint32 AppearanceDeactivated = 1u << 23;
+
+	// DIS is big-endian, all supported targets are little-endian
+	template <typename T>
+	FORCEINLINE T ReadBE(const uint8* Data, int32 Offset)
+	{
+		static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "Unsupported field size");
+		uint8 Bytes[sizeof(T)];
+		for (int32 i = 0; i < static_cast<int32>(sizeof(T)); ++i)
+		{
+			Bytes[i] = Data[Offset + static_cast<int32>(sizeof(T)) - 1 - i];
+		}
+		T Value;
+		FMemory::Memcpy(&Value, Bytes, sizeof(T));
+		return Value;
+	}
+
+	template <typename T>
+	FORCEINLINE void WriteBE(uint8* Data, int32 Offset, T Value)
+	{
+		uint8 Bytes[sizeof(T)];
+		FMemory::Memcpy(Bytes, &Value, sizeof(T));
+		for (int32 i = 0; i < static_cast<int32>(sizeof(T)); ++i)
+		{
+			Data[Offset + i] = Bytes[static_cast<int32>(sizeof(T)) - 1 - i];
+		}
+	}
+
+	// Entity type to CLASS, first match wins, 0 in Domain or Category matches anything.
+	// Kinds, domains and categories are the SISO-REF-010 enumerations
+	struct FClassRule
+	{
+		uint8 Kind;
+		uint8 Domain;
+		uint8 Category;
+		EVistarClassType Class;
+	};
+
+	constexpr FClassRule ClassRules[] =
+	{
+		{ 1, 2, 1, EVistarClassType::VISTAR_TYPE_FIGHTER },		// Air, fighter / air defense
+		{ 1, 2, 2, EVistarClassType::VISTAR_TYPE_FIGHTER },		// Air, attack / strike
+		{ 1, 2, 3, EVistarClassType::VISTAR_TYPE_FIGHTER },		// Air, bomber
+		{ 1, 2, 0, EVistarClassType::VISTAR_TYPE_UAV },			// Any other air platform
+		{ 1, 1, 28, EVistarClassType::VISTAR_TYPE_LAUNCHER },	// Land, air defense / missile defense unit
+		{ 2, 0, 0, EVistarClassType::VISTAR_TYPE_MISSILE },		// Munition
+		{ 9, 0, 0, EVistarClassType::VISTAR_TYPE_RADAR },		// Sensor / emitter
+	};
+
+	bool IsSupported(uint8 Type)
+	{
+		switch (static_cast<FVistarDis::EPduType>(Type))
+		{
+		case FVistarDis::EPduType::EntityState:
+		case FVistarDis::EPduType::Fire:
+		case FVistarDis::EPduType::Detonation:
+		case FVistarDis::EPduType::RemoveEntity:
+		case FVistarDis::EPduType::RemoveEntityR:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Where the ID of the entity the PDU applies to sits, false when the PDU is too short for it
+	bool LocateEntityId(const uint8* Data, int32 Size, int32& OutOffset)
+	{
+		switch (static_cast<FVistarDis::EPduType>(Data[PduTypeOffset]))
+		{
+		case FVistarDis::EPduType::EntityState:		OutOffset = EntityIdOffset; break;
+		case FVistarDis::EPduType::Fire:			OutOffset = FiringIdOffset; break;
+		case FVistarDis::EPduType::Detonation:		OutOffset = MunitionIdOffset; break;
+		case FVistarDis::EPduType::RemoveEntity:
+		case FVistarDis::EPduType::RemoveEntityR:	OutOffset = ReceivingIdOffset; break;
+		default:									return false;
+		}
+		return Size >= OutOffset + EntityIdSize;
+	}
+
+	ANSICHAR* AppendNumber(ANSICHAR* Out, uint16 Value)
+	{
+		ANSICHAR Digits[5];
+		int32 Count = 0;
+		do
+		{
+			Digits[Count++] = static_cast<ANSICHAR>('0' + Value % 10);
+			Value /= 10;
+		}
+		while (Value != 0);
+		while (Count > 0)
+		{
+			*Out++ = Digits[--Count];
+		}
+		return Out;
+	}
+
+	// "site:application:entity", false for the null entity 0:0:0
+	bool ReadEntityId(const uint8* Data, int32 Offset, FVistarEntityId& OutId)
+	{
+		const uint16 Site = ReadBE<uint16>(Data, Offset);
+		const uint16 Application = ReadBE<uint16>(Data, Offset + 2);
+		const uint16 Entity = ReadBE<uint16>(Data, Offset + 4);
+		if (Site == 0 && Application == 0 && Entity == 0)
+		{
+			return false;
+		}
+
+		ANSICHAR Buffer[20];
+		ANSICHAR* Out = AppendNumber(Buffer, Site);
+		*Out++ = ':';
+		Out = AppendNumber(Out, Application);
+		*Out++ = ':';
+		Out = AppendNumber(Out, Entity);
+		OutId.Set(Buffer, static_cast<int32>(Out - Buffer));
+		return true;
+	}
+
+	// Body axes (forward, right, down) of a z-y-x Euler rotation, in the frame the angles refer to
+	void BodyAxes(double Psi, double Theta, double Phi, FVector3d& OutForward, FVector3d& OutRight, FVector3d& OutDown)
+	{
+		const double SinPsi = FMath::Sin(Psi), CosPsi = FMath::Cos(Psi);
+		const double SinTheta = FMath::Sin(Theta), CosTheta = FMath::Cos(Theta);
+		const double SinPhi = FMath::Sin(Phi), CosPhi = FMath::Cos(Phi);
+
+		OutForward = FVector3d(CosTheta * CosPsi, CosTheta * SinPsi, -SinTheta);
+		OutRight = FVector3d(SinPhi * SinTheta * CosPsi - CosPhi * SinPsi, SinPhi * SinTheta * SinPsi + CosPhi * CosPsi, SinPhi * CosTheta);
+		OutDown = FVector3d(CosPhi * SinTheta * CosPsi + SinPhi * SinPsi, CosPhi * SinTheta * SinPsi - SinPhi * CosPsi, CosPhi * CosTheta);
+	}
+}
+
+void FVistarEnuFrame::Set(double RefLatDeg, double RefLonDeg, double RefAlt)
+{
+	Origin = FVistarDis::GeodeticToEcef(RefLatDeg, RefLonDeg, RefAlt);
+
+	const double Lat = FMath::DegreesToRadians(RefLatDeg);
+	const double Lon = FMath::DegreesToRadians(RefLonDeg);
+	const double SinLat = FMath::Sin(Lat), CosLat = FMath::Cos(Lat);
+	const double SinLon = FMath::Sin(Lon), CosLon = FMath::Cos(Lon);
+
+	East = FVector3d(-SinLon, CosLon, 0.0);
+	North = FVector3d(-SinLat * CosLon, -SinLat * SinLon, CosLat);
+	Up = FVector3d(CosLat * CosLon, CosLat * SinLon, SinLat);
+}
+
+FVector3d FVistarEnuFrame::ToUnreal(const FVector3d& Ecef) const
+{
+	const FVector3d D = Ecef - Origin;
+	return FVector3d(East.Dot(D) * 100.0, North.Dot(D) * 100.0, Up.Dot(D) * 100.0 - 5250.0);
+}
+
+void FVistarEnuFrame::ToYawPitchRoll(const FVector3f& EcefEuler, double& OutYaw, double& OutPitch, double& OutRoll) const
+{
+	FVector3d Forward, Right, Down;
+	BodyAxes(EcefEuler.X, EcefEuler.Y, EcefEuler.Z, Forward, Right, Down);
+
+	OutYaw = FMath::Fmod(FMath::RadiansToDegrees(FMath::Atan2(East.Dot(Forward), North.Dot(Forward))) + 360.0, 360.0);
+	OutPitch = FMath::RadiansToDegrees(FMath::Asin(FMath::Clamp(Up.Dot(Forward), -1.0, 1.0)));
+	OutRoll = FMath::RadiansToDegrees(FMath::Atan2(-Up.Dot(Right), -Up.Dot(Down)));
+}
+
+bool FVistarDis::IsDis(const uint8* Data, int32 Size)
+{
+	// Versions 4 (IEEE 1278-1993) to 7 (1278.1-2012), and no DIS family goes past 13
+	if (Size < HeaderSize || Data[0] < 4 || Data[0] > 7 || Data[FamilyOffset] > 13)
+	{
+		return false;
+	}
+	const uint16 Length = ReadBE<uint16>(Data, LengthOffset);
+	return Length >= HeaderSize && Length <= Size;
+}
+
+bool FVistarDis::ForEachPdu(const uint8* Data, int32 Size, TFunctionRef<void(const uint8*, int32)> Visit)
+{
+	int32 Offset = 0;
+	while (Offset < Size)
+	{
+		if (!IsDis(Data + Offset, Size - Offset))
+		{
+			return false;
+		}
+		const int32 Length = ReadBE<uint16>(Data + Offset, LengthOffset);
+		Visit(Data + Offset, Length);
+		Offset += Length;
+	}
+	return true;
+}
+
+EVistarDecodeResult FVistarDis::Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage)
+{
+	if (!IsDis(Data, Size))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	const uint8 Type = Data[PduTypeOffset];
+	if (!IsSupported(Type))
+	{
+		return EVistarDecodeResult::Ignored;
+	}
+	// Only the PDU itself, whatever follows it in the datagram is not ours to read
+	Size = ReadBE<uint16>(Data, LengthOffset);
+
+	switch (static_cast<EPduType>(Type))
+	{
+	case EPduType::EntityState:
+	{
+		if (Size < EntityStateSize || !ReadEntityId(Data, EntityIdOffset, OutMessage.Id))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		const uint32 Appearance = ReadBE<uint32>(Data, AppearanceOffset);
+		OutMessage.Stream = (Appearance & AppearanceDeactivated) ? EVistarStream::Delete : EVistarStream::Update;
+		OutMessage.Class = ClassFromEntityType(Data[EntityTypeOffset], Data[EntityTypeOffset + 1], Data[EntityTypeOffset + 4]);
+		if (OutMessage.Stream == EVistarStream::Delete)
+		{
+			return EVistarDecodeResult::Ok;
+		}
+
+		OutMessage.bHasEcef = true;
+		OutMessage.Ecef = FVector3d(ReadBE<double>(Data, LocationOffset), ReadBE<double>(Data, LocationOffset + 8), ReadBE<double>(Data, LocationOffset + 16));
+		OutMessage.EcefEuler = FVector3f(ReadBE<float>(Data, OrientationOffset), ReadBE<float>(Data, OrientationOffset + 4), ReadBE<float>(Data, OrientationOffset + 8));
+		if (!FMath::IsFinite(OutMessage.Ecef.X) || !FMath::IsFinite(OutMessage.Ecef.Y) || !FMath::IsFinite(OutMessage.Ecef.Z))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		return EVistarDecodeResult::Ok;
+	}
+
+	case EPduType::Fire:
+		if (Size < FireSize)
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		if (!ReadEntityId(Data, FiringIdOffset, OutMessage.Id))
+		{
+			return EVistarDecodeResult::Ignored;
+		}
+		OutMessage.Stream = EVistarStream::Action;
+		OutMessage.Action.Set("fire", 4);
+		return EVistarDecodeResult::Ok;
+
+	case EPduType::Detonation:
+		if (Size < DetonationSize)
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		// Unguided rounds are not simulated as entities, there is nothing to remove
+		if (!ReadEntityId(Data, MunitionIdOffset, OutMessage.Id))
+		{
+			return EVistarDecodeResult::Ignored;
+		}
+		OutMessage.Stream = EVistarStream::Action;
+		OutMessage.Class = ClassFromEntityType(Data[DetonationMunitionTypeOffset], Data[DetonationMunitionTypeOffset + 1],
+			Data[DetonationMunitionTypeOffset + 4]);
+		OutMessage.Action.Set("destroy", 7);
+		return EVistarDecodeResult::Ok;
+
+	default:
+		if (Size < RemoveEntitySize || !ReadEntityId(Data, ReceivingIdOffset, OutMessage.Id))
+		{
+			return EVistarDecodeResult::Malformed;
+		}
+		OutMessage.Stream = EVistarStream::Delete;
+		return EVistarDecodeResult::Ok;
+	}
+}
+
+bool FVistarDis::PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength)
+{
+	int32 Offset = 0;
+	if (!IsDis(Data, Size) || !LocateEntityId(Data, Size, Offset))
+	{
+		return false;
+	}
+	OutId = reinterpret_cast<const ANSICHAR*>(Data + Offset);
+	OutLength = EntityIdSize;
+	return true;
+}
+
+bool FVistarDis::PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream)
+{
+	if (!IsDis(Data, Size))
+	{
+		return false;
+	}
+	switch (static_cast<EPduType>(Data[PduTypeOffset]))
+	{
+	case EPduType::EntityState:
+		if (Size < EntityStateSize)
+		{
+			return false;
+		}
+		OutStream = (ReadBE<uint32>(Data, AppearanceOffset) & AppearanceDeactivated) ? EVistarStream::Delete : EVistarStream::Update;
+		return true;
+	case EPduType::Fire:
+	case EPduType::Detonation:
+		OutStream = EVistarStream::Action;
+		return true;
+	case EPduType::RemoveEntity:
+	case EPduType::RemoveEntityR:
+		OutStream = EVistarStream::Delete;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void FVistarDis::EncodeEntityState(uint16 Site, uint16 Application, uint16 Entity, EVistarClassType Class,
+	const FVector3d& Ecef, const FVector3f& EcefEuler, TArray<uint8>& OutBuffer)
+{
+	const int32 Start = OutBuffer.AddZeroed(EntityStateSize);
+	uint8* Out = OutBuffer.GetData() + Start;
+
+	Out[0] = 7;
+	Out[1] = 1;
+	Out[PduTypeOffset] = static_cast<uint8>(EPduType::EntityState);
+	Out[FamilyOffset] = 1;
+	WriteBE<uint16>(Out, LengthOffset, EntityStateSize);
+
+	WriteBE<uint16>(Out, EntityIdOffset, Site);
+	WriteBE<uint16>(Out, EntityIdOffset + 2, Application);
+	WriteBE<uint16>(Out, EntityIdOffset + 4, Entity);
+
+	// The first rule for the class, wildcards written as 0
+	for (const FClassRule& Rule : ClassRules)
+	{
+		if (Rule.Class == Class)
+		{
+			Out[EntityTypeOffset] = Rule.Kind;
+			Out[EntityTypeOffset + 1] = Rule.Domain;
+			Out[EntityTypeOffset + 4] = Rule.Category;
+			break;
+		}
+	}
+
+	WriteBE<double>(Out, LocationOffset, Ecef.X);
+	WriteBE<double>(Out, LocationOffset + 8, Ecef.Y);
+	WriteBE<double>(Out, LocationOffset + 16, Ecef.Z);
+	WriteBE<float>(Out, OrientationOffset, EcefEuler.X);
+	WriteBE<float>(Out, OrientationOffset + 4, EcefEuler.Y);
+	WriteBE<float>(Out, OrientationOffset + 8, EcefEuler.Z);
+}
+
+FVector3d FVistarDis::GeodeticToEcef(double LatDeg, double LonDeg, double Alt)
+{
+	const double Lat = FMath::DegreesToRadians(LatDeg);
+	const double Lon = FMath::DegreesToRadians(LonDeg);
+	const double SinLat = FMath::Sin(Lat), CosLat = FMath::Cos(Lat);
+	const double N = WgsA / FMath::Sqrt(1.0 - WgsE2 * SinLat * SinLat);
+
+	return FVector3d((N + Alt) * CosLat * FMath::Cos(Lon), (N + Alt) * CosLat * FMath::Sin(Lon), (N * (1.0 - WgsE2) + Alt) * SinLat);
+}
+
+void FVistarDis::EcefToGeodetic(const FVector3d& Ecef, double& OutLatDeg, double& OutLonDeg, double& OutAlt)
+{
+	const double P = FMath::Sqrt(Ecef.X * Ecef.X + Ecef.Y * Ecef.Y);
+	double Lat = FMath::Atan2(Ecef.Z, P * (1.0 - WgsE2));
+	double Alt = 0.0;
+
+	// Converges to well under a millimeter in a few rounds anywhere but at the poles
+	for (int32 Iteration = 0; Iteration < 5; ++Iteration)
+	{
+		const double SinLat = FMath::Sin(Lat);
+		const double N = WgsA / FMath::Sqrt(1.0 - WgsE2 * SinLat * SinLat);
+		Alt = P / FMath::Cos(Lat) - N;
+		Lat = FMath::Atan2(Ecef.Z, P * (1.0 - WgsE2 * N / (N + Alt)));
+	}
+
+	OutLatDeg = FMath::RadiansToDegrees(Lat);
+	OutLonDeg = FMath::RadiansToDegrees(FMath::Atan2(Ecef.Y, Ecef.X));
+	OutAlt = Alt;
+}
+
+FVector3f FVistarDis::EulerFromYawPitchRoll(const FVistarEnuFrame& Frame, double Yaw, double Pitch, double Roll)
+{
+	// Body axes in north/east/down, then into ECEF through the frame
+	FVector3d Forward, Right, Down;
+	BodyAxes(FMath::DegreesToRadians(Yaw), FMath::DegreesToRadians(Pitch), FMath::DegreesToRadians(Roll), Forward, Right, Down);
+	auto ToEcef = [&Frame](const FVector3d& Ned)
+	{
+		return Frame.North * Ned.X + Frame.East * Ned.Y - Frame.Up * Ned.Z;
+	};
+	const FVector3d EcefForward = ToEcef(Forward);
+	const FVector3d EcefRight = ToEcef(Right);
+	const FVector3d EcefDown = ToEcef(Down);
+
+	return FVector3f(
+		static_cast<float>(FMath::Atan2(EcefForward.Y, EcefForward.X)),
+		static_cast<float>(FMath::Asin(FMath::Clamp(-EcefForward.Z, -1.0, 1.0))),
+		static_cast<float>(FMath::Atan2(EcefRight.Z, EcefDown.Z)));
+}
+
+EVistarClassType FVistarDis::ClassFromEntityType(uint8 Kind, uint8 Domain, uint8 Category)
+{
+	for (const FClassRule& Rule : ClassRules)
+	{
+		if (Rule.Kind == Kind && (Rule.Domain == 0 || Rule.Domain == Domain) && (Rule.Category == 0 || Rule.Category == Category))
+		{
+			return Rule.Class;
+		}
+	}
+	return EVistarClassType::VISTAR_TYPE_NONE;
+}
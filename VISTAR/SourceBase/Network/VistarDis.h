@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarJsonDecoder.h"
+
+/**
+ * Local east/north/up frame of the viewer, the one LlaToUnreal builds around the reference point
+ * Precomputed once, so earth-fixed positions convert with a subtraction and three dot products
+ */
+struct VISTAR_API FVistarEnuFrame
+{
+	FVector3d Origin = FVector3d(6378137.0, 0.0, 0.0);
+	FVector3d East = FVector3d(0.0, 1.0, 0.0);
+	FVector3d North = FVector3d(0.0, 0.0, 1.0);
+	FVector3d Up = FVector3d(1.0, 0.0, 0.0);
+
+	void Set(double RefLatDeg, double RefLonDeg, double RefAlt);
+
+	// ECEF meters to Unreal units, same axes and ground offset as LlaToUnreal
+	FVector3d ToUnreal(const FVector3d& Ecef) const;
+
+	// DIS psi/theta/phi (radians, relative to ECEF) to heading from north, pitch up and roll right
+	// wing down in degrees. Taken in this frame, not at the entity, which is what the flat world shows
+	void ToYawPitchRoll(const FVector3f& EcefEuler, double& OutYaw, double& OutPitch, double& OutRoll) const;
+};
+
+/**
+ * Decoder for the DIS (IEEE 1278.1) PDUs the viewer understands, versions 4 to 7
+ *   Entity State		update with ECEF position and orientation, removed when the appearance says deactivated
+ *   Fire				"fire" action on the firing entity
+ *   Detonation			"destroy" action on the munition
+ *   Remove Entity		delete of the receiving entity
+ * Entity IDs become "site:application:entity". Every other PDU is Ignored.
+ * A DIS datagram is told apart from the VISTAR formats by its first byte, the protocol version.
+ */
+class VISTAR_API FVistarDis
+{
+public:
+	enum class EPduType : uint8
+	{
+		EntityState		= 1,
+		Fire			= 2,
+		Detonation		= 3,
+		RemoveEntity	= 12,
+		RemoveEntityR	= 51,
+	};
+
+	static constexpr int32 HeaderSize = 12;
+	static constexpr int32 EntityStateSize = 144;
+
+	// Exercise ID of the PDU header, 0 in FVistarNetworkConfig::DisExerciseId takes every exercise
+	static uint8 GetExerciseId(const uint8* Data) { return Data[1]; }
+
+	static bool IsDis(const uint8* Data, int32 Size);
+
+	// Calls Visit for each PDU of a datagram, DIS 7 allows several back to back.
+	// False when the lengths do not add up, the PDUs before that are still visited
+	static bool ForEachPdu(const uint8* Data, int32 Size, TFunctionRef<void(const uint8*, int32)> Visit);
+
+	static EVistarDecodeResult Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage);
+
+	// Raw bytes of the entity the PDU applies to, only for routing like the other PeekId
+	static bool PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength);
+
+	static bool PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream);
+
+	// Entity State PDU, DIS 7, for the benchmark and tests against the decoder
+	static void EncodeEntityState(uint16 Site, uint16 Application, uint16 Entity, EVistarClassType Class,
+		const FVector3d& Ecef, const FVector3f& EcefEuler, TArray<uint8>& OutBuffer);
+
+	// WGS84
+	static FVector3d GeodeticToEcef(double LatDeg, double LonDeg, double Alt);
+	static void EcefToGeodetic(const FVector3d& Ecef, double& OutLatDeg, double& OutLonDeg, double& OutAlt);
+
+	// Inverse of ToYawPitchRoll for a heading, pitch and roll in the given frame
+	static FVector3f EulerFromYawPitchRoll(const FVistarEnuFrame& Frame, double Yaw, double Pitch, double Roll);
+
+	static EVistarClassType ClassFromEntityType(uint8 Kind, uint8 Domain, uint8 Category);
+};
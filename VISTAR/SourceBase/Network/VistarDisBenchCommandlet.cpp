@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarDisBenchCommandlet.h"
+#include "VistarDis.h"
+#include "VistarIngestPipeline.h"
+#include "VistarJsonWriter.h"
+#include "Misc/Parse.h"
+
+namespace
+{
+	// Same area as the traffic generator
+	constexpr double AreaLat = 13.0;
+	constexpr double AreaLon = 77.5;
+	constexpr double AreaRadiusDeg = 1.0;
+
+	struct FBenchResult
+	{
+		double DecodeSeconds = 0.0;
+		double ConvertSeconds = 0.0;
+		uint64 Messages = 0;
+		uint64 Bytes = 0;
+	};
+
+	// Feeds every datagram through an inline pipeline, then converts what comes out. The queue is
+	// sized for one pass, so nothing is dropped
+	FBenchResult RunPasses(const TArray<TArray<uint8>>& Datagrams, int32 Passes, TFunctionRef<void(const FVistarEntityUpdate&, int32)> Convert)
+	{
+		FVistarNetworkConfig Config;
+		Config.DecodeWorkerCount = 0;
+		Config.IngestQueueCapacity = FMath::Max(Datagrams.Num(), 64);
+		FVistarIngestPipeline Pipeline(Config);
+		FVistarIngestQueue& Queue = Pipeline.GetQueue(0);
+
+		FBenchResult Result;
+		FVistarEntityUpdate Message;
+		for (int32 Pass = 0; Pass < Passes; ++Pass)
+		{
+			double Start = FPlatformTime::Seconds();
+			for (const TArray<uint8>& Datagram : Datagrams)
+			{
+				Pipeline.HandleDatagram(Datagram.GetData(), Datagram.Num());
+				Result.Bytes += Datagram.Num();
+			}
+			Result.DecodeSeconds += FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			for (int32 Index = 0; Queue.Pop(EVistarLane::Bulk, Message); ++Index)
+			{
+				Convert(Message, Index);
+				++Result.Messages;
+			}
+			Result.ConvertSeconds += FPlatformTime::Seconds() - Start;
+		}
+		return Result;
+	}
+
+	void LogResult(const TCHAR* Name, const FBenchResult& Result)
+	{
+		const double Messages = FMath::Max<double>(Result.Messages, 1.0);
+		const double TotalSeconds = FMath::Max(Result.DecodeSeconds + Result.ConvertSeconds, 1e-9);
+		UE_LOG(LogTemp, Display, TEXT("VistarDisBench: %-4s %6.1f bytes/msg, decode %7.1f ns/msg, convert %6.1f ns/msg, %6.2f M msgs/s"),
+			Name, Result.Bytes / Messages, Result.DecodeSeconds * 1e9 / Messages, Result.ConvertSeconds * 1e9 / Messages,
+			Result.Messages / TotalSeconds / 1e6);
+	}
+}
+
+UVistarDisBenchCommandlet::UVistarDisBenchCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UVistarDisBenchCommandlet::Main(const FString& Params)
+{
+	int32 Entities = 10000;
+	int32 Passes = 20;
+	FParse::Value(*Params, TEXT("entities="), Entities);
+	FParse::Value(*Params, TEXT("passes="), Passes);
+	Entities = FMath::Clamp(Entities, 1, 65535);
+	Passes = FMath::Max(Passes, 1);
+
+	// The viewer records its reference from the first position, LOCATION.X first
+	FVistarEnuFrame Frame;
+	Frame.Set(AreaLat, AreaLon, 0.0);
+
+	FRandomStream Random(1);
+	TArray<TArray<uint8>> JsonDatagrams;
+	TArray<TArray<uint8>> DisDatagrams;
+	TArray<FVector3d> JsonPositions;
+	TArray<FVector3d> DisPositions;
+	JsonDatagrams.SetNum(Entities);
+	DisDatagrams.SetNum(Entities);
+	JsonPositions.SetNumZeroed(Entities);
+	DisPositions.SetNumZeroed(Entities);
+
+	const EVistarClassType Classes[] = { EVistarClassType::VISTAR_TYPE_FIGHTER, EVistarClassType::VISTAR_TYPE_UAV, EVistarClassType::VISTAR_TYPE_MISSILE };
+	for (int32 i = 0; i < Entities; ++i)
+	{
+		// Lon/Lat in the fields LlaToUnreal reads them from, so both formats describe the same point
+		FVistarEntityUpdate Message;
+		Message.Stream = EVistarStream::Update;
+		Message.Class = Classes[i % UE_ARRAY_COUNT(Classes)];
+		Message.Id = FVistarEntityId(FString::Printf(TEXT("1:1:%d"), i + 1));
+		Message.bHasLocation = true;
+		Message.Lon = AreaLat + Random.FRandRange(-AreaRadiusDeg, AreaRadiusDeg);
+		Message.Lat = AreaLon + Random.FRandRange(-AreaRadiusDeg, AreaRadiusDeg);
+		Message.Alt = Random.FRandRange(100.0f, 10000.0f);
+		Message.bHasRotation = true;
+		Message.Yaw = Random.FRandRange(0.0f, 360.0f);
+		Message.Pitch = Random.FRandRange(-10.0f, 10.0f);
+		Message.Roll = Random.FRandRange(-30.0f, 30.0f);
+		FVistarJsonWriter::WriteEntity(Message, JsonDatagrams[i]);
+
+		const FVector3d Ecef = FVistarDis::GeodeticToEcef(Message.Lon, Message.Lat, Message.Alt);
+		FVistarDis::EncodeEntityState(1, 1, static_cast<uint16>(i + 1), Message.Class, Ecef,
+			FVistarDis::EulerFromYawPitchRoll(Frame, Message.Yaw, Message.Pitch, Message.Roll), DisDatagrams[i]);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("VistarDisBench: %d entity updates per pass, %d passes"), Entities, Passes);
+
+	// The JSON path as UVistarGameInstance::LlaToUnreal does it, both points to ECEF and the frame
+	// rebuilt for every message
+	const FBenchResult Json = RunPasses(JsonDatagrams, Passes, [&JsonPositions](const FVistarEntityUpdate& Message, int32 Index)
+	{
+		FVistarEnuFrame MessageFrame;
+		MessageFrame.Set(AreaLat, AreaLon, 0.0);
+		JsonPositions[Index] = MessageFrame.ToUnreal(FVistarDis::GeodeticToEcef(Message.Lon, Message.Lat, Message.Alt));
+	});
+
+	double Yaw = 0.0, Pitch = 0.0, Roll = 0.0;
+	const FBenchResult Dis = RunPasses(DisDatagrams, Passes, [&Frame, &DisPositions, &Yaw, &Pitch, &Roll](const FVistarEntityUpdate& Message, int32 Index)
+	{
+		DisPositions[Index] = Frame.ToUnreal(Message.Ecef);
+		Frame.ToYawPitchRoll(Message.EcefEuler, Yaw, Pitch, Roll);
+	});
+
+	LogResult(TEXT("JSON"), Json);
+	LogResult(TEXT("DIS"), Dis);
+
+	double MaxError = 0.0;
+	for (int32 i = 0; i < Entities; ++i)
+	{
+		MaxError = FMath::Max(MaxError, FVector3d::Dist(JsonPositions[i], DisPositions[i]));
+	}
+	UE_LOG(LogTemp, Display, TEXT("VistarDisBench: largest position difference between the paths %.2f cm"), MaxError);
+	return Json.Messages == Dis.Messages ? 0 : 1;
+}
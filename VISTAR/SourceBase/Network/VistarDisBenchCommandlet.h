@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VistarDisBenchCommandlet.generated.h"
+
+/**
+ * Ingest cost of DIS Entity State PDUs against the same updates as JSON, decode through
+ * FVistarIngestPipeline and conversion into the local frame
+ *   UnrealEditor-Cmd VISTAR.uproject -run=VistarDisBench -entities=10000 -passes=20
+ */
+UCLASS()
+class VISTAR_API UVistarDisBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVistarDisBenchCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarFragment.h"
+
+namespace
+{
+	template <typename T>
+	FORCEINLINE T ReadAt(const uint8* Data, int32 Offset)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		return Value;
+	}
+
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+}
+
+bool FVistarFragment::ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader)
+{
+	if (!IsFragment(Data, Size) || Data[1] != Version)
+	{
+		return false;
+	}
+
+	OutHeader.MessageId = ReadAt<uint32>(Data, 2);
+	OutHeader.Index = ReadAt<uint16>(Data, 6);
+	OutHeader.Count = ReadAt<uint16>(Data, 8);
+	OutHeader.TotalSize = ReadAt<uint32>(Data, 10);
+	OutHeader.Offset = ReadAt<uint32>(Data, 14);
+
+	const uint64 PayloadEnd = static_cast<uint64>(OutHeader.Offset) + (Size - HeaderSize);
+	return OutHeader.Count > 0 && OutHeader.Index < OutHeader.Count && PayloadEnd <= OutHeader.TotalSize;
+}
+
+int32 FVistarFragment::GetFragmentCount(int32 Size, int32 MaxDatagramSize)
+{
+	const int32 Payload = MaxDatagramSize - HeaderSize;
+	return (Size + Payload - 1) / Payload;
+}
+
+FVistarFragmenter::FVistarFragmenter(int32 InMaxDatagramSize)
+	: MaxDatagramSize(FMath::Clamp(InMaxDatagramSize, FVistarFragment::HeaderSize + 64, 65507))
+	// Random start so a restarted sender does not collide with its own half-finished messages
+	, NextMessageId(static_cast<uint32>(FPlatformTime::Cycles64() ^ FMath::Rand()))
+{
+	Scratch.SetNumUninitialized(MaxDatagramSize);
+}
+
+bool FVistarFragmenter::Split(const uint8* Data, int32 Size, TFunctionRef<void(const uint8*, int32)> Send)
+{
+	const int32 Count = FVistarFragment::GetFragmentCount(Size, MaxDatagramSize);
+	if (Count <= 0 || Count > MAX_uint16)
+	{
+		return false;
+	}
+
+	const int32 Payload = MaxDatagramSize - FVistarFragment::HeaderSize;
+	const uint32 MessageId = NextMessageId++;
+
+	uint8* Out = Scratch.GetData();
+	Out[0] = FVistarFragment::Magic;
+	Out[1] = FVistarFragment::Version;
+	WriteAt<uint32>(Out, 2, MessageId);
+	WriteAt<uint16>(Out, 8, static_cast<uint16>(Count));
+	WriteAt<uint32>(Out, 10, static_cast<uint32>(Size));
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const int32 Offset = Index * Payload;
+		const int32 Length = FMath::Min(Payload, Size - Offset);
+		WriteAt<uint16>(Out, 6, static_cast<uint16>(Index));
+		WriteAt<uint32>(Out, 14, static_cast<uint32>(Offset));
+		FMemory::Memcpy(Out + FVistarFragment::HeaderSize, Data + Offset, Length);
+		Send(Out, FVistarFragment::HeaderSize + Length);
+	}
+	return true;
+}
+
+FVistarReassembler::FVistarReassembler(int32 InMaxPending, int32 InMaxMessageSize, int32 InMaxPendingBytes, double InTimeoutSeconds)
+	: MaxPending(FMath::Max(InMaxPending, 1))
+	, MaxMessageSize(FMath::Max(InMaxMessageSize, 1))
+	, MaxPendingBytes(FMath::Max(InMaxPendingBytes, MaxMessageSize))
+	, PendingBytes(0)
+	, TimeoutSeconds(InTimeoutSeconds)
+	, Completed(0)
+	, TimedOut(0)
+	, Evicted(0)
+{
+}
+
+bool FVistarReassembler::Add(const uint8* Data, int32 Size, double Now, TFunctionRef<void(const uint8*, int32)> OnComplete)
+{
+	FVistarFragment::FHeader Header;
+	if (!FVistarFragment::ReadHeader(Data, Size, Header) || Header.TotalSize > static_cast<uint32>(MaxMessageSize))
+	{
+		return false;
+	}
+
+	FEntry* Entry = Pending.Find(Header.MessageId);
+	if (!Entry)
+	{
+		// Full table, the oldest messages are the ones least likely to complete. Bytes count as well, a
+		// first fragment alone allocates the whole message
+		while (Pending.Num() > 0 && (Pending.Num() >= MaxPending || PendingBytes + Header.TotalSize > MaxPendingBytes))
+		{
+			EvictOldest();
+		}
+
+		Entry = &Pending.Add(Header.MessageId);
+		Entry->Buffer.SetNumUninitialized(Header.TotalSize);
+		Entry->Size = Header.TotalSize;
+		PendingBytes += Entry->Size;
+		Entry->Received.Init(false, Header.Count);
+		Entry->Count = Header.Count;
+		Entry->FirstSeen = Now;
+	}
+
+	// A reused ID with a different shape is a different message, the stale one is lost
+	if (Entry->Count != Header.Count || Entry->Buffer.Num() != static_cast<int32>(Header.TotalSize))
+	{
+		return false;
+	}
+
+	if (Entry->Received[Header.Index])
+	{
+		return true;
+	}
+
+	// The buffer is uninitialized, fragments must cover it exactly once between them
+	const uint32 Length = static_cast<uint32>(Size - FVistarFragment::HeaderSize);
+	uint32 Stride = Length;
+	if (Header.Index == Header.Count - 1)
+	{
+		const bool bAligned = Header.Index > 0 ? Header.Offset % Header.Index == 0 : Header.Offset == 0;
+		if (Header.Offset + Length != Header.TotalSize || !bAligned)
+		{
+			return false;
+		}
+		Stride = Header.Index > 0 ? Header.Offset / Header.Index : 0;
+	}
+	else if (Header.Offset != static_cast<uint64>(Header.Index) * Length)
+	{
+		return false;
+	}
+	if (Header.Count > 1)
+	{
+		if (Stride == 0 || (Entry->Stride != 0 && Entry->Stride != Stride))
+		{
+			return false;
+		}
+		Entry->Stride = Stride;
+	}
+
+	Entry->Received[Header.Index] = true;
+	++Entry->ReceivedCount;
+	FMemory::Memcpy(Entry->Buffer.GetData() + Header.Offset, Data + FVistarFragment::HeaderSize, Length);
+
+	if (Entry->ReceivedCount == Entry->Count)
+	{
+		// Out of the table before the callback so a re-entrant Add cannot invalidate the buffer
+		TArray<uint8> Message = MoveTemp(Entry->Buffer);
+		Remove(Header.MessageId);
+		Completed.fetch_add(1, std::memory_order_relaxed);
+		OnComplete(Message.GetData(), Message.Num());
+	}
+	return true;
+}
+
+void FVistarReassembler::EvictOldest()
+{
+	uint32 OldestId = 0;
+	double OldestTime = TNumericLimits<double>::Max();
+	for (const TPair<uint32, FEntry>& Pair : Pending)
+	{
+		if (Pair.Value.FirstSeen < OldestTime)
+		{
+			OldestTime = Pair.Value.FirstSeen;
+			OldestId = Pair.Key;
+		}
+	}
+	Remove(OldestId);
+	Evicted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FVistarReassembler::Remove(uint32 MessageId)
+{
+	if (const FEntry* Entry = Pending.Find(MessageId))
+	{
+		PendingBytes -= Entry->Size;
+		Pending.Remove(MessageId);
+	}
+}
+
+void FVistarReassembler::Expire(double Now)
+{
+	for (auto It = Pending.CreateIterator(); It; ++It)
+	{
+		if (Now - It->Value.FirstSeen > TimeoutSeconds)
+		{
+			PendingBytes -= It->Value.Size;
+			It.RemoveCurrent();
+			TimedOut.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Fragment frame carrying one slice of a message too large for a single datagram
+ *   u8 Magic (0xB7), u8 Version, u32 MessageId, u16 Index, u16 Count, u32 TotalSize, u32 Offset, payload
+ * Every fragment but the last carries the same payload size at Offset = Index * that size, the last one
+ * ends at TotalSize. The reassembled message is handled like any datagram (JSON, binary or bundle)
+ */
+class VISTAR_API FVistarFragment
+{
+public:
+	static constexpr uint8 Magic = 0xB7;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 18;
+
+	struct FHeader
+	{
+		uint32 MessageId = 0;
+		uint16 Index = 0;
+		uint16 Count = 0;
+		uint32 TotalSize = 0;
+		uint32 Offset = 0;
+	};
+
+	static bool IsFragment(const uint8* Data, int32 Size) { return Size > HeaderSize && Data[0] == Magic; }
+
+	// Validates the header against the payload, false on a malformed fragment
+	static bool ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader);
+
+	// Number of fragments Size bytes need at MaxDatagramSize per fragment
+	static int32 GetFragmentCount(int32 Size, int32 MaxDatagramSize);
+};
+
+/**
+ * Outbound side, splits a message into fragments of at most MaxDatagramSize bytes each
+ */
+class VISTAR_API FVistarFragmenter
+{
+public:
+	explicit FVistarFragmenter(int32 InMaxDatagramSize);
+
+	// Calls Send once per fragment, false if the message needs more than 65535 fragments
+	bool Split(const uint8* Data, int32 Size, TFunctionRef<void(const uint8* /*Data*/, int32 /*Size*/)> Send);
+
+	int32 GetMaxDatagramSize() const { return MaxDatagramSize; }
+
+private:
+	int32 MaxDatagramSize;
+	uint32 NextMessageId;
+	TArray<uint8> Scratch;
+};
+
+/**
+ * Inbound side, a bounded table of partially received messages
+ * Entries that do not complete within the timeout are dropped, and when the table is full, by entry
+ * count or by bytes held, the oldest entries are evicted. Single threaded, owned by the receiver thread.
+ */
+class VISTAR_API FVistarReassembler
+{
+public:
+	// InMaxPendingBytes is raised to InMaxMessageSize when lower, so the largest message always fits
+	FVistarReassembler(int32 InMaxPending, int32 InMaxMessageSize, int32 InMaxPendingBytes, double InTimeoutSeconds);
+
+	// Calls OnComplete with the whole message once its last fragment arrived, the buffer is only
+	// valid for the duration of the call. Returns false for malformed or oversize fragments, and for
+	// fragments whose offset and size do not tile the message, so no byte of it is left unwritten
+	bool Add(const uint8* Data, int32 Size, double Now, TFunctionRef<void(const uint8* /*Data*/, int32 /*Size*/)> OnComplete);
+
+	// Drop entries older than the timeout
+	void Expire(double Now);
+
+	int32 Num() const { return Pending.Num(); }
+	int64 GetPendingBytes() const { return PendingBytes; }
+
+	// Safe to read from other threads
+	uint64 GetCompletedCount() const { return Completed.load(std::memory_order_relaxed); }
+	uint64 GetTimedOutCount() const { return TimedOut.load(std::memory_order_relaxed); }
+	uint64 GetEvictedCount() const { return Evicted.load(std::memory_order_relaxed); }
+
+private:
+	struct FEntry
+	{
+		TArray<uint8> Buffer;
+		// Buffer size, counted in PendingBytes until the entry leaves the table
+		int64 Size = 0;
+		TBitArray<> Received;
+		int32 ReceivedCount = 0;
+		uint16 Count = 0;
+		// Payload size of every fragment but the last, 0 until a fragment tells
+		uint32 Stride = 0;
+		double FirstSeen = 0.0;
+	};
+
+	TMap<uint32, FEntry> Pending;
+
+	int32 MaxPending;
+	int32 MaxMessageSize;
+	int64 MaxPendingBytes;
+	// Sum of the buffers in Pending
+	int64 PendingBytes;
+	double TimeoutSeconds;
+
+	std::atomic<uint64> Completed;
+	std::atomic<uint64> TimedOut;
+	std::atomic<uint64> Evicted;
+
+	void EvictOldest();
+	void Remove(uint32 MessageId);
+};
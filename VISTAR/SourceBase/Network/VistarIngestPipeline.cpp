@@ -0,0 +1,529 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarIngestPipeline.h"
+#include "VistarBundle.h"
+#include "VistarBinaryCodec.h"
+#include "VistarJsonDecoder.h"
+#include "VistarDis.h"
+#include "VistarRelay.h"
+#include "VistarKeyframe.h"
+
+LLM_DEFINE_TAG(VistarIngest);
+
+FVistarIngestPipeline::FVistarIngestPipeline(const FVistarNetworkConfig& InConfig, const FVistarSourceTransform& InTransform)
+	: Transform(InTransform)
+	, DisExerciseId(static_cast<uint8>(FMath::Clamp(InConfig.DisExerciseId, 0, 255)))
+	, MaxKeyframeSize(InConfig.MaxKeyframeSize)
+	, Reassembler(InConfig.MaxPendingReassemblies, InConfig.MaxReassembledSize, InConfig.MaxReassemblyBytes, InConfig.ReassemblyTimeoutMs / 1000.0)
+	, LastExpireTime(0.0)
+	, SourceTracker(InConfig.ClockOffsetWindowSeconds)
+	, BundleCount(0)
+	, MalformedCount(0)
+	, InterestPassed(0)
+	, InterestPassedBytes(0)
+	, InterestSuppressed(0)
+	, InterestSuppressedBytes(0)
+	, KeyframeCount(0)
+	, SwarmCount(0)
+	, HeartbeatCount(0)
+{
+	const int32 WorkerCount = FMath::Clamp(InConfig.DecodeWorkerCount, 0, 32);
+	if (WorkerCount == 0)
+	{
+		InlineQueue = MakeUnique<FVistarIngestQueue>(InConfig.IngestQueueCapacity);
+		return;
+	}
+
+	// The decoded capacity is shared out so the total footprint does not grow with the worker count
+	const uint32 OutputCapacity = FMath::Max(InConfig.IngestQueueCapacity / WorkerCount, 1024);
+	const EThreadPriority Priority = FVistarNetworkConfig::ToThreadPriority(InConfig.DecodeWorkerThreadPriority);
+	for (int32 i = 0; i < WorkerCount; ++i)
+	{
+		Workers.Add(MakeUnique<FVistarDecodeWorker>(i, InConfig.DecodeWorkerQueueCapacity, OutputCapacity, InConfig.PooledMessageSlotSize, Priority, Transform));
+	}
+}
+
+FVistarIngestPipeline::~FVistarIngestPipeline()
+{
+	// Joins the worker threads
+	Workers.Reset();
+}
+
+FVistarIngestQueue& FVistarIngestPipeline::GetQueue(int32 Index)
+{
+	return Workers.Num() > 0 ? Workers[Index]->GetOutput() : *InlineQueue;
+}
+
+void FVistarIngestPipeline::GetWorkerStats(TArray<FVistarDecodeWorkerStats>& OutStats) const
+{
+	OutStats.Reset(Workers.Num());
+	for (const TUniquePtr<FVistarDecodeWorker>& Worker : Workers)
+	{
+		OutStats.Add(Worker->GetStats());
+	}
+}
+
+uint64 FVistarIngestPipeline::GetMalformedCount() const
+{
+	uint64 Count = MalformedCount.load(std::memory_order_relaxed) + InlineCounters.Malformed.load(std::memory_order_relaxed);
+	for (const TUniquePtr<FVistarDecodeWorker>& Worker : Workers)
+	{
+		Count += Worker->GetMalformedCount();
+	}
+	return Count;
+}
+
+FVistarIngestAllocStats FVistarIngestPipeline::GetAllocStats() const
+{
+	FVistarIngestAllocStats Stats;
+	Stats.DomDecodes = InlineCounters.DomDecodes.load(std::memory_order_relaxed);
+	Stats.PointArrays = InlineCounters.PointArrays.load(std::memory_order_relaxed);
+	Stats.Reassemblies = Reassembler.GetCompletedCount();
+	for (const TUniquePtr<FVistarDecodeWorker>& Worker : Workers)
+	{
+		Worker->AccumulateAllocStats(Stats);
+	}
+	return Stats;
+}
+
+void FVistarIngestPipeline::HandleDatagram(const uint8* Data, int32 Size)
+{
+	LLM_SCOPE_BYTAG(VistarIngest);
+
+	FVistarDatagramMeta Meta;
+	Meta.ReceiveTimeUs = FVistarSequence::GetLocalTimeUs();
+
+	if (FVistarSequence::IsSequenced(Data, Size))
+	{
+		FVistarSequence::FHeader Header;
+		if (!FVistarSequence::ReadHeader(Data, Size, Header))
+		{
+			MalformedCount.fetch_add(1, std::memory_order_relaxed);
+			UE_LOG(LogTemp, Error, TEXT("VistarIngest: unsupported sequence header version %d"), Data[1]);
+			return;
+		}
+		if (!SourceTracker.Track(Header, Meta.ReceiveTimeUs, Meta.SendTimeLocalUs))
+		{
+			return;
+		}
+		Meta.Sequence = Header.Sequence;
+		Meta.SourceId = Header.SourceId;
+		Meta.bHasSequence = true;
+
+		Data += FVistarSequence::HeaderSize;
+		Size -= FVistarSequence::HeaderSize;
+	}
+
+	if (FVistarFragment::IsFragment(Data, Size))
+	{
+		HandleFragment(Data, Size, Meta);
+		return;
+	}
+	HandleFrame(Data, Size, Meta);
+}
+
+void FVistarIngestPipeline::HandleFragment(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// Stale entries are only swept while fragments flow, the table bound covers the rest
+	if (Now - LastExpireTime > 0.25)
+	{
+		Reassembler.Expire(Now);
+		LastExpireTime = Now;
+	}
+
+	// The completed message carries the meta of its last fragment
+	const bool bValid = Reassembler.Add(Data, Size, Now, [this, &Meta](const uint8* Message, int32 MessageSize)
+	{
+		// Fragments never nest
+		if (FVistarFragment::IsFragment(Message, MessageSize))
+		{
+			MalformedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		HandleFrame(Message, MessageSize, Meta);
+	});
+
+	if (!bValid)
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed or oversize fragment of %d bytes"), Size);
+	}
+}
+
+void FVistarIngestPipeline::HandleFrame(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta)
+{
+	if (FVistarKeyframe::IsKeyframe(Data, Size))
+	{
+		HandleKeyframe(Data, Size, Meta);
+		return;
+	}
+
+	// DIS brings its own framing, each PDU carries its length
+	if (FVistarDis::IsDis(Data, Size))
+	{
+		const bool bComplete = FVistarDis::ForEachPdu(Data, Size, [this, &Meta](const uint8* Pdu, int32 PduSize)
+		{
+			HandleMessage(Pdu, PduSize, Meta);
+		});
+		if (!bComplete)
+		{
+			MalformedCount.fetch_add(1, std::memory_order_relaxed);
+			UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed DIS datagram of %d bytes"), Size);
+		}
+		return;
+	}
+
+	if (!FVistarBundle::IsBundle(Data, Size))
+	{
+		HandleMessage(Data, Size, Meta);
+		return;
+	}
+
+	// Bundles are split here so each message is routed by its own entity
+	BundleCount.fetch_add(1, std::memory_order_relaxed);
+	const bool bComplete = FVistarBundle::ForEachMessage(Data, Size, [this, &Meta](const uint8* Message, int32 MessageSize)
+	{
+		HandleMessage(Message, MessageSize, Meta);
+	});
+
+	if (!bComplete)
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed bundle of %d bytes"), Size);
+	}
+}
+
+void FVistarIngestPipeline::HandleKeyframe(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta)
+{
+	uint32 KeyframeId = 0;
+	if (!FVistarKeyframe::Decode(Data, Size, MaxKeyframeSize, KeyframeId, KeyframeBody))
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed or oversize keyframe of %d bytes"), Size);
+		return;
+	}
+
+	// Decoded here in one go rather than by the workers, the game thread applies the keyframe as a whole
+	TArray<FVistarEntityUpdate> Entries;
+	const auto Push = [&Entries](FVistarEntityUpdate&& Message) { Entries.Add(MoveTemp(Message)); };
+	bool bComplete = true;
+	if (FVistarBundle::IsBundle(KeyframeBody.GetData(), KeyframeBody.Num()))
+	{
+		bComplete = FVistarBundle::ForEachMessage(KeyframeBody.GetData(), KeyframeBody.Num(), [this, &Meta, &Push](const uint8* Message, int32 MessageSize)
+		{
+			DecodeMessage(Message, MessageSize, Meta, Transform, Push, InlineCounters);
+		});
+	}
+	else
+	{
+		bComplete = DecodeMessage(KeyframeBody.GetData(), KeyframeBody.Num(), Meta, Transform, Push, InlineCounters);
+	}
+	if (!bComplete)
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: keyframe %u is damaged, applying the %d entities before the damage"), KeyframeId, Entries.Num());
+	}
+	KeyframeCount.fetch_add(1, std::memory_order_relaxed);
+
+	// Several keyframes (one per source, or a scene split in parts) may land before the game thread looks
+	FScopeLock Lock(&KeyframeLock);
+	if (PendingKeyframe.Num() == 0)
+	{
+		PendingKeyframe = MoveTemp(Entries);
+	}
+	else
+	{
+		PendingKeyframe.Append(MoveTemp(Entries));
+	}
+}
+
+bool FVistarIngestPipeline::TakeKeyframe(TArray<FVistarEntityUpdate>& OutEntries)
+{
+	FScopeLock Lock(&KeyframeLock);
+	if (PendingKeyframe.Num() == 0)
+	{
+		return false;
+	}
+	OutEntries = MoveTemp(PendingKeyframe);
+	PendingKeyframe.Reset();
+	return true;
+}
+
+void FVistarIngestPipeline::HandleSwarm(const uint8* Data, int32 Size)
+{
+	// Decoded here, a whole swarm is one entry for the game thread and never occupies a queue slot per member
+	FVistarSwarmUpdate Swarm;
+	if (!FVistarSwarm::Decode(Data, Size, Swarm))
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed swarm message of %d bytes"), Size);
+		return;
+	}
+	if (!Transform.Apply(Swarm.Reference) || !FVistarSwarm::CanNameMembers(Swarm))
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: swarm ID %s too long for its member IDs, dropped"), *Swarm.Reference.Id.ToString());
+		return;
+	}
+	SwarmCount.fetch_add(1, std::memory_order_relaxed);
+
+	// A newer state of the same members replaces the one the game thread has not taken yet
+	FScopeLock Lock(&SwarmLock);
+	for (FVistarSwarmUpdate& Pending : PendingSwarms)
+	{
+		if (Pending.FirstMember == Swarm.FirstMember && Pending.Reference.Id == Swarm.Reference.Id)
+		{
+			Pending = MoveTemp(Swarm);
+			return;
+		}
+	}
+	PendingSwarms.Add(MoveTemp(Swarm));
+}
+
+bool FVistarIngestPipeline::TakeSwarms(TArray<FVistarSwarmUpdate>& OutSwarms)
+{
+	FScopeLock Lock(&SwarmLock);
+	if (PendingSwarms.Num() == 0)
+	{
+		return false;
+	}
+	Swap(OutSwarms, PendingSwarms);
+	PendingSwarms.Reset();
+	return true;
+}
+
+void FVistarIngestPipeline::HandleHeartbeat(const uint8* Data, int32 Size)
+{
+	FVistarHeartbeat Heartbeat;
+	if (!FVistarHeartbeat::Decode(Data, Size, Heartbeat))
+	{
+		MalformedCount.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: malformed heartbeat of %d bytes"), Size);
+		return;
+	}
+	// An ID too long for its prefix names no entity here, and a truncated one would renew another
+	for (int32 i = Heartbeat.Ids.Num() - 1; i >= 0; --i)
+	{
+		if (!Transform.ApplyId(Heartbeat.Ids[i]))
+		{
+			Heartbeat.Ids.RemoveAtSwap(i, 1, EAllowShrinking::No);
+		}
+	}
+	HeartbeatCount.fetch_add(1, std::memory_order_relaxed);
+
+	FScopeLock Lock(&HeartbeatLock);
+	PendingHeartbeats.Add(MoveTemp(Heartbeat));
+}
+
+bool FVistarIngestPipeline::TakeHeartbeats(TArray<FVistarHeartbeat>& OutHeartbeats)
+{
+	FScopeLock Lock(&HeartbeatLock);
+	if (PendingHeartbeats.Num() == 0)
+	{
+		return false;
+	}
+	Swap(OutHeartbeats, PendingHeartbeats);
+	PendingHeartbeats.Reset();
+	return true;
+}
+
+void FVistarIngestPipeline::HandleMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta)
+{
+	if (FVistarInterest::IsInterest(Data, Size))
+	{
+		HandleInterest(Data, Size);
+		return;
+	}
+	if (FVistarSwarm::IsSwarm(Data, Size))
+	{
+		HandleSwarm(Data, Size);
+		return;
+	}
+	if (FVistarHeartbeat::IsHeartbeat(Data, Size))
+	{
+		HandleHeartbeat(Data, Size);
+		return;
+	}
+	if (DisExerciseId != 0 && FVistarDis::IsDis(Data, Size) && FVistarDis::GetExerciseId(Data) != DisExerciseId)
+	{
+		return;
+	}
+
+	if (Workers.Num() == 0)
+	{
+		DecodeMessage(Data, Size, Meta, Transform, *InlineQueue, InlineCounters);
+		return;
+	}
+
+	Workers[SelectWorker(Data, Size)]->Push(Data, Size, Meta, SelectLane(Data, Size));
+}
+
+EVistarLane FVistarIngestPipeline::SelectLane(const uint8* Data, int32 Size)
+{
+	// A relay part with any event in it keeps its place in front of the state updates
+	if (FVistarRelayFrame::IsFrame(Data, Size))
+	{
+		return FVistarRelayFrame::HasEvents(Data, Size) ? EVistarLane::Control : EVistarLane::Bulk;
+	}
+
+	EVistarStream Stream = EVistarStream::None;
+	bool bFound = false;
+	if (FVistarBinaryCodec::IsBinary(Data, Size))
+	{
+		bFound = FVistarBinaryCodec::PeekStream(Data, Size, Stream);
+	}
+	else if (FVistarDis::IsDis(Data, Size))
+	{
+		bFound = FVistarDis::PeekStream(Data, Size, Stream);
+	}
+	else
+	{
+		bFound = FVistarJsonDecoder::PeekStream(Data, Size, Stream);
+	}
+
+	// Control messages and anything unreadable are decoded (or rejected) with the updates
+	return bFound ? VistarLaneOf(Stream) : EVistarLane::Bulk;
+}
+
+void FVistarIngestPipeline::HandleInterest(const uint8* Data, int32 Size)
+{
+	// Area messages are only meant for filters, a viewer seeing one is listening to another viewer
+	FVistarInterestReport Report;
+	if (!FVistarInterest::ReadReport(Data, Size, Report))
+	{
+		return;
+	}
+	InterestPassed.store(Report.Passed, std::memory_order_relaxed);
+	InterestPassedBytes.store(Report.PassedBytes, std::memory_order_relaxed);
+	InterestSuppressed.store(Report.Suppressed, std::memory_order_relaxed);
+	InterestSuppressedBytes.store(Report.SuppressedBytes, std::memory_order_relaxed);
+}
+
+FVistarInterestReport FVistarIngestPipeline::GetInterestReport() const
+{
+	FVistarInterestReport Report;
+	Report.Passed = InterestPassed.load(std::memory_order_relaxed);
+	Report.PassedBytes = InterestPassedBytes.load(std::memory_order_relaxed);
+	Report.Suppressed = InterestSuppressed.load(std::memory_order_relaxed);
+	Report.SuppressedBytes = InterestSuppressedBytes.load(std::memory_order_relaxed);
+	return Report;
+}
+
+int32 FVistarIngestPipeline::SelectWorker(const uint8* Data, int32 Size) const
+{
+	const ANSICHAR* Id = nullptr;
+	int32 Length = 0;
+	bool bFound = false;
+	if (FVistarBinaryCodec::IsBinary(Data, Size))
+	{
+		bFound = FVistarBinaryCodec::PeekId(Data, Size, Id, Length);
+	}
+	else if (FVistarDis::IsDis(Data, Size))
+	{
+		bFound = FVistarDis::PeekId(Data, Size, Id, Length);
+	}
+	else
+	{
+		bFound = FVistarJsonDecoder::PeekId(Data, Size, Id, Length);
+	}
+
+	// Control messages and anything unreadable carry no entity, worker 0 decodes (or rejects) them
+	if (!bFound)
+	{
+		return 0;
+	}
+
+	// FNV-1a, cheap and spreads short sequential IDs (F16_1, F16_2, ...) well
+	uint32 Hash = 2166136261u;
+	for (int32 i = 0; i < Length; ++i)
+	{
+		Hash = (Hash ^ static_cast<uint8>(Id[i])) * 16777619u;
+	}
+	return static_cast<int32>(Hash % static_cast<uint32>(Workers.Num()));
+}
+
+bool FVistarIngestPipeline::DecodeMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, const FVistarSourceTransform& Transform,
+	FVistarIngestQueue& OutQueue, FVistarDecodeCounters& Counters)
+{
+	return DecodeMessage(Data, Size, Meta, Transform, [&OutQueue](FVistarEntityUpdate&& Message) { OutQueue.Push(MoveTemp(Message)); }, Counters);
+}
+
+bool FVistarIngestPipeline::DecodeMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, const FVistarSourceTransform& Transform,
+	TFunctionRef<void(FVistarEntityUpdate&&)> Push, FVistarDecodeCounters& Counters)
+{
+	// Relay frames carry many entries, already converted, each one is pushed on its own
+	if (FVistarRelayFrame::IsFrame(Data, Size))
+	{
+		const bool bComplete = FVistarRelayFrame::ForEachEntry(Data, Size, [&Meta, &Transform, &Push, &Counters](FVistarEntityUpdate& Entry)
+		{
+			if (!Transform.IsIdentity() && !Transform.Apply(Entry))
+			{
+				Counters.Malformed.fetch_add(1, std::memory_order_relaxed);
+				UE_LOG(LogTemp, Error, TEXT("VistarIngest: ID %s too long with the source prefix, dropped"), *Entry.Id.ToString());
+				return;
+			}
+			Entry.Meta = Meta;
+			Push(MoveTemp(Entry));
+		});
+		if (!bComplete)
+		{
+			Counters.Malformed.fetch_add(1, std::memory_order_relaxed);
+			UE_LOG(LogTemp, Error, TEXT("Failed to parse relay frame!"));
+		}
+		return bComplete;
+	}
+
+	// Binary and DIS messages are told apart from JSON by their first byte
+	FVistarEntityUpdate Message;
+	EVistarDecodeResult Result;
+	const TCHAR* Format;
+	if (FVistarBinaryCodec::IsBinary(Data, Size))
+	{
+		Result = FVistarBinaryCodec::Decode(Data, Size, Message);
+		Format = TEXT("binary");
+	}
+	else if (FVistarDis::IsDis(Data, Size))
+	{
+		Result = FVistarDis::Decode(Data, Size, Message);
+		Format = TEXT("DIS");
+	}
+	else
+	{
+		Result = FVistarJsonDecoder::Decode(Data, Size, Message);
+		Format = TEXT("JSON");
+	}
+
+	if (Result == EVistarDecodeResult::Malformed)
+	{
+		Counters.Malformed.fetch_add(1, std::memory_order_relaxed);
+		UE_LOG(LogTemp, Error, TEXT("Failed to parse %s message!"), Format);
+		return false;
+	}
+
+	// The only decode results that own heap memory
+	if (Result == EVistarDecodeResult::DomFallback)
+	{
+		Counters.DomDecodes.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (Message.Points.Num() > 0)
+	{
+		Counters.PointArrays.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (Result != EVistarDecodeResult::Ignored)
+	{
+		// Truncating would merge the entity with any other of the same leading characters
+		if (!Transform.IsIdentity() && !Transform.Apply(Message))
+		{
+			Counters.Malformed.fetch_add(1, std::memory_order_relaxed);
+			UE_LOG(LogTemp, Error, TEXT("VistarIngest: %s message ID %s too long with the source prefix, dropped"), Format, *Message.Id.ToString());
+			return false;
+		}
+		Message.Meta = Meta;
+		Push(MoveTemp(Message));
+	}
+	return true;
+}
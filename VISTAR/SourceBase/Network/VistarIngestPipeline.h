@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.h"
+#include "VistarIngestQueue.h"
+#include "VistarDecodeWorker.h"
+#include "VistarFragment.h"
+#include "VistarMessagePool.h"
+#include "VistarSequence.h"
+#include "VistarInterest.h"
+#include "VistarSwarm.h"
+#include "VistarLease.h"
+#include "HAL/LowLevelMemTracker.h"
+#include <atomic>
+
+// Everything the ingest threads allocate, visible under this tag with -llm
+LLM_DECLARE_TAG_API(VistarIngest, VISTAR_API);
+
+/**
+ * Receiver-thread half of the ingest path
+ * Takes raw datagrams from FUdpCommunicator, strips the optional sequence header, reassembles fragments
+ * and unpacks bundle frames or back to back DIS PDUs. Then either decodes the JSON, binary or
+ * DIS messages in place, or with DecodeWorkerCount > 0 hands them to decode workers picked by a hash
+ * of the entity ID, so every entity is decoded by one thread and keeps its order.
+ * The game thread drains one output queue per worker (a single queue without workers), control lane
+ * first, see EVistarLane.
+ * Must not touch UObjects, everything here runs off the game thread.
+ */
+class VISTAR_API FVistarIngestPipeline
+{
+public:
+	// InTransform maps the IDs and positions of a federated source, see FVistarIngestSource
+	explicit FVistarIngestPipeline(const FVistarNetworkConfig& InConfig, const FVistarSourceTransform& InTransform = FVistarSourceTransform());
+	~FVistarIngestPipeline();
+
+	// Receiver thread, bound as the FOnUdpDataReceived callback
+	void HandleDatagram(const uint8* Data, int32 Size);
+
+	// Game thread side, drain every queue once per frame
+	int32 GetNumQueues() const { return Workers.Num() > 0 ? Workers.Num() : 1; }
+	FVistarIngestQueue& GetQueue(int32 Index);
+
+	int32 GetNumWorkers() const { return Workers.Num(); }
+	void GetWorkerStats(TArray<FVistarDecodeWorkerStats>& OutStats) const;
+
+	uint64 GetBundleCount() const { return BundleCount.load(std::memory_order_relaxed); }
+	uint64 GetMalformedCount() const;
+
+	const FVistarReassembler& GetReassembler() const { return Reassembler; }
+
+	// Heap allocations on the receive and decode threads, see FVistarIngestAllocStats
+	FVistarIngestAllocStats GetAllocStats() const;
+
+	// Loss, reordering and clock offset per source of sequenced datagrams
+	void GetSourceStats(TArray<FVistarSourceStats>& OutStats) const { SourceTracker.GetStats(OutStats); }
+
+	// Latest totals reported by an interest filter upstream, zero when there is none
+	FVistarInterestReport GetInterestReport() const;
+
+	// Entities of the keyframes received since the last call, parents not necessarily first. Game thread
+	bool TakeKeyframe(TArray<FVistarEntityUpdate>& OutEntries);
+
+	uint64 GetKeyframeCount() const { return KeyframeCount.load(std::memory_order_relaxed); }
+
+	// Swarm messages received since the last call, the newest per swarm and member range. Game thread
+	bool TakeSwarms(TArray<FVistarSwarmUpdate>& OutSwarms);
+
+	uint64 GetSwarmCount() const { return SwarmCount.load(std::memory_order_relaxed); }
+
+	// Heartbeat parts received since the last call, IDs already mapped by the source transform. Game thread
+	bool TakeHeartbeats(TArray<FVistarHeartbeat>& OutHeartbeats);
+
+	uint64 GetHeartbeatCount() const { return HeartbeatCount.load(std::memory_order_relaxed); }
+
+	// Decode one JSON, binary, DIS message or relay frame and queue it stamped with Meta, false if it was malformed
+	static bool DecodeMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, const FVistarSourceTransform& Transform,
+		FVistarIngestQueue& OutQueue, FVistarDecodeCounters& Counters);
+
+	// Same, handing the decoded messages to Push
+	static bool DecodeMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta, const FVistarSourceTransform& Transform,
+		TFunctionRef<void(FVistarEntityUpdate&&)> Push, FVistarDecodeCounters& Counters);
+
+private:
+	void HandleFragment(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta);
+
+	// A whole datagram or reassembled message, bundle or single message
+	void HandleFrame(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta);
+
+	void HandleMessage(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta);
+
+	// Decompresses and decodes a keyframe for TakeKeyframe
+	void HandleKeyframe(const uint8* Data, int32 Size, const FVistarDatagramMeta& Meta);
+
+	// Decodes a swarm message for TakeSwarms
+	void HandleSwarm(const uint8* Data, int32 Size);
+
+	// Decodes a heartbeat part for TakeHeartbeats
+	void HandleHeartbeat(const uint8* Data, int32 Size);
+
+	int32 SelectWorker(const uint8* Data, int32 Size) const;
+	static EVistarLane SelectLane(const uint8* Data, int32 Size);
+
+	// Interest messages are consumed here, they never reach the decoders
+	void HandleInterest(const uint8* Data, int32 Size);
+
+	// Read by the decode workers, never changes after construction
+	const FVistarSourceTransform Transform;
+
+	// DIS PDUs of other exercises are dropped before decoding, 0 keeps all
+	const uint8 DisExerciseId;
+
+	const int32 MaxKeyframeSize;
+
+	// Decoded messages when decoding inline on the receiver thread
+	TUniquePtr<FVistarIngestQueue> InlineQueue;
+	TArray<TUniquePtr<FVistarDecodeWorker>> Workers;
+
+	FVistarReassembler Reassembler;
+	double LastExpireTime;
+
+	FVistarSourceTracker SourceTracker;
+
+	// Bundle frames unpacked
+	std::atomic<uint64> BundleCount;
+	// Bundles or fragments that failed to unpack
+	std::atomic<uint64> MalformedCount;
+	// Decodes done on the receiver thread itself
+	FVistarDecodeCounters InlineCounters;
+
+	// Last FVistarInterestReport, published field by field
+	std::atomic<uint64> InterestPassed;
+	std::atomic<uint64> InterestPassedBytes;
+	std::atomic<uint64> InterestSuppressed;
+	std::atomic<uint64> InterestSuppressedBytes;
+
+	// Decompressed keyframe, receiver thread only
+	TArray<uint8> KeyframeBody;
+	// Decoded keyframe entities waiting for the game thread
+	FCriticalSection KeyframeLock;
+	TArray<FVistarEntityUpdate> PendingKeyframe;
+	std::atomic<uint64> KeyframeCount;
+
+	// Decoded swarms waiting for the game thread, one entry per swarm and member range
+	FCriticalSection SwarmLock;
+	TArray<FVistarSwarmUpdate> PendingSwarms;
+	std::atomic<uint64> SwarmCount;
+
+	// Decoded heartbeat parts waiting for the game thread
+	FCriticalSection HeartbeatLock;
+	TArray<FVistarHeartbeat> PendingHeartbeats;
+	std::atomic<uint64> HeartbeatCount;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "Containers/SpscQueue.h"
+#include "VistarMessage.h"
+#include <atomic>
+
+/**
+ * Lock-free single-producer/single-consumer queue of decoded messages, one lane each
+ * The receiver thread pushes, the game thread drains once per frame. The bulk lane is a bounded ring,
+ * the control lane is unbounded so a burst of updates can never push out an event
+ */
+class VISTAR_API FVistarIngestQueue
+{
+public:
+	explicit FVistarIngestQueue(uint32 Capacity)
+		: Ring(Capacity + 1), ControlCount(0), Dropped(0)
+	{
+	}
+
+	// Producer side. A full bulk ring drops the update rather than blocking the receiver
+	bool Push(FVistarEntityUpdate&& Message)
+	{
+		if (VistarLaneOf(Message.Stream) == EVistarLane::Control)
+		{
+			Control.Enqueue(MoveTemp(Message));
+			ControlCount.fetch_add(1, std::memory_order_release);
+			return true;
+		}
+		if (Ring.Enqueue(MoveTemp(Message)))
+		{
+			return true;
+		}
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Consumer side. Pop at most Num(Lane) messages per pass, the control count trails its queue
+	bool Pop(EVistarLane Lane, FVistarEntityUpdate& OutMessage)
+	{
+		if (Lane == EVistarLane::Bulk)
+		{
+			return Ring.Dequeue(OutMessage);
+		}
+		if (TOptional<FVistarEntityUpdate> Message = Control.Dequeue())
+		{
+			ControlCount.fetch_sub(1, std::memory_order_relaxed);
+			OutMessage = MoveTemp(Message.GetValue());
+			return true;
+		}
+		return false;
+	}
+
+	uint32 Num(EVistarLane Lane) const { return Lane == EVistarLane::Bulk ? Ring.Count() : ControlCount.load(std::memory_order_acquire); }
+	uint32 Num() const { return Num(EVistarLane::Control) + Num(EVistarLane::Bulk); }
+
+	// Bulk lane only, the control lane does not drop
+	uint64 GetDroppedCount() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+	TCircularQueue<FVistarEntityUpdate> Ring;
+	// Keeps its nodes for reuse, so steady traffic does not allocate
+	TSpscQueue<FVistarEntityUpdate> Control;
+	std::atomic<uint32> ControlCount;
+	std::atomic<uint64> Dropped;
+};
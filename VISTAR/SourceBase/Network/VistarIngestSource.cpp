@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarIngestSource.h"
+
+FVistarIngestSource::FVistarIngestSource(const FVistarIngestSourceConfig& InSource, const FVistarNetworkConfig& InConfig)
+	: Source(InSource)
+	, Config(InConfig)
+{
+	// The source settings take the place of the primary receiver's
+	Config.Transport = Source.Transport;
+	Config.MulticastGroup = Source.MulticastGroup;
+	Config.SharedMemoryName = Source.SharedMemoryName;
+
+	Pipeline = MakeUnique<FVistarIngestPipeline>(Config, MakeTransform(Source));
+	Callback.BindRaw(Pipeline.Get(), &FVistarIngestPipeline::HandleDatagram);
+}
+
+FVistarIngestSource::~FVistarIngestSource()
+{
+	Communicator.Shutdown();
+	Pipeline.Reset();
+}
+
+FVistarSourceTransform FVistarIngestSource::MakeTransform(const FVistarIngestSourceConfig& InSource)
+{
+	FVistarSourceTransform Transform;
+	if (InSource.bNamespaceIds && !InSource.Name.IsEmpty())
+	{
+		Transform.IdPrefix = FVistarInlineString(InSource.Name + TEXT(":"));
+	}
+	Transform.LatOffset = InSource.LatOffset;
+	Transform.LonOffset = InSource.LonOffset;
+	Transform.AltOffset = InSource.AltOffset;
+	return Transform;
+}
+
+bool FVistarIngestSource::Start()
+{
+	bool bStarted = false;
+	if (Source.Transport == EVistarTransport::SharedMemory)
+	{
+		if (Source.SharedMemoryName.IsEmpty())
+		{
+			UE_LOG(LogTemp, Error, TEXT("VistarIngest: source '%s' has no SharedMemoryName"), *Source.Name);
+			return false;
+		}
+		bStarted = Communicator.StartSharedMemoryReceiver(Callback, Config);
+	}
+	else
+	{
+		bStarted = Communicator.StartReceiver(Source.Port, Callback, Config);
+	}
+
+	if (!bStarted)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarIngest: could not start source '%s'"), *Source.Name);
+		return false;
+	}
+	const FString Endpoint = Source.Transport == EVistarTransport::SharedMemory ? Source.SharedMemoryName : FString::FromInt(Source.Port);
+	UE_LOG(LogTemp, Log, TEXT("VistarIngest: source '%s' receiving on %s"), *Source.Name, *Endpoint);
+	return true;
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FUdpCommunicator.h"
+#include "VistarIngestPipeline.h"
+
+/**
+ * Receive figures of one ingest source, see UVistarGameInstance::GetIngestSourceStats
+ */
+struct FVistarIngestSourceStats
+{
+	FString Name;
+	uint64 Datagrams = 0;
+	uint64 Bytes = 0;
+	// Messages the game thread took from this source
+	uint64 Messages = 0;
+	uint64 ParseFailures = 0;
+	uint32 QueueDepth = 0;
+	// Over the last second
+	double DatagramRate = 0.0;
+	double MessageRate = 0.0;
+};
+
+/**
+ * One federated simulator: its own receiver thread (socket or shared memory ring) and its own
+ * FVistarIngestPipeline, so every source has a single producer and ingest capacity grows with the
+ * number of sources. IDs and positions are mapped into the shared entity directory on the decoding
+ * thread, see FVistarSourceTransform. Receive only, outbound traffic uses the primary receiver.
+ */
+class VISTAR_API FVistarIngestSource
+{
+public:
+	FVistarIngestSource(const FVistarIngestSourceConfig& InSource, const FVistarNetworkConfig& InConfig);
+	// Stops the receiver before the pipeline it feeds goes away
+	~FVistarIngestSource();
+
+	bool Start();
+
+	const FString& GetName() const { return Source.Name; }
+	FVistarIngestPipeline& GetPipeline() { return *Pipeline; }
+	const FVistarIngestPipeline& GetPipeline() const { return *Pipeline; }
+	const FUdpCommunicator& GetCommunicator() const { return Communicator; }
+
+	static FVistarSourceTransform MakeTransform(const FVistarIngestSourceConfig& InSource);
+
+private:
+	FVistarIngestSourceConfig Source;
+	FVistarNetworkConfig Config;
+	TUniquePtr<FVistarIngestPipeline> Pipeline;
+	FOnUdpDataReceived Callback;
+	FUdpCommunicator Communicator;
+};
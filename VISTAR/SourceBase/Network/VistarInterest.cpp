@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarInterest.h"
+
+namespace
+{
+	// Meters per degree of latitude, the areas are small enough for a flat approximation
+	constexpr double MetersPerDegree = 111320.0;
+
+	template <typename T>
+	FORCEINLINE T ReadAt(const uint8* Data, int32 Offset)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		return Value;
+	}
+
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+
+	uint8* AppendHeader(TArray<uint8>& OutBuffer, FVistarInterest::EType Type, int32 Size)
+	{
+		const int32 Start = OutBuffer.AddZeroed(Size);
+		uint8* Out = OutBuffer.GetData() + Start;
+		Out[0] = FVistarInterest::Magic;
+		Out[1] = FVistarInterest::Version;
+		Out[2] = static_cast<uint8>(Type);
+		return Out;
+	}
+
+	bool IsType(const uint8* Data, int32 Size, FVistarInterest::EType Type, int32 BodySize)
+	{
+		return Size >= BodySize && Data[0] == FVistarInterest::Magic && Data[1] == FVistarInterest::Version
+			&& Data[2] == static_cast<uint8>(Type);
+	}
+}
+
+bool FVistarInterestArea::Contains(double InLat, double InLon) const
+{
+	const double North = (InLat - Lat) * MetersPerDegree;
+	const double East = (InLon - Lon) * MetersPerDegree * FMath::Cos(FMath::DegreesToRadians(Lat));
+	return North * North + East * East <= static_cast<double>(RadiusMeters) * RadiusMeters;
+}
+
+void FVistarInterest::WriteArea(const FVistarInterestArea& Area, TArray<uint8>& OutBuffer)
+{
+	uint8* Out = AppendHeader(OutBuffer, EType::Area, AreaSize);
+	WriteAt<uint32>(Out, 4, Area.ViewerId);
+	WriteAt<double>(Out, 8, Area.Lat);
+	WriteAt<double>(Out, 16, Area.Lon);
+	WriteAt<float>(Out, 24, Area.RadiusMeters);
+	WriteAt<float>(Out, 28, Area.OutsideRateHz);
+	WriteAt<uint32>(Out, 32, Area.ClassMask);
+}
+
+void FVistarInterest::WriteReport(const FVistarInterestReport& Report, TArray<uint8>& OutBuffer)
+{
+	uint8* Out = AppendHeader(OutBuffer, EType::Report, ReportSize);
+	WriteAt<uint32>(Out, 4, Report.ViewerId);
+	WriteAt<uint64>(Out, 8, Report.Passed);
+	WriteAt<uint64>(Out, 16, Report.PassedBytes);
+	WriteAt<uint64>(Out, 24, Report.Suppressed);
+	WriteAt<uint64>(Out, 32, Report.SuppressedBytes);
+}
+
+bool FVistarInterest::ReadArea(const uint8* Data, int32 Size, FVistarInterestArea& OutArea)
+{
+	if (!IsType(Data, Size, EType::Area, AreaSize))
+	{
+		return false;
+	}
+	OutArea.ViewerId = ReadAt<uint32>(Data, 4);
+	OutArea.Lat = ReadAt<double>(Data, 8);
+	OutArea.Lon = ReadAt<double>(Data, 16);
+	OutArea.RadiusMeters = ReadAt<float>(Data, 24);
+	OutArea.OutsideRateHz = ReadAt<float>(Data, 28);
+	OutArea.ClassMask = ReadAt<uint32>(Data, 32);
+	return true;
+}
+
+bool FVistarInterest::ReadReport(const uint8* Data, int32 Size, FVistarInterestReport& OutReport)
+{
+	if (!IsType(Data, Size, EType::Report, ReportSize))
+	{
+		return false;
+	}
+	OutReport.ViewerId = ReadAt<uint32>(Data, 4);
+	OutReport.Passed = ReadAt<uint64>(Data, 8);
+	OutReport.PassedBytes = ReadAt<uint64>(Data, 16);
+	OutReport.Suppressed = ReadAt<uint64>(Data, 24);
+	OutReport.SuppressedBytes = ReadAt<uint64>(Data, 32);
+	return true;
+}
+
+FVistarInterestFilter::FVistarInterestFilter(double InTimeoutSeconds)
+	: TimeoutSeconds(InTimeoutSeconds)
+{
+}
+
+void FVistarInterestFilter::Subscribe(const FVistarInterestArea& Area, double Now)
+{
+	for (FSubscriber& Subscriber : Subscribers)
+	{
+		if (Subscriber.Area.ViewerId == Area.ViewerId)
+		{
+			Subscriber.Area = Area;
+			Subscriber.LastSeen = Now;
+			return;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("VistarInterest: viewer %u subscribed, %.0f m around %.4f %.4f"), Area.ViewerId, Area.RadiusMeters, Area.Lat, Area.Lon);
+	FSubscriber& Subscriber = Subscribers.AddDefaulted_GetRef();
+	Subscriber.Area = Area;
+	Subscriber.LastSeen = Now;
+}
+
+void FVistarInterestFilter::Expire(double Now)
+{
+	for (int32 i = Subscribers.Num() - 1; i >= 0; --i)
+	{
+		if (Now - Subscribers[i].LastSeen > TimeoutSeconds)
+		{
+			UE_LOG(LogTemp, Log, TEXT("VistarInterest: viewer %u timed out"), Subscribers[i].Area.ViewerId);
+			Subscribers.RemoveAtSwap(i);
+		}
+	}
+}
+
+bool FVistarInterestFilter::Accept(const FVistarEntityUpdate& Message, int32 Bytes, double Now)
+{
+	bool bPass = true;
+
+	if (Message.Stream == EVistarStream::Delete)
+	{
+		Entities.Remove(Message.Id);
+	}
+	else if (Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update)
+	{
+		FEntityState& State = Entities.FindOrAdd(Message.Id);
+		// A delta may carry only one of the two
+		const uint8 Components = Message.GetComponents();
+		State.Lat = (Components & Component_Lat) ? Message.Lat : State.Lat;
+		State.Lon = (Components & Component_Lon) ? Message.Lon : State.Lon;
+		State.bHasLocation |= Message.bHasLocation;
+
+		Expire(Now);
+		// Without a position there is nothing to filter on
+		if (Message.Stream == EVistarStream::Update && Subscribers.Num() > 0 && State.bHasLocation)
+		{
+			float OutsideRateHz = 0.0f;
+			bool bInside = false;
+			for (const FSubscriber& Subscriber : Subscribers)
+			{
+				if (Subscriber.Area.WantsClass(Message.Class) && Subscriber.Area.Contains(State.Lat, State.Lon))
+				{
+					bInside = true;
+					break;
+				}
+				OutsideRateHz = FMath::Max(OutsideRateHz, Subscriber.Area.OutsideRateHz);
+			}
+
+			if (!bInside)
+			{
+				bPass = OutsideRateHz > 0.0f && Now - State.LastOutsideSend >= 1.0 / OutsideRateHz;
+				if (bPass)
+				{
+					State.LastOutsideSend = Now;
+				}
+			}
+		}
+	}
+
+	if (bPass)
+	{
+		++Report.Passed;
+		Report.PassedBytes += Bytes;
+	}
+	else
+	{
+		++Report.Suppressed;
+		Report.SuppressedBytes += Bytes;
+	}
+	return bPass;
+}
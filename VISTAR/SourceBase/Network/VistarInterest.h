@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * Area a viewer wants full-rate updates for, published periodically by UVistarGameInstance
+ */
+struct FVistarInterestArea
+{
+	uint32 ViewerId = 0;
+	double Lat = 0.0;
+	double Lon = 0.0;
+	float RadiusMeters = 0.0f;
+	// Update rate per entity outside the area, 0 = not sent at all
+	float OutsideRateHz = 0.0f;
+	// Bit per EVistarClassType, classes not in the mask count as outside. 0 = every class
+	uint32 ClassMask = 0;
+
+	bool Contains(double InLat, double InLon) const;
+	bool WantsClass(EVistarClassType Class) const { return ClassMask == 0 || (ClassMask & (1u << static_cast<uint32>(Class))) != 0; }
+};
+
+/**
+ * What an interest filter let through and held back, totals since the filter started
+ */
+struct FVistarInterestReport
+{
+	// 0 = the filter as a whole
+	uint32 ViewerId = 0;
+	uint64 Passed = 0;
+	uint64 PassedBytes = 0;
+	uint64 Suppressed = 0;
+	uint64 SuppressedBytes = 0;
+};
+
+/**
+ * Area-of-interest messages between a viewer and an interest filter
+ *   u8 Magic (0xB9), u8 Version, u8 Type, u8 Reserved, then the fixed body of the type
+ * The viewer sends Area messages on its outbound socket. The filter sends Report messages as part of
+ * the normal traffic, they may be bundled or sequenced like any other message.
+ */
+class VISTAR_API FVistarInterest
+{
+public:
+	static constexpr uint8 Magic = 0xB9;
+	static constexpr uint8 Version = 1;
+
+	enum class EType : uint8
+	{
+		Area	= 1,
+		Report	= 2,
+	};
+
+	static constexpr int32 AreaSize = 40;
+	static constexpr int32 ReportSize = 40;
+
+	static bool IsInterest(const uint8* Data, int32 Size) { return Size >= 4 && Data[0] == Magic; }
+
+	// Append one encoded message to OutBuffer
+	static void WriteArea(const FVistarInterestArea& Area, TArray<uint8>& OutBuffer);
+	static void WriteReport(const FVistarInterestReport& Report, TArray<uint8>& OutBuffer);
+
+	// False for the other type, another version or a short message
+	static bool ReadArea(const uint8* Data, int32 Size, FVistarInterestArea& OutArea);
+	static bool ReadReport(const uint8* Data, int32 Size, FVistarInterestReport& OutReport);
+};
+
+/**
+ * Reference interest filter for the sending side of the traffic path
+ * Keeps the areas of all subscribed viewers and passes a state update when any of them wants it at
+ * full rate, otherwise at most at the highest OutsideRateHz among them. Creates, deletes and actions
+ * always pass so every viewer keeps the full entity set. With no live subscription everything passes.
+ * Single threaded.
+ */
+class VISTAR_API FVistarInterestFilter
+{
+public:
+	// A viewer that has not published for TimeoutSeconds is dropped
+	explicit FVistarInterestFilter(double InTimeoutSeconds = 5.0);
+
+	void Subscribe(const FVistarInterestArea& Area, double Now);
+
+	// Bytes is the encoded size, only used for the report
+	bool Accept(const FVistarEntityUpdate& Message, int32 Bytes, double Now);
+
+	int32 GetNumSubscribers() const { return Subscribers.Num(); }
+	const FVistarInterestReport& GetReport() const { return Report; }
+
+private:
+	void Expire(double Now);
+
+	struct FSubscriber
+	{
+		FVistarInterestArea Area;
+		double LastSeen = 0.0;
+	};
+	TArray<FSubscriber> Subscribers;
+
+	// Last known position per entity, updates may come without LOCATION
+	struct FEntityState
+	{
+		double Lat = 0.0;
+		double Lon = 0.0;
+		bool bHasLocation = false;
+		double LastOutsideSend = -1.0e9;
+	};
+	TMap<FVistarEntityId, FEntityState> Entities;
+
+	double TimeoutSeconds;
+	FVistarInterestReport Report;
+};
@@ -0,0 +1,562 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarJsonDecoder.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	// Powers of ten that are exact in a double
+	const double GExactPow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	FORCEINLINE bool IsDigit(ANSICHAR C) { return C >= '0' && C <= '9'; }
+
+	FORCEINLINE bool IsJsonSpace(ANSICHAR C) { return C == ' ' || C == '\t' || C == '\n' || C == '\r'; }
+
+	// Key comparison against a string literal
+	template <int32 N>
+	FORCEINLINE bool KeyIs(const ANSICHAR* Key, int32 KeyLength, const ANSICHAR(&Literal)[N])
+	{
+		return KeyLength == N - 1 && FMemory::Memcmp(Key, Literal, N - 1) == 0;
+	}
+
+	struct FJsonCursor
+	{
+		const ANSICHAR* P;
+		const ANSICHAR* End;
+
+		void SkipSpace()
+		{
+			while (P < End && IsJsonSpace(*P)) ++P;
+		}
+
+		bool Consume(ANSICHAR C)
+		{
+			SkipSpace();
+			if (P < End && *P == C)
+			{
+				++P;
+				return true;
+			}
+			return false;
+		}
+
+		bool Peek(ANSICHAR C)
+		{
+			SkipSpace();
+			return P < End && *P == C;
+		}
+
+		// Raw range between the quotes, escapes are flagged but not decoded
+		bool ReadString(const ANSICHAR*& OutBegin, int32& OutLength, bool& bOutEscaped)
+		{
+			if (!Consume('"'))
+			{
+				return false;
+			}
+			OutBegin = P;
+			bOutEscaped = false;
+			while (P < End && *P != '"')
+			{
+				if (*P == '\\')
+				{
+					bOutEscaped = true;
+					++P;
+				}
+				++P;
+			}
+			if (P >= End)
+			{
+				return false;
+			}
+			OutLength = static_cast<int32>(P - OutBegin);
+			++P;
+			return true;
+		}
+
+		// Either a quoted string or a bare number/literal
+		bool ReadScalar(const ANSICHAR*& OutBegin, int32& OutLength, bool& bOutEscaped)
+		{
+			if (Peek('"'))
+			{
+				return ReadString(OutBegin, OutLength, bOutEscaped);
+			}
+			OutBegin = P;
+			bOutEscaped = false;
+			while (P < End && *P != ',' && *P != '}' && *P != ']' && !IsJsonSpace(*P)) ++P;
+			OutLength = static_cast<int32>(P - OutBegin);
+			return OutLength > 0;
+		}
+
+		bool SkipValue()
+		{
+			const ANSICHAR* Begin;
+			int32 Length;
+			bool bEscaped;
+			if (!Peek('{') && !Peek('['))
+			{
+				return ReadScalar(Begin, Length, bEscaped);
+			}
+
+			int32 Depth = 0;
+			while (P < End)
+			{
+				const ANSICHAR C = *P;
+				if (C == '"')
+				{
+					if (!ReadString(Begin, Length, bEscaped))
+					{
+						return false;
+					}
+					continue;
+				}
+				++P;
+				if (C == '{' || C == '[')
+				{
+					++Depth;
+				}
+				else if ((C == '}' || C == ']') && --Depth == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool ReadDouble(double& OutValue)
+		{
+			const ANSICHAR* Begin;
+			int32 Length;
+			bool bEscaped;
+			if (!ReadScalar(Begin, Length, bEscaped))
+			{
+				return false;
+			}
+			// Same as Atof on junk, the field reads as zero
+			if (!FVistarJsonDecoder::ParseDouble(Begin, Begin + Length, OutValue))
+			{
+				OutValue = 0.0;
+			}
+			return true;
+		}
+	};
+
+	struct FNumberField
+	{
+		const ANSICHAR* Key;
+		int32 KeyLength;
+		double* Target;
+	};
+
+	// { "X": "1.0", "Y": 2.0, ... } with every value read as a double
+	bool ReadNumberObject(FJsonCursor& Cursor, const FNumberField* Fields, int32 NumFields, bool& bOutNeedsDom)
+	{
+		if (!Cursor.Consume('{'))
+		{
+			return false;
+		}
+		if (Cursor.Consume('}'))
+		{
+			return true;
+		}
+
+		do
+		{
+			const ANSICHAR* Key;
+			int32 KeyLength;
+			bool bEscaped;
+			if (!Cursor.ReadString(Key, KeyLength, bEscaped) || !Cursor.Consume(':'))
+			{
+				return false;
+			}
+
+			const FNumberField* Match = nullptr;
+			for (int32 i = 0; i < NumFields; ++i)
+			{
+				if (Fields[i].KeyLength == KeyLength && FMemory::Memcmp(Fields[i].Key, Key, KeyLength) == 0)
+				{
+					Match = &Fields[i];
+					break;
+				}
+			}
+
+			if (Match)
+			{
+				if (!Cursor.ReadDouble(*Match->Target))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				bOutNeedsDom = true;
+				if (!Cursor.SkipValue())
+				{
+					return false;
+				}
+			}
+		} while (Cursor.Consume(','));
+
+		return Cursor.Consume('}');
+	}
+
+	EVistarStream StreamFromName(const ANSICHAR* Name, int32 Length)
+	{
+		if (KeyIs(Name, Length, "create"))	return EVistarStream::Create;
+		if (KeyIs(Name, Length, "update"))	return EVistarStream::Update;
+		if (KeyIs(Name, Length, "delete"))	return EVistarStream::Delete;
+		return EVistarStream::Action;
+	}
+
+	// Raw bytes of the first string value under Name, found without parsing the message
+	bool PeekString(const uint8* Data, int32 Size, const ANSICHAR* Name, int32 NameLength, const ANSICHAR*& OutValue, int32& OutLength)
+	{
+		const ANSICHAR* Cur = reinterpret_cast<const ANSICHAR*>(Data);
+		const ANSICHAR* const End = Cur + Size;
+
+		auto SkipSpace = [End](const ANSICHAR* P)
+		{
+			while (P < End && IsJsonSpace(*P))
+			{
+				++P;
+			}
+			return P;
+		};
+
+		// Looking for the key followed by ':' so a value that happens to read the same is not taken for it
+		while (End - Cur >= NameLength + 2)
+		{
+			const ANSICHAR* Key = Cur;
+			while (Key < End && *Key != '"')
+			{
+				++Key;
+			}
+			if (End - Key < NameLength + 2)
+			{
+				return false;
+			}
+			Cur = Key + 1;
+			if (Key[NameLength + 1] != '"' || FMemory::Memcmp(Key + 1, Name, NameLength) != 0)
+			{
+				continue;
+			}
+
+			const ANSICHAR* P = SkipSpace(Key + NameLength + 2);
+			if (P >= End || *P != ':')
+			{
+				continue;
+			}
+			P = SkipSpace(P + 1);
+			if (P >= End || *P != '"')
+			{
+				return false;
+			}
+
+			const ANSICHAR* Begin = P + 1;
+			const ANSICHAR* Close = Begin;
+			while (Close < End && *Close != '"')
+			{
+				Close += (*Close == '\\' && Close + 1 < End) ? 2 : 1;
+			}
+			if (Close >= End || Close == Begin)
+			{
+				return false;
+			}
+			OutValue = Begin;
+			OutLength = static_cast<int32>(Close - Begin);
+			return true;
+		}
+		return false;
+	}
+}
+
+bool FVistarJsonDecoder::ParseDouble(const ANSICHAR* Begin, const ANSICHAR* End, double& OutValue)
+{
+	const ANSICHAR* P = Begin;
+	while (P < End && IsJsonSpace(*P)) ++P;
+
+	bool bNegative = false;
+	if (P < End && (*P == '-' || *P == '+'))
+	{
+		bNegative = *P == '-';
+		++P;
+	}
+
+	// Up to 19 significant digits fit in a uint64
+	uint64 Mantissa = 0;
+	int32 SignificantDigits = 0;
+	int32 Exponent = 0;
+	bool bAnyDigit = false;
+	bool bTruncated = false;
+
+	for (; P < End && IsDigit(*P); ++P)
+	{
+		const int32 Digit = *P - '0';
+		bAnyDigit = true;
+		if (SignificantDigits < 19)
+		{
+			Mantissa = Mantissa * 10 + Digit;
+			SignificantDigits += Mantissa != 0 ? 1 : 0;
+		}
+		else
+		{
+			++Exponent;
+			bTruncated |= Digit != 0;
+		}
+	}
+
+	if (P < End && *P == '.')
+	{
+		for (++P; P < End && IsDigit(*P); ++P)
+		{
+			const int32 Digit = *P - '0';
+			bAnyDigit = true;
+			if (SignificantDigits < 19)
+			{
+				Mantissa = Mantissa * 10 + Digit;
+				SignificantDigits += Mantissa != 0 ? 1 : 0;
+				--Exponent;
+			}
+			else
+			{
+				bTruncated |= Digit != 0;
+			}
+		}
+	}
+
+	if (!bAnyDigit)
+	{
+		return false;
+	}
+
+	if (P < End && (*P == 'e' || *P == 'E'))
+	{
+		++P;
+		bool bExponentNegative = false;
+		if (P < End && (*P == '-' || *P == '+'))
+		{
+			bExponentNegative = *P == '-';
+			++P;
+		}
+		int32 ExponentValue = 0;
+		bool bAnyExponentDigit = false;
+		for (; P < End && IsDigit(*P); ++P)
+		{
+			bAnyExponentDigit = true;
+			if (ExponentValue < 100000)
+			{
+				ExponentValue = ExponentValue * 10 + (*P - '0');
+			}
+		}
+		if (!bAnyExponentDigit)
+		{
+			return false;
+		}
+		Exponent += bExponentNegative ? -ExponentValue : ExponentValue;
+	}
+
+	while (P < End && IsJsonSpace(*P)) ++P;
+	if (P != End)
+	{
+		return false;
+	}
+
+	// Mantissa and power of ten are both exact, so one IEEE operation gives the correctly rounded result
+	if (!bTruncated && Mantissa <= (1ull << 53) && Exponent >= -22 && Exponent <= 22)
+	{
+		double Value = static_cast<double>(Mantissa);
+		Value = Exponent < 0 ? Value / GExactPow10[-Exponent] : Value * GExactPow10[Exponent];
+		OutValue = bNegative ? -Value : Value;
+		return true;
+	}
+
+	// Long mantissas and large exponents go through the C runtime, still at full precision
+	ANSICHAR Buffer[64];
+	const int32 Length = static_cast<int32>(End - Begin);
+	if (Length >= UE_ARRAY_COUNT(Buffer))
+	{
+		return false;
+	}
+	FMemory::Memcpy(Buffer, Begin, Length);
+	Buffer[Length] = '\0';
+	OutValue = FCStringAnsi::Atod(Buffer);
+	return true;
+}
+
+bool FVistarJsonDecoder::DecodeTyped(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage, bool& bOutNeedsDom)
+{
+	FJsonCursor Cursor{ reinterpret_cast<const ANSICHAR*>(Data), reinterpret_cast<const ANSICHAR*>(Data) + Size };
+	bOutNeedsDom = false;
+
+	if (!Cursor.Consume('{') || Cursor.Consume('}'))
+	{
+		return false;
+	}
+
+	bool bHasStream = false;
+	do
+	{
+		const ANSICHAR* Key;
+		int32 KeyLength;
+		bool bEscaped;
+		if (!Cursor.ReadString(Key, KeyLength, bEscaped) || !Cursor.Consume(':'))
+		{
+			return false;
+		}
+
+		const ANSICHAR* Value;
+		int32 ValueLength;
+
+		if (KeyIs(Key, KeyLength, "STREAM") || KeyIs(Key, KeyLength, "ID") || KeyIs(Key, KeyLength, "CLASS")
+			|| KeyIs(Key, KeyLength, "PARENT") || KeyIs(Key, KeyLength, "ACTION") || KeyIs(Key, KeyLength, "TRAJECTORY"))
+		{
+			if (!Cursor.ReadScalar(Value, ValueLength, bEscaped))
+			{
+				return false;
+			}
+			// Escaped strings are rare enough to leave to the DOM
+			bOutNeedsDom |= bEscaped;
+
+			switch (Key[0])
+			{
+			case 'S':
+				OutMessage.Stream = StreamFromName(Value, ValueLength);
+				bHasStream = true;
+				break;
+			case 'I':
+				// A truncated ID would merge with every other ID of the same prefix
+				if (!OutMessage.Id.Set(Value, ValueLength))
+				{
+					return false;
+				}
+				break;
+			case 'C':
+				OutMessage.Class = VistarClassFromName(Value, ValueLength);
+				break;
+			case 'P':
+				if (!OutMessage.ParentId.Set(Value, ValueLength))
+				{
+					return false;
+				}
+				break;
+			case 'T':
+				OutMessage.Trajectory.Set(Value, ValueLength);
+				break;
+			default:
+				OutMessage.Action.Set(Value, ValueLength);
+				break;
+			}
+		}
+		else if (KeyIs(Key, KeyLength, "CHILD_ID"))
+		{
+			double ChildId = 0.0;
+			// Converting NaN, inf or anything past int32 is undefined, such a message is malformed
+			if (!Cursor.ReadDouble(ChildId) || !FMath::IsFinite(ChildId) || ChildId < MIN_int32 || ChildId > MAX_int32)
+			{
+				return false;
+			}
+			OutMessage.ChildId = static_cast<int32>(ChildId);
+		}
+		else if (KeyIs(Key, KeyLength, "LOCATION"))
+		{
+			const FNumberField Fields[] = { { "X", 1, &OutMessage.Lon }, { "Y", 1, &OutMessage.Lat }, { "Z", 1, &OutMessage.Alt } };
+			if (!ReadNumberObject(Cursor, Fields, UE_ARRAY_COUNT(Fields), bOutNeedsDom))
+			{
+				return false;
+			}
+			OutMessage.bHasLocation = true;
+		}
+		else if (KeyIs(Key, KeyLength, "ROTATION"))
+		{
+			const FNumberField Fields[] = { { "YAW", 3, &OutMessage.Yaw }, { "PITCH", 5, &OutMessage.Pitch }, { "ROLL", 4, &OutMessage.Roll } };
+			if (!ReadNumberObject(Cursor, Fields, UE_ARRAY_COUNT(Fields), bOutNeedsDom))
+			{
+				return false;
+			}
+			OutMessage.bHasRotation = true;
+		}
+		else if (KeyIs(Key, KeyLength, "SLEW"))
+		{
+			const FNumberField Fields[] = { { "SLEW_AZ", 7, &OutMessage.SlewAz }, { "SLEW_ELEV", 9, &OutMessage.SlewElev } };
+			if (!ReadNumberObject(Cursor, Fields, UE_ARRAY_COUNT(Fields), bOutNeedsDom))
+			{
+				return false;
+			}
+			OutMessage.bHasSlew = true;
+		}
+		else
+		{
+			bOutNeedsDom = true;
+			if (!Cursor.SkipValue())
+			{
+				return false;
+			}
+		}
+	} while (Cursor.Consume(','));
+
+	if (!Cursor.Consume('}'))
+	{
+		bOutNeedsDom = false;
+		return false;
+	}
+	if (!bHasStream || OutMessage.Id.IsEmpty())
+	{
+		// The DOM path would reject it as well
+		bOutNeedsDom = false;
+		return false;
+	}
+	return !bOutNeedsDom;
+}
+
+bool FVistarJsonDecoder::PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength)
+{
+	return PeekString(Data, Size, "ID", 2, OutId, OutLength);
+}
+
+bool FVistarJsonDecoder::PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream)
+{
+	const ANSICHAR* Value = nullptr;
+	int32 Length = 0;
+	if (!PeekString(Data, Size, "STREAM", 6, Value, Length))
+	{
+		return false;
+	}
+	OutStream = StreamFromName(Value, Length);
+	return true;
+}
+
+EVistarDecodeResult FVistarJsonDecoder::Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage)
+{
+	bool bNeedsDom = false;
+	if (DecodeTyped(Data, Size, OutMessage, bNeedsDom))
+	{
+		return EVistarDecodeResult::Ok;
+	}
+	if (!bNeedsDom)
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Data), Size);
+	FString ReceivedString(Converter.Length(), Converter.Get());
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<TCHAR>> Reader = TJsonReaderFactory<TCHAR>::Create(ReceivedString);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+
+	OutMessage = FVistarEntityUpdate();
+	if (!FVistarEntityUpdate::FromJson(JsonObject, OutMessage))
+	{
+		return EVistarDecodeResult::Malformed;
+	}
+	OutMessage.ExtraJson = JsonObject;
+	return EVistarDecodeResult::DomFallback;
+}
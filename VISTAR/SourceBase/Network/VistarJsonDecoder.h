@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+enum class EVistarDecodeResult : uint8
+{
+	// Typed fields were read straight from the buffer
+	Ok,
+	// The message had fields the typed decoder does not know, it went through the DOM and ExtraJson is set
+	DomFallback,
+	// Well formed but nothing to apply (control messages, ...)
+	Ignored,
+	Malformed,
+};
+
+/**
+ * SAX-style decoder for the VISTAR JSON schema
+ * Walks the raw UTF-8 datagram once and writes the known fields straight into FVistarEntityUpdate,
+ * mapping STREAM/CLASS to enums on the way. No FString, no FJsonObject, no allocation.
+ * Only messages with unknown fields (route POINTS, ...) or escaped strings pay for the DOM.
+ */
+class VISTAR_API FVistarJsonDecoder
+{
+public:
+	static EVistarDecodeResult Decode(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage);
+
+	// Typed pass only. Returns false if the message is malformed or, with bOutNeedsDom set, needs the DOM
+	static bool DecodeTyped(const uint8* Data, int32 Size, FVistarEntityUpdate& OutMessage, bool& bOutNeedsDom);
+
+	// Raw bytes of the top-level "ID" value without decoding the message. Escapes are not resolved,
+	// the result is only meant for routing (the same entity always yields the same bytes)
+	static bool PeekId(const uint8* Data, int32 Size, const ANSICHAR*& OutId, int32& OutLength);
+
+	// Top-level "STREAM" value the same way, used to pick the ingest lane before decoding
+	static bool PeekStream(const uint8* Data, int32 Size, EVistarStream& OutStream);
+
+	// Decimal text to double at full precision, exact fast path when the mantissa fits in 53 bits
+	static bool ParseDouble(const ANSICHAR* Begin, const ANSICHAR* End, double& OutValue);
+};
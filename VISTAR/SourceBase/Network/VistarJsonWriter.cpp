@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarJsonWriter.h"
+
+namespace
+{
+	// Outbound STREAM values keep the capitalisation the simulator has always been sent
+	const ANSICHAR* StreamName(EVistarStream Stream)
+	{
+		switch (Stream)
+		{
+		case EVistarStream::Create:	return "Create";
+		case EVistarStream::Update:	return "Update";
+		case EVistarStream::Delete:	return "Delete";
+		default:					return "Action";
+		}
+	}
+}
+
+FVistarJsonWriter::FVistarJsonWriter(TArray<uint8>& InBuffer)
+	: Buffer(InBuffer), bNeedsComma(false)
+{
+}
+
+void FVistarJsonWriter::WriteRaw(const ANSICHAR* Text, int32 Length)
+{
+	Buffer.Append(reinterpret_cast<const uint8*>(Text), Length);
+}
+
+void FVistarJsonWriter::WriteEscaped(const ANSICHAR* Text, int32 Length)
+{
+	Buffer.Add('"');
+	for (int32 i = 0; i < Length; ++i)
+	{
+		const ANSICHAR C = Text[i];
+		if (C == '"' || C == '\\')
+		{
+			Buffer.Add('\\');
+			Buffer.Add(static_cast<uint8>(C));
+		}
+		else if (static_cast<uint8>(C) < 0x20)
+		{
+			ANSICHAR Escape[8];
+			const int32 Written = FCStringAnsi::Snprintf(Escape, sizeof(Escape), "\\u%04x", static_cast<uint8>(C));
+			WriteRaw(Escape, Written);
+		}
+		else
+		{
+			// UTF-8 multi-byte sequences pass through untouched
+			Buffer.Add(static_cast<uint8>(C));
+		}
+	}
+	Buffer.Add('"');
+}
+
+void FVistarJsonWriter::Separator()
+{
+	if (bNeedsComma)
+	{
+		Buffer.Add(',');
+	}
+	bNeedsComma = true;
+}
+
+void FVistarJsonWriter::WriteKey(const ANSICHAR* Key)
+{
+	Separator();
+	if (Key)
+	{
+		WriteEscaped(Key, FCStringAnsi::Strlen(Key));
+		Buffer.Add(':');
+	}
+}
+
+void FVistarJsonWriter::BeginObject(const ANSICHAR* Key)
+{
+	WriteKey(Key);
+	Buffer.Add('{');
+	bNeedsComma = false;
+}
+
+void FVistarJsonWriter::EndObject()
+{
+	Buffer.Add('}');
+	bNeedsComma = true;
+}
+
+void FVistarJsonWriter::BeginArray(const ANSICHAR* Key)
+{
+	WriteKey(Key);
+	Buffer.Add('[');
+	bNeedsComma = false;
+}
+
+void FVistarJsonWriter::EndArray()
+{
+	Buffer.Add(']');
+	bNeedsComma = true;
+}
+
+void FVistarJsonWriter::WriteString(const ANSICHAR* Key, const ANSICHAR* Value, int32 Length)
+{
+	WriteKey(Key);
+	WriteEscaped(Value, Length);
+}
+
+void FVistarJsonWriter::WriteString(const ANSICHAR* Key, const FString& Value)
+{
+	FTCHARToUTF8 Utf8(*Value);
+	WriteString(Key, Utf8.Get(), Utf8.Length());
+}
+
+void FVistarJsonWriter::WriteNumber(const ANSICHAR* Key, double Value)
+{
+	WriteKey(Key);
+
+	// JSON has no NaN or infinity
+	if (!FMath::IsFinite(Value))
+	{
+		Buffer.Add('0');
+		return;
+	}
+
+	// Shortest of %.15g / %.17g that reads back to the same double
+	ANSICHAR Text[32];
+	int32 Length = FCStringAnsi::Snprintf(Text, sizeof(Text), "%.15g", Value);
+	if (FCStringAnsi::Atod(Text) != Value)
+	{
+		Length = FCStringAnsi::Snprintf(Text, sizeof(Text), "%.17g", Value);
+	}
+	WriteRaw(Text, Length);
+}
+
+void FVistarJsonWriter::WriteNumber(const ANSICHAR* Key, int32 Value)
+{
+	WriteKey(Key);
+	ANSICHAR Text[16];
+	const int32 Length = FCStringAnsi::Snprintf(Text, sizeof(Text), "%d", Value);
+	WriteRaw(Text, Length);
+}
+
+void FVistarJsonWriter::WriteEntity(const FVistarEntityUpdate& Message, TArray<uint8>& OutBuffer, const FString* ClassName)
+{
+	FVistarJsonWriter Writer(OutBuffer);
+	Writer.BeginObject();
+
+	Writer.WriteString("ID", Message.Id);
+	if (ClassName)
+	{
+		Writer.WriteString("CLASS", *ClassName);
+	}
+	else
+	{
+		const ANSICHAR* Name = VistarClassToName(Message.Class);
+		Writer.WriteString("CLASS", Name, FCStringAnsi::Strlen(Name));
+	}
+	const ANSICHAR* Stream = StreamName(Message.Stream);
+	Writer.WriteString("STREAM", Stream, FCStringAnsi::Strlen(Stream));
+
+	if (!Message.ParentId.IsEmpty())
+	{
+		Writer.WriteString("PARENT", Message.ParentId);
+		Writer.WriteNumber("CHILD_ID", Message.ChildId);
+	}
+	if (!Message.Action.IsEmpty())
+	{
+		Writer.WriteString("ACTION", Message.Action);
+	}
+	if (!Message.Trajectory.IsEmpty())
+	{
+		Writer.WriteString("TRAJECTORY", Message.Trajectory);
+	}
+
+	if (Message.bHasLocation)
+	{
+		Writer.BeginObject("LOCATION");
+		Writer.WriteNumber("X", Message.Lon);
+		Writer.WriteNumber("Y", Message.Lat);
+		Writer.WriteNumber("Z", Message.Alt);
+		Writer.EndObject();
+	}
+	if (Message.bHasRotation)
+	{
+		Writer.BeginObject("ROTATION");
+		Writer.WriteNumber("YAW", Message.Yaw);
+		Writer.WriteNumber("PITCH", Message.Pitch);
+		Writer.WriteNumber("ROLL", Message.Roll);
+		Writer.EndObject();
+	}
+	if (Message.bHasSlew)
+	{
+		Writer.BeginObject("SLEW");
+		Writer.WriteNumber("SLEW_AZ", Message.SlewAz);
+		Writer.WriteNumber("SLEW_ELEV", Message.SlewElev);
+		Writer.EndObject();
+	}
+
+	if (Message.Points.Num() > 0)
+	{
+		Writer.BeginArray("POINTS");
+		for (const FVector3d& Point : Message.Points)
+		{
+			Writer.BeginObject();
+			Writer.WriteNumber("X", Point.X);
+			Writer.WriteNumber("Y", Point.Y);
+			Writer.WriteNumber("Z", Point.Z);
+			Writer.EndObject();
+		}
+		Writer.EndArray();
+	}
+
+	Writer.EndObject();
+}
+
+void FVistarJsonWriter::WriteControl(EVistarControl Control, TArray<uint8>& OutBuffer)
+{
+	FVistarJsonWriter Writer(OutBuffer);
+	Writer.BeginObject();
+	Writer.WriteString("STREAM", "Event", 5);
+	if (Control == EVistarControl::Start)
+	{
+		Writer.WriteString("TYPE", "Start", 5);
+	}
+	else
+	{
+		Writer.WriteString("TYPE", "Stop", 4);
+	}
+	Writer.EndObject();
+}
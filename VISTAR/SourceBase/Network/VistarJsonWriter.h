@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarBinaryCodec.h"
+
+/**
+ * Compact JSON writer emitting UTF-8 straight into a byte buffer
+ * Replaces FJsonObject + TJsonWriter + FTCHARToUTF8 on the send path: no DOM, no TCHAR string,
+ * no second conversion pass. Commas are inserted automatically, keys must be ASCII literals.
+ */
+class VISTAR_API FVistarJsonWriter
+{
+public:
+	explicit FVistarJsonWriter(TArray<uint8>& InBuffer);
+
+	void BeginObject(const ANSICHAR* Key = nullptr);
+	void EndObject();
+	void BeginArray(const ANSICHAR* Key = nullptr);
+	void EndArray();
+
+	void WriteString(const ANSICHAR* Key, const ANSICHAR* Value, int32 Length);
+	void WriteString(const ANSICHAR* Key, const FVistarInlineString& Value) { WriteString(Key, Value.GetData(), Value.Len()); }
+	void WriteString(const ANSICHAR* Key, const FString& Value);
+	void WriteNumber(const ANSICHAR* Key, double Value);
+	void WriteNumber(const ANSICHAR* Key, int32 Value);
+
+	// Entity message in the schema of README_Network.md. ClassName overrides the CLASS text, for
+	// actor classes outside EVistarClassType
+	static void WriteEntity(const FVistarEntityUpdate& Message, TArray<uint8>& OutBuffer, const FString* ClassName = nullptr);
+
+	// {"STREAM":"Event","TYPE":"Start"} and friends
+	static void WriteControl(EVistarControl Control, TArray<uint8>& OutBuffer);
+
+private:
+	void Separator();
+	void WriteKey(const ANSICHAR* Key);
+	void WriteRaw(const ANSICHAR* Text, int32 Length);
+	void WriteEscaped(const ANSICHAR* Text, int32 Length);
+
+	TArray<uint8>& Buffer;
+	// Whether the current container already holds a value, needs a comma before the next
+	bool bNeedsComma;
+};
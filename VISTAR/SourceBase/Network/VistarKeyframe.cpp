@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarKeyframe.h"
+#include "Misc/Compression.h"
+
+void FVistarKeyframe::Encode(uint32 KeyframeId, const uint8* Body, int32 BodySize, TArray<uint8>& OutBuffer)
+{
+	const int32 Start = OutBuffer.Num();
+	OutBuffer.AddZeroed(HeaderSize);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, BodySize);
+	OutBuffer.AddUninitialized(CompressedSize);
+	uint8 Flags = Flag_Compressed;
+	if (FCompression::CompressMemory(NAME_Zlib, OutBuffer.GetData() + Start + HeaderSize, CompressedSize, Body, BodySize)
+		&& CompressedSize < BodySize)
+	{
+		OutBuffer.SetNum(Start + HeaderSize + CompressedSize, EAllowShrinking::No);
+	}
+	else
+	{
+		Flags = 0;
+		OutBuffer.SetNum(Start + HeaderSize, EAllowShrinking::No);
+		OutBuffer.Append(Body, BodySize);
+	}
+
+	uint8* Header = OutBuffer.GetData() + Start;
+	Header[0] = Magic;
+	Header[1] = Version;
+	Header[2] = Flags;
+	const uint32 RawSize = static_cast<uint32>(BodySize);
+	FMemory::Memcpy(Header + 4, &KeyframeId, sizeof(KeyframeId));
+	FMemory::Memcpy(Header + 8, &RawSize, sizeof(RawSize));
+}
+
+bool FVistarKeyframe::Decode(const uint8* Data, int32 Size, int32 MaxBodySize, uint32& OutKeyframeId, TArray<uint8>& OutBody)
+{
+	if (!IsKeyframe(Data, Size) || Data[1] != Version)
+	{
+		return false;
+	}
+	uint32 RawSize = 0;
+	FMemory::Memcpy(&OutKeyframeId, Data + 4, sizeof(OutKeyframeId));
+	FMemory::Memcpy(&RawSize, Data + 8, sizeof(RawSize));
+	if (RawSize == 0 || RawSize > static_cast<uint32>(MaxBodySize))
+	{
+		return false;
+	}
+
+	const uint8* Payload = Data + HeaderSize;
+	const int32 PayloadSize = Size - HeaderSize;
+	OutBody.SetNumUninitialized(static_cast<int32>(RawSize), EAllowShrinking::No);
+	if (!(Data[2] & Flag_Compressed))
+	{
+		if (PayloadSize != static_cast<int32>(RawSize))
+		{
+			return false;
+		}
+		FMemory::Memcpy(OutBody.GetData(), Payload, RawSize);
+		return true;
+	}
+	return FCompression::UncompressMemory(NAME_Zlib, OutBody.GetData(), static_cast<int32>(RawSize), Payload, PayloadSize);
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Keyframe, the full state of every entity a sender knows, repeated so a late or lossy viewer can
+ * rebuild the scene without waiting for each entity's next message
+ *   u8 Magic (0xBB), u8 Version, u8 Flags, u8 Reserved, u32 Keyframe ID, u32 Body size, body
+ * The body is one message the receiver already understands, a bundle of binary or JSON creates or a
+ * relay frame, zlib compressed when Flag_Compressed is set. Keyframes are large and travel as fragments.
+ * The regular stream carries the changes in between.
+ */
+class VISTAR_API FVistarKeyframe
+{
+public:
+	static constexpr uint8 Magic = 0xBB;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 12;
+
+	enum EFlags : uint8
+	{
+		Flag_Compressed = 1 << 0,
+	};
+
+	static bool IsKeyframe(const uint8* Data, int32 Size) { return Size >= HeaderSize && Data[0] == Magic; }
+
+	// Appends the keyframe to OutBuffer, compressed unless that does not make it smaller
+	static void Encode(uint32 KeyframeId, const uint8* Body, int32 BodySize, TArray<uint8>& OutBuffer);
+
+	// Body of the keyframe into OutBody, false if malformed or the body is over MaxBodySize
+	static bool Decode(const uint8* Data, int32 Size, int32 MaxBodySize, uint32& OutKeyframeId, TArray<uint8>& OutBody);
+};
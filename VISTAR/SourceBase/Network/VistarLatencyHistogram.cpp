@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarLatencyHistogram.h"
+
+namespace
+{
+	constexpr double BucketLimits[FVistarLatencyHistogram::NumBuckets - 1] =
+	{
+		0.25, 0.5, 1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0
+	};
+}
+
+void FVistarLatencyHistogram::Add(double Ms)
+{
+	// A sample just under the clock offset estimate comes out slightly negative
+	Ms = FMath::Max(Ms, 0.0);
+
+	int32 Index = 0;
+	while (Index < NumBuckets - 1 && Ms > BucketLimits[Index])
+	{
+		++Index;
+	}
+	++Buckets[Index];
+	++Count;
+	Sum += Ms;
+	Max = FMath::Max(Max, Ms);
+}
+
+void FVistarLatencyHistogram::Reset()
+{
+	*this = FVistarLatencyHistogram();
+}
+
+double FVistarLatencyHistogram::GetBucketLimit(int32 Index)
+{
+	return Index < NumBuckets - 1 ? BucketLimits[Index] : TNumericLimits<double>::Max();
+}
+
+double FVistarLatencyHistogram::GetPercentile(double Fraction) const
+{
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	const uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Fraction * Count)));
+	uint64 Seen = 0;
+	for (int32 Index = 0; Index < NumBuckets - 1; ++Index)
+	{
+		Seen += Buckets[Index];
+		if (Seen >= Target)
+		{
+			return FMath::Min(BucketLimits[Index], Max);
+		}
+	}
+	return Max;
+}
+
+FString FVistarLatencyHistogram::ToString() const
+{
+	return FString::Printf(TEXT("n=%llu mean=%.2f p50<=%.2f p95<=%.2f p99<=%.2f max=%.2f"),
+		Count, GetMean(), GetPercentile(0.5), GetPercentile(0.95), GetPercentile(0.99), Max);
+}
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Fixed-bucket latency histogram in milliseconds
+ * Buckets run from 0.25 ms to 1 s in 1-2-5 steps with an overflow bucket, fine enough for
+ * percentiles of frame-scale latencies without storing samples. Single threaded.
+ */
+class VISTAR_API FVistarLatencyHistogram
+{
+public:
+	static constexpr int32 NumBuckets = 14;
+
+	void Add(double Ms);
+
+	void Reset();
+
+	uint64 GetCount() const { return Count; }
+	double GetMean() const { return Count > 0 ? Sum / Count : 0.0; }
+	double GetMax() const { return Max; }
+
+	// Upper edge of the bucket holding the given fraction (0..1) of samples, Max for the overflow bucket
+	double GetPercentile(double Fraction) const;
+
+	// Upper edge of bucket Index in ms, infinite for the last bucket
+	static double GetBucketLimit(int32 Index);
+	uint64 GetBucketCount(int32 Index) const { return Buckets[Index]; }
+
+	// "n=1200 mean=3.1 p50<=5 p95<=10 p99<=20 max=17.4" in ms
+	FString ToString() const;
+
+private:
+	uint64 Buckets[NumBuckets] = { 0 };
+	uint64 Count = 0;
+	double Sum = 0.0;
+	double Max = 0.0;
+};
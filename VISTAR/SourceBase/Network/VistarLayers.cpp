@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarLayers.h"
+
+namespace
+{
+	// Launcher -> missile is as deep as attachments go, the bound only guards against a cycle
+	constexpr int32 MaxHierarchyDepth = 8;
+}
+
+FVistarLayers::FVistarLayers()
+	: HiddenClassMask(0)
+	, AbsorbedCount(0)
+{
+}
+
+void FVistarLayers::SetClassVisible(EVistarClassType Class, bool bVisible)
+{
+	if (bVisible)
+	{
+		HiddenClassMask &= ~ClassBit(Class);
+	}
+	else
+	{
+		HiddenClassMask |= ClassBit(Class);
+	}
+}
+
+void FVistarLayers::SetHierarchyVisible(const FVistarEntityId& RootId, bool bVisible)
+{
+	if (bVisible)
+	{
+		HiddenRoots.Remove(RootId);
+	}
+	else
+	{
+		HiddenRoots.Add(RootId);
+	}
+}
+
+void FVistarLayers::NoteEntity(const FVistarEntityId& Id, EVistarClassType Class, const FVistarEntityId& ParentId)
+{
+	FEntityInfo& Info = Entities.FindOrAdd(Id);
+	if (Class != EVistarClassType::VISTAR_TYPE_NONE)
+	{
+		Info.Class = Class;
+	}
+	if (!ParentId.IsEmpty())
+	{
+		Info.ParentId = ParentId;
+	}
+}
+
+void FVistarLayers::ForgetEntity(const FVistarEntityId& Id)
+{
+	Entities.Remove(Id);
+	Stored.Remove(Id);
+}
+
+bool FVistarLayers::IsHidden(const FVistarEntityId& Id) const
+{
+	const FVistarEntityId* Current = &Id;
+	for (int32 Depth = 0; Depth < MaxHierarchyDepth; ++Depth)
+	{
+		if (HiddenRoots.Contains(*Current))
+		{
+			return true;
+		}
+		const FEntityInfo* Info = Entities.Find(*Current);
+		if (!Info)
+		{
+			return false;
+		}
+		if (!IsClassVisible(Info->Class))
+		{
+			return true;
+		}
+		if (Info->ParentId.IsEmpty())
+		{
+			return false;
+		}
+		Current = &Info->ParentId;
+	}
+	return false;
+}
+
+bool FVistarLayers::Absorb(const FVistarEntityUpdate& Message)
+{
+	if (Message.Stream == EVistarStream::Delete)
+	{
+		Stored.Remove(Message.Id);
+		return false;
+	}
+
+	// An entity first seen through an update is only known by the class it carries
+	if (!Entities.Contains(Message.Id))
+	{
+		NoteEntity(Message.Id, Message.Class, Message.ParentId);
+	}
+	if (!IsHidden(Message.Id))
+	{
+		return false;
+	}
+
+	++AbsorbedCount;
+	if (Message.Stream != EVistarStream::Create && Message.Stream != EVistarStream::Update)
+	{
+		// Actions are effects on the actor, there is nothing to replay once it is visible again
+		return true;
+	}
+
+	FVistarEntityUpdate* Existing = Stored.Find(Message.Id);
+	if (!Existing)
+	{
+		Stored.Add(Message.Id, Message);
+		return true;
+	}
+
+	// A create wins over updates, it carries the attachment
+	if (Message.Stream == EVistarStream::Create)
+	{
+		Existing->Stream = EVistarStream::Create;
+		Existing->ParentId = Message.ParentId;
+		Existing->ChildId = Message.ChildId;
+	}
+	if (Message.Class != EVistarClassType::VISTAR_TYPE_NONE)
+	{
+		Existing->Class = Message.Class;
+	}
+	Existing->Meta = Message.Meta;
+	Existing->MergeState(Message);
+	return true;
+}
+
+void FVistarLayers::TakeRevealed(TArray<FVistarEntityUpdate>& OutMessages)
+{
+	TArray<TPair<int32, FVistarEntityUpdate>> Revealed;
+	for (auto It = Stored.CreateIterator(); It; ++It)
+	{
+		if (IsHidden(It.Key()))
+		{
+			continue;
+		}
+
+		// Depth in the hierarchy, so parents are applied before their children attach to them
+		int32 Depth = 0;
+		for (const FEntityInfo* Info = Entities.Find(It.Key()); Info && !Info->ParentId.IsEmpty() && Depth < MaxHierarchyDepth;
+			Info = Entities.Find(Info->ParentId))
+		{
+			++Depth;
+		}
+		Revealed.Emplace(Depth, MoveTemp(It.Value()));
+		It.RemoveCurrent();
+	}
+
+	Revealed.StableSort([](const TPair<int32, FVistarEntityUpdate>& A, const TPair<int32, FVistarEntityUpdate>& B) { return A.Key < B.Key; });
+	OutMessages.Reserve(OutMessages.Num() + Revealed.Num());
+	for (TPair<int32, FVistarEntityUpdate>& Entry : Revealed)
+	{
+		OutMessages.Add(MoveTemp(Entry.Value));
+	}
+}
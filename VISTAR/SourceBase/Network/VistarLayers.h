@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * Runtime visibility layers of the ingest path, one per CLASS and one per parent hierarchy
+ * Messages for hidden entities are absorbed into a latest-state store instead of being applied, so a
+ * hidden layer costs a map lookup per update and no coordinate conversion or actor work. Showing the
+ * layer again hands back the stored state of its entities in one batch, parents first.
+ * A child is hidden with its parent, whether the parent is hidden by class or by hierarchy.
+ * Game thread only.
+ */
+class VISTAR_API FVistarLayers
+{
+public:
+	FVistarLayers();
+
+	void SetClassVisible(EVistarClassType Class, bool bVisible);
+	bool IsClassVisible(EVistarClassType Class) const { return (HiddenClassMask & ClassBit(Class)) == 0; }
+
+	// Hides or shows an entity together with everything attached below it
+	void SetHierarchyVisible(const FVistarEntityId& RootId, bool bVisible);
+	bool IsHierarchyVisible(const FVistarEntityId& RootId) const { return !HiddenRoots.Contains(RootId); }
+
+	// Cheap check for the common case, nothing to do while everything is visible
+	bool AnyHidden() const { return HiddenClassMask != 0 || HiddenRoots.Num() > 0; }
+
+	// Class and parent of every entity, recorded for all entities so a layer can be hidden later
+	void NoteEntity(const FVistarEntityId& Id, EVistarClassType Class, const FVistarEntityId& ParentId);
+	void ForgetEntity(const FVistarEntityId& Id);
+
+	bool IsHidden(const FVistarEntityId& Id) const;
+
+	// Stores the message when its entity is hidden and returns true, the caller then skips it.
+	// A delete is stored nowhere but still returns false, an existing actor has to go
+	bool Absorb(const FVistarEntityUpdate& Message);
+
+	// Moves the stored state of entities visible again into OutMessages, parents ahead of children.
+	// Entities first seen while hidden come back as creates, the rest as updates
+	void TakeRevealed(TArray<FVistarEntityUpdate>& OutMessages);
+
+	int32 NumStored() const { return Stored.Num(); }
+	// Messages absorbed since startup
+	uint64 GetAbsorbedCount() const { return AbsorbedCount; }
+
+	static uint32 ClassBit(EVistarClassType Class) { return 1u << static_cast<uint32>(Class); }
+
+private:
+	struct FEntityInfo
+	{
+		EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+		FVistarEntityId ParentId;
+	};
+	TMap<FVistarEntityId, FEntityInfo> Entities;
+
+	uint32 HiddenClassMask;
+	TSet<FVistarEntityId> HiddenRoots;
+
+	// Latest state per hidden entity
+	TMap<FVistarEntityId, FVistarEntityUpdate> Stored;
+
+	uint64 AbsorbedCount;
+};
@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarLease.h"
+
+namespace
+{
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+
+	template <typename T>
+	FORCEINLINE T ReadAt(const uint8* Data, int32 Offset)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		return Value;
+	}
+}
+
+void FVistarHeartbeat::Encode(uint32 HeartbeatId, TConstArrayView<FVistarEntityId> Ids, int32 MaxPartSize, TFunctionRef<void(TArray<uint8>&&)> Emit)
+{
+	// Part boundaries first, every part states the part count
+	TArray<int32> PartStarts;
+	PartStarts.Add(0);
+	int32 PartSize = HeaderSize;
+	for (int32 i = 0; i < Ids.Num(); ++i)
+	{
+		const int32 EntrySize = 1 + Ids[i].Len();
+		const int32 PartCount = i - PartStarts.Last();
+		if (PartCount > 0 && (PartSize + EntrySize > MaxPartSize || PartCount == MAX_uint16))
+		{
+			PartStarts.Add(i);
+			PartSize = HeaderSize;
+		}
+		PartSize += EntrySize;
+	}
+	PartStarts.Add(Ids.Num());
+
+	const int32 Parts = FMath::Min(PartStarts.Num() - 1, (int32)MAX_uint16);
+	for (int32 Part = 0; Part < Parts; ++Part)
+	{
+		const int32 First = PartStarts[Part];
+		const int32 Count = PartStarts[Part + 1] - First;
+
+		TArray<uint8> Buffer;
+		Buffer.SetNumUninitialized(HeaderSize);
+		Buffer[0] = Magic;
+		Buffer[1] = Version;
+		WriteAt<uint16>(Buffer.GetData(), 2, static_cast<uint16>(Count));
+		WriteAt<uint32>(Buffer.GetData(), 4, HeartbeatId);
+		WriteAt<uint16>(Buffer.GetData(), 8, static_cast<uint16>(Part));
+		WriteAt<uint16>(Buffer.GetData(), 10, static_cast<uint16>(Parts));
+		for (int32 i = First; i < First + Count; ++i)
+		{
+			Buffer.Add(static_cast<uint8>(Ids[i].Len()));
+			Buffer.Append(reinterpret_cast<const uint8*>(Ids[i].GetData()), Ids[i].Len());
+		}
+		Emit(MoveTemp(Buffer));
+	}
+}
+
+bool FVistarHeartbeat::Decode(const uint8* Data, int32 Size, FVistarHeartbeat& OutHeartbeat)
+{
+	if (!IsHeartbeat(Data, Size) || Data[1] != Version)
+	{
+		return false;
+	}
+	const int32 Count = ReadAt<uint16>(Data, 2);
+	OutHeartbeat.HeartbeatId = ReadAt<uint32>(Data, 4);
+	OutHeartbeat.Part = ReadAt<uint16>(Data, 8);
+	OutHeartbeat.Parts = ReadAt<uint16>(Data, 10);
+	if (OutHeartbeat.Parts == 0 || OutHeartbeat.Part >= OutHeartbeat.Parts)
+	{
+		return false;
+	}
+
+	OutHeartbeat.Ids.Reset(Count);
+	int32 Offset = HeaderSize;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		if (Offset >= Size || Offset + 1 + Data[Offset] > Size
+			|| !OutHeartbeat.Ids.AddDefaulted_GetRef().Set(reinterpret_cast<const ANSICHAR*>(Data + Offset + 1), Data[Offset]))
+		{
+			return false;
+		}
+		Offset += 1 + Data[Offset];
+	}
+	return Offset == Size;
+}
+
+void FVistarLeaseTable::Renew(const FVistarEntityId& Id, int32 Source, double Now)
+{
+	if (const int32* Index = IndexById.Find(Id))
+	{
+		FEntry& Entry = Entries[*Index];
+		Entry.LastRenewed = Now;
+		Entry.Source = Source;
+		Entry.bUnlisted = false;
+		return;
+	}
+	IndexById.Add(Id, Entries.Num());
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Id = Id;
+	Entry.LastRenewed = Now;
+	Entry.Source = Source;
+}
+
+void FVistarLeaseTable::Forget(const FVistarEntityId& Id)
+{
+	if (const int32* Index = IndexById.Find(Id))
+	{
+		RemoveAt(*Index);
+	}
+}
+
+void FVistarLeaseTable::RemoveAt(int32 Index)
+{
+	IndexById.Remove(Entries[Index].Id);
+	Entries.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	if (Index < Entries.Num())
+	{
+		IndexById[Entries[Index].Id] = Index;
+	}
+}
+
+void FVistarLeaseTable::ApplyHeartbeat(const FVistarHeartbeat& Heartbeat, int32 Source, double Now)
+{
+	FHeartbeatState& State = Heartbeats.FindOrAdd(Source);
+	if (State.HeartbeatId != Heartbeat.HeartbeatId || State.Received.Num() != Heartbeat.Parts)
+	{
+		// A new heartbeat, whatever was missing of the previous one is given up
+		State.HeartbeatId = Heartbeat.HeartbeatId;
+		State.Started = Now;
+		State.Received.Init(false, Heartbeat.Parts);
+		State.NumReceived = 0;
+	}
+	if (State.Received[Heartbeat.Part])
+	{
+		return;
+	}
+	State.Received[Heartbeat.Part] = true;
+	++State.NumReceived;
+
+	for (const FVistarEntityId& Id : Heartbeat.Ids)
+	{
+		Renew(Id, Source, Now);
+		Entries[IndexById[Id]].ListedIn = Heartbeat.HeartbeatId;
+	}
+
+	if (State.NumReceived < Heartbeat.Parts)
+	{
+		return;
+	}
+	// Entities created after the sender built the list are renewed by their own messages meanwhile
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Source == Source && Entry.ListedIn != Heartbeat.HeartbeatId && Entry.LastRenewed < State.Started)
+		{
+			Entry.bUnlisted = true;
+		}
+	}
+}
+
+void FVistarLeaseTable::Sweep(double Now, double LeaseSeconds, int32 ScanBudget, int32 MaxExpired,
+	TFunctionRef<bool(const FVistarEntityId&)> CanExpire, TArray<FVistarEntityId>& OutExpired)
+{
+	const int32 Scan = FMath::Min(ScanBudget, Entries.Num());
+	for (int32 Checked = 0; Checked < Scan && OutExpired.Num() < MaxExpired; ++Checked)
+	{
+		if (Cursor >= Entries.Num())
+		{
+			Cursor = 0;
+		}
+		FEntry& Entry = Entries[Cursor];
+		const bool bExpired = Entry.bUnlisted || (LeaseSeconds > 0.0 && Now - Entry.LastRenewed > LeaseSeconds);
+		if (!bExpired)
+		{
+			++Cursor;
+			continue;
+		}
+		if (!CanExpire(Entry.Id))
+		{
+			Entry.LastRenewed = Now;
+			Entry.bUnlisted = false;
+			++Cursor;
+			continue;
+		}
+
+		// The last entry moves into this slot and is checked next
+		OutExpired.Add(Entry.Id);
+		RemoveAt(Cursor);
+		++ExpiredCount;
+	}
+}
+
+void FVistarLeaseTable::Reset()
+{
+	Entries.Reset();
+	IndexById.Reset();
+	Heartbeats.Reset();
+	Cursor = 0;
+}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * One part of a heartbeat, the IDs of every entity a sender still simulates
+ *   u8 Magic (0xBD), u8 Version, u16 ID count, u32 Heartbeat ID, u16 Part, u16 Part count, then the IDs
+ * A long list is split into parts of one datagram each. Once every part of a heartbeat has arrived, the
+ * viewer retires the entities of that source it did not list.
+ */
+struct VISTAR_API FVistarHeartbeat
+{
+	static constexpr uint8 Magic = 0xBD;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 12;
+
+	uint32 HeartbeatId = 0;
+	uint16 Part = 0;
+	uint16 Parts = 1;
+	TArray<FVistarEntityId> Ids;
+
+	static bool IsHeartbeat(const uint8* Data, int32 Size) { return Size >= HeaderSize && Data[0] == Magic; }
+
+	// Splits Ids into parts of at most MaxPartSize bytes and hands each encoded part to Emit
+	static void Encode(uint32 HeartbeatId, TConstArrayView<FVistarEntityId> Ids, int32 MaxPartSize, TFunctionRef<void(TArray<uint8>&&)> Emit);
+
+	static bool Decode(const uint8* Data, int32 Size, FVistarHeartbeat& OutHeartbeat);
+};
+
+/**
+ * Lease of every entity that arrived from the network, renewed by each message and heartbeat
+ * Renewing is a map lookup. Sweep checks a bounded slice of the entities per call and resumes where it
+ * left off, so the cost per frame stays flat however many entities there are. Game thread only.
+ */
+class VISTAR_API FVistarLeaseTable
+{
+public:
+	// Source is the index of the pipeline the entity arrives from, heartbeats only retire their own source
+	void Renew(const FVistarEntityId& Id, int32 Source, double Now);
+
+	void Forget(const FVistarEntityId& Id);
+
+	// Renews the listed IDs. With every part in, the source's entities not listed and not renewed since
+	// the heartbeat began are marked for the next sweeps
+	void ApplyHeartbeat(const FVistarHeartbeat& Heartbeat, int32 Source, double Now);
+
+	// Checks up to ScanBudget entities and takes out up to MaxExpired whose lease ran out (LeaseSeconds,
+	// 0 = never) or that a heartbeat left out. CanExpire false renews the entity instead
+	void Sweep(double Now, double LeaseSeconds, int32 ScanBudget, int32 MaxExpired,
+		TFunctionRef<bool(const FVistarEntityId&)> CanExpire, TArray<FVistarEntityId>& OutExpired);
+
+	int32 Num() const { return Entries.Num(); }
+	uint64 GetExpiredCount() const { return ExpiredCount; }
+
+	void Reset();
+
+private:
+	struct FEntry
+	{
+		FVistarEntityId Id;
+		double LastRenewed = 0.0;
+		int32 Source = 0;
+		// Last complete heartbeat that left the entity out
+		bool bUnlisted = false;
+		uint32 ListedIn = 0;
+	};
+	// Dense so a sweep walks memory in order, IndexById points into it
+	TArray<FEntry> Entries;
+	TMap<FVistarEntityId, int32> IndexById;
+	int32 Cursor = 0;
+
+	// Parts of the heartbeat being collected, per source
+	struct FHeartbeatState
+	{
+		uint32 HeartbeatId = 0;
+		double Started = 0.0;
+		TBitArray<> Received;
+		int32 NumReceived = 0;
+	};
+	TMap<int32, FHeartbeatState> Heartbeats;
+
+	uint64 ExpiredCount = 0;
+
+	void RemoveAt(int32 Index);
+};
@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarMessage.h"
+
+namespace
+{
+	struct FVistarClassName
+	{
+		const ANSICHAR* Name;
+		int32 Length;
+		EVistarClassType Class;
+	};
+
+	const FVistarClassName GVistarClassNames[] =
+	{
+		{ "drone",			5,	EVistarClassType::VISTAR_TYPE_DRONE },
+		{ "drone_swarm",	11,	EVistarClassType::VISTAR_TYPE_DRONE_SWARM },
+		{ "fighter",		7,	EVistarClassType::VISTAR_TYPE_FIGHTER },
+		{ "uav",			3,	EVistarClassType::VISTAR_TYPE_UAV },
+		{ "radar",			5,	EVistarClassType::VISTAR_TYPE_RADAR },
+		{ "launcher",		8,	EVistarClassType::VISTAR_TYPE_LAUNCHER },
+		{ "missile",		7,	EVistarClassType::VISTAR_TYPE_MISSILE },
+		{ "route",			5,	EVistarClassType::VISTAR_TYPE_ROUTE },
+	};
+
+	EVistarStream ParseStream(const FString& sStream)
+	{
+		if (sStream.Equals("create"))	return EVistarStream::Create;
+		if (sStream.Equals("update"))	return EVistarStream::Update;
+		if (sStream.Equals("delete"))	return EVistarStream::Delete;
+		return EVistarStream::Action;
+	}
+
+	double GetDoubleField(const TSharedPtr<FJsonObject>& JsonObject, const TCHAR* Field)
+	{
+		// Numbers arrive either as JSON numbers or as strings, TryGetStringField handles both
+		FString sValue;
+		if (JsonObject->TryGetStringField(Field, sValue))
+		{
+			return FCString::Atod(*sValue);
+		}
+		return 0.0;
+	}
+}
+
+EVistarClassType VistarClassFromName(const ANSICHAR* Name, int32 Length)
+{
+	for (const FVistarClassName& Entry : GVistarClassNames)
+	{
+		if (Entry.Length == Length && FMemory::Memcmp(Entry.Name, Name, Length) == 0)
+		{
+			return Entry.Class;
+		}
+	}
+	return EVistarClassType::VISTAR_TYPE_NONE;
+}
+
+const ANSICHAR* VistarClassToName(EVistarClassType Class)
+{
+	for (const FVistarClassName& Entry : GVistarClassNames)
+	{
+		if (Entry.Class == Class)
+		{
+			return Entry.Name;
+		}
+	}
+	return "none";
+}
+
+void FVistarEntityUpdate::MergeState(const FVistarEntityUpdate& Newer)
+{
+	const uint8 NewerComponents = Newer.GetComponents();
+	if (NewerComponents != 0)
+	{
+		for (int32 Index = 0; Index < NumComponents; ++Index)
+		{
+			if (NewerComponents & (1 << Index))
+			{
+				GetComponent(Index) = Newer.GetComponent(Index);
+			}
+		}
+		SetComponents(GetComponents() | NewerComponents);
+	}
+	if (Newer.bHasEcef)
+	{
+		bHasEcef = true;
+		Ecef = Newer.Ecef;
+		EcefEuler = Newer.EcefEuler;
+	}
+	if (Newer.bHasLocal)
+	{
+		bHasLocal = true;
+		Local = Newer.Local;
+	}
+}
+
+uint8 FVistarEntityUpdate::GetComponents() const
+{
+	if (DeltaMask != 0)
+	{
+		return DeltaMask;
+	}
+	return (bHasLocation ? Component_Location : 0) | (bHasRotation ? Component_Rotation : 0) | (bHasSlew ? Component_Slew : 0);
+}
+
+void FVistarEntityUpdate::SetComponents(uint8 Components)
+{
+	bHasLocation = (Components & Component_Location) != 0;
+	bHasRotation = (Components & Component_Rotation) != 0;
+	bHasSlew = (Components & Component_Slew) != 0;
+
+	const bool bPartial = (bHasLocation && (Components & Component_Location) != Component_Location)
+		|| (bHasRotation && (Components & Component_Rotation) != Component_Rotation)
+		|| (bHasSlew && (Components & Component_Slew) != Component_Slew);
+	DeltaMask = bPartial ? Components : 0;
+}
+
+double& FVistarEntityUpdate::GetComponent(int32 Index)
+{
+	switch (Index)
+	{
+	case 0:		return Lon;
+	case 1:		return Lat;
+	case 2:		return Alt;
+	case 3:		return Yaw;
+	case 4:		return Pitch;
+	case 5:		return Roll;
+	case 6:		return SlewAz;
+	default:	return SlewElev;
+	}
+}
+
+bool FVistarSourceTransform::Apply(FVistarEntityUpdate& Message) const
+{
+	if (!ApplyId(Message.Id) || !ApplyId(Message.ParentId))
+	{
+		return false;
+	}
+
+	// A delta only carries some of the values
+	const uint8 Components = Message.GetComponents();
+	Message.Lat += (Components & Component_Lat) ? LatOffset : 0.0;
+	Message.Lon += (Components & Component_Lon) ? LonOffset : 0.0;
+	Message.Alt += (Components & Component_Alt) ? AltOffset : 0.0;
+	return true;
+}
+
+bool FVistarSourceTransform::ApplyId(FVistarEntityId& Id) const
+{
+	if (IdPrefix.IsEmpty() || Id.IsEmpty())
+	{
+		return true;
+	}
+	ANSICHAR Buffer[FVistarInlineString::MaxLength * 2];
+	FMemory::Memcpy(Buffer, IdPrefix.GetData(), IdPrefix.Len());
+	FMemory::Memcpy(Buffer + IdPrefix.Len(), Id.GetData(), Id.Len());
+	return Id.Set(Buffer, IdPrefix.Len() + Id.Len());
+}
+
+FVistarInlineString::FVistarInlineString(const FString& Str)
+{
+	Set(Str);
+}
+
+bool FVistarInlineString::Set(const FString& Str)
+{
+	FTCHARToUTF8 Utf8(*Str);
+	return Set(Utf8.Get(), Utf8.Length());
+}
+
+bool FVistarInlineString::Set(const ANSICHAR* InChars, int32 InLength)
+{
+	Length = static_cast<uint8>(FMath::Clamp(InLength, 0, MaxLength));
+	FMemory::Memcpy(Chars, InChars, Length);
+	Chars[Length] = '\0';
+	Hash = FCrc::MemCrc32(Chars, Length);
+	return InLength <= MaxLength;
+}
+
+FString FVistarInlineString::ToString() const
+{
+	FUTF8ToTCHAR Converter(Chars, Length);
+	return FString(Converter.Length(), Converter.Get());
+}
+
+bool FVistarEntityUpdate::FromJson(const TSharedPtr<FJsonObject>& JsonObject, FVistarEntityUpdate& OutMessage)
+{
+	if (!JsonObject.IsValid())
+	{
+		return false;
+	}
+
+	FString sStream, sId;
+	if (!JsonObject->TryGetStringField(TEXT("STREAM"), sStream) || !JsonObject->TryGetStringField(TEXT("ID"), sId))
+	{
+		return false;
+	}
+	OutMessage.Stream = ParseStream(sStream);
+	if (!OutMessage.Id.Set(sId))
+	{
+		return false;
+	}
+
+	FString sClass;
+	if (JsonObject->TryGetStringField(TEXT("CLASS"), sClass))
+	{
+		FTCHARToUTF8 Utf8(*sClass);
+		OutMessage.Class = VistarClassFromName(Utf8.Get(), Utf8.Length());
+	}
+
+	if (OutMessage.Stream == EVistarStream::Create)
+	{
+		FString sParent;
+		if (JsonObject->TryGetStringField(TEXT("PARENT"), sParent))
+		{
+			if (!OutMessage.ParentId.Set(sParent))
+			{
+				return false;
+			}
+		}
+		double dChildId = 0.0;
+		if (JsonObject->TryGetNumberField(TEXT("CHILD_ID"), dChildId))
+		{
+			if (!FMath::IsFinite(dChildId) || dChildId < MIN_int32 || dChildId > MAX_int32)
+			{
+				return false;
+			}
+			OutMessage.ChildId = static_cast<int32>(dChildId);
+		}
+	}
+	else if (OutMessage.Stream == EVistarStream::Action)
+	{
+		FString sAction;
+		if (JsonObject->TryGetStringField(TEXT("ACTION"), sAction))
+		{
+			OutMessage.Action = FVistarInlineString(sAction);
+		}
+	}
+
+	FString sTrajectory;
+	if (JsonObject->TryGetStringField(TEXT("TRAJECTORY"), sTrajectory))
+	{
+		OutMessage.Trajectory = FVistarInlineString(sTrajectory);
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* jsonPoints = nullptr;
+	if (JsonObject->TryGetArrayField(TEXT("POINTS"), jsonPoints))
+	{
+		OutMessage.Points.Reserve(jsonPoints->Num());
+		for (const TSharedPtr<FJsonValue>& jsonPoint : *jsonPoints)
+		{
+			const TSharedPtr<FJsonObject>* jsonPointObject = nullptr;
+			if (jsonPoint.IsValid() && jsonPoint->TryGetObject(jsonPointObject))
+			{
+				OutMessage.Points.Add(FVector3d(
+					GetDoubleField(*jsonPointObject, TEXT("X")),
+					GetDoubleField(*jsonPointObject, TEXT("Y")),
+					GetDoubleField(*jsonPointObject, TEXT("Z"))));
+			}
+		}
+	}
+
+	const TSharedPtr<FJsonObject>* jsonLocation = nullptr;
+	if (JsonObject->TryGetObjectField(TEXT("LOCATION"), jsonLocation))
+	{
+		OutMessage.bHasLocation = true;
+		OutMessage.Lon = GetDoubleField(*jsonLocation, TEXT("X"));
+		OutMessage.Lat = GetDoubleField(*jsonLocation, TEXT("Y"));
+		OutMessage.Alt = GetDoubleField(*jsonLocation, TEXT("Z"));
+	}
+
+	const TSharedPtr<FJsonObject>* jsonRotation = nullptr;
+	if (JsonObject->TryGetObjectField(TEXT("ROTATION"), jsonRotation))
+	{
+		OutMessage.bHasRotation = true;
+		OutMessage.Yaw = GetDoubleField(*jsonRotation, TEXT("YAW"));
+		OutMessage.Pitch = GetDoubleField(*jsonRotation, TEXT("PITCH"));
+		OutMessage.Roll = GetDoubleField(*jsonRotation, TEXT("ROLL"));
+	}
+
+	const TSharedPtr<FJsonObject>* jsonSlew = nullptr;
+	if (JsonObject->TryGetObjectField(TEXT("SLEW"), jsonSlew))
+	{
+		OutMessage.bHasSlew = true;
+		OutMessage.SlewAz = GetDoubleField(*jsonSlew, TEXT("SLEW_AZ"));
+		OutMessage.SlewElev = GetDoubleField(*jsonSlew, TEXT("SLEW_ELEV"));
+	}
+
+	return true;
+}
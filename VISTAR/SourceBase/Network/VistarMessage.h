@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "VistarMessage.generated.h"
+
+UENUM(BlueprintType)
+enum class EVistarClassType : uint8
+{
+	VISTAR_TYPE_NONE        UMETA(DisplayName = "NONE"),
+	VISTAR_TYPE_FIGHTER     UMETA(DisplayName = "FIGHTER"),
+	VISTAR_TYPE_UAV			UMETA(DisplayName = "UAV"),
+	VISTAR_TYPE_DRONE       UMETA(DisplayName = "DRONE"),
+	VISTAR_TYPE_DRONE_SWARM UMETA(DisplayName = "DRONE_SWARM"),
+	VISTAR_TYPE_RADAR		UMETA(DisplayName = "RADAR"),
+	VISTAR_TYPE_LAUNCHER	UMETA(DisplayName = "LAUNCHER"),
+	VISTAR_TYPE_MISSILE		UMETA(DisplayName = "MISSILE"),
+	VISTAR_TYPE_ROUTE		UMETA(DisplayName = "ROUTE"),
+};
+
+// CLASS string <-> enum, the strings are the wire values ("fighter", "drone_swarm", ...)
+VISTAR_API EVistarClassType VistarClassFromName(const ANSICHAR* Name, int32 Length);
+VISTAR_API const ANSICHAR* VistarClassToName(EVistarClassType Class);
+
+/**
+ * STREAM field of a VISTAR message
+ */
+enum class EVistarStream : uint8
+{
+	None,
+	Create,
+	Update,
+	Delete,
+	Action,
+};
+
+/**
+ * Ingest lanes. Create, delete and action messages change the entity set and travel in the control
+ * lane, which is never dropped or coalesced and is drained first. State updates travel in the bulk lane
+ */
+enum class EVistarLane : uint8
+{
+	Control,
+	Bulk,
+};
+
+inline EVistarLane VistarLaneOf(EVistarStream Stream)
+{
+	return Stream == EVistarStream::Update ? EVistarLane::Bulk : EVistarLane::Control;
+}
+
+/**
+ * Single values of LOCATION, ROTATION and SLEW, bit N of the presence mask of a delta update
+ */
+enum EVistarComponents : uint8
+{
+	Component_Lon		= 1 << 0,
+	Component_Lat		= 1 << 1,
+	Component_Alt		= 1 << 2,
+	Component_Yaw		= 1 << 3,
+	Component_Pitch		= 1 << 4,
+	Component_Roll		= 1 << 5,
+	Component_SlewAz	= 1 << 6,
+	Component_SlewElev	= 1 << 7,
+
+	Component_Location	= Component_Lon | Component_Lat | Component_Alt,
+	Component_Rotation	= Component_Yaw | Component_Pitch | Component_Roll,
+	Component_Slew		= Component_SlewAz | Component_SlewElev,
+};
+
+/**
+ * Short UTF-8 string stored inline so decoded messages never touch the heap
+ * Used for entity IDs and ACTION values. Longer input is truncated and Set returns false, decoders drop
+ * messages whose ID does not fit so two long IDs never share an entity
+ */
+struct VISTAR_API FVistarInlineString
+{
+	static constexpr int32 MaxLength = 47;
+
+	FVistarInlineString() = default;
+	explicit FVistarInlineString(const FString& Str);
+
+	// False when InLength is over MaxLength, the first MaxLength bytes are kept
+	bool Set(const ANSICHAR* InChars, int32 InLength);
+	bool Set(const FString& Str);
+	void Reset() { Length = 0; Hash = 0; Chars[0] = '\0'; }
+
+	bool IsEmpty() const { return Length == 0; }
+	int32 Len() const { return Length; }
+	const ANSICHAR* GetData() const { return Chars; }
+
+	FString ToString() const;
+
+	bool operator==(const FVistarInlineString& Other) const
+	{
+		return Hash == Other.Hash && Length == Other.Length && FMemory::Memcmp(Chars, Other.Chars, Length) == 0;
+	}
+	bool operator!=(const FVistarInlineString& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FVistarInlineString& Str) { return Str.Hash; }
+
+private:
+	ANSICHAR Chars[MaxLength + 1] = { 0 };
+	uint8 Length = 0;
+	uint32 Hash = 0;
+};
+
+using FVistarEntityId = FVistarInlineString;
+
+/**
+ * Where and when the datagram carrying a message came from, see FVistarSequence
+ */
+struct FVistarDatagramMeta
+{
+	// Local clock (FVistarSequence::GetLocalTimeUs) when the receiver thread read the datagram
+	int64 ReceiveTimeUs = 0;
+	// Sender timestamp moved onto the local clock, 0 without a sequence header
+	int64 SendTimeLocalUs = 0;
+	uint32 Sequence = 0;
+	uint16 SourceId = 0;
+	bool bHasSequence = false;
+};
+
+/**
+ * One decoded VISTAR entity message, filled on the receiver thread and applied on the game thread
+ */
+struct VISTAR_API FVistarEntityUpdate
+{
+	EVistarStream Stream = EVistarStream::None;
+	EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+
+	FVistarEntityId Id;
+
+	// "create" only
+	FVistarEntityId ParentId;
+	int32 ChildId = 0;
+
+	// Anything that is not create/update/delete
+	FVistarInlineString Action;
+
+	// Trajectory attached to an actor, outbound only
+	FVistarInlineString Trajectory;
+
+	bool bHasLocation = false;
+	double Lon = 0.0;
+	double Lat = 0.0;
+	double Alt = 0.0;
+
+	bool bHasRotation = false;
+	double Yaw = 0.0;
+	double Pitch = 0.0;
+	double Roll = 0.0;
+
+	bool bHasSlew = false;
+	double SlewAz = 0.0;
+	double SlewElev = 0.0;
+
+	// Deltas only, the EVistarComponents carried. A field with some of its components left out is
+	// completed from the entity's last state before it is applied, see FVistarDeltaState.
+	// 0 = every field present is complete
+	uint8 DeltaMask = 0;
+
+	// DIS entity state, position in ECEF meters and psi/theta/phi in radians relative to ECEF.
+	// Converted straight into the local frame on apply, see FVistarEnuFrame
+	bool bHasEcef = false;
+	FVector3d Ecef = FVector3d::ZeroVector;
+	FVector3f EcefEuler = FVector3f::ZeroVector;
+
+	// Relay entries, position already in Unreal units and ROTATION already in the local frame
+	bool bHasLocal = false;
+	FVector3d Local = FVector3d::ZeroVector;
+
+	// Route control points, empty for every other class
+	TArray<FVector3d> Points;
+
+	// Only set when the message carried fields the typed decoder does not know (e.g. route POINTS)
+	TSharedPtr<FJsonObject> ExtraJson;
+
+	// Inbound only, filled by FVistarIngestPipeline
+	FVistarDatagramMeta Meta;
+
+	// Create, delete and action messages change the entity set and are applied ahead of state updates
+	bool IsEvent() const { return Stream != EVistarStream::Update; }
+
+	// Take every state field Newer carries (LOCATION, ROTATION, SLEW, ECEF, local), keep the rest.
+	// Deltas merge value by value
+	void MergeState(const FVistarEntityUpdate& Newer);
+
+	// EVistarComponents present, from DeltaMask or the complete fields
+	uint8 GetComponents() const;
+
+	// Sets the bHas flags for Components, and DeltaMask when a field is only partly covered
+	void SetComponents(uint8 Components);
+
+	// Value of component bit Index (0 = Lon ... 7 = SlewElev)
+	double& GetComponent(int32 Index);
+	double GetComponent(int32 Index) const { return const_cast<FVistarEntityUpdate*>(this)->GetComponent(Index); }
+	static constexpr int32 NumComponents = 8;
+
+	// Extract the VISTAR schema from a parsed JSON message
+	static bool FromJson(const TSharedPtr<FJsonObject>& JsonObject, FVistarEntityUpdate& OutMessage);
+};
+
+/**
+ * How the messages of one ingest source are mapped into the shared entity directory
+ * Applied on the decoding thread of that source, see FVistarIngestSource
+ */
+struct VISTAR_API FVistarSourceTransform
+{
+	// Put in front of ID and PARENT ("sim2:" + "F16_1"), empty keeps the IDs as sent
+	FVistarInlineString IdPrefix;
+
+	double LatOffset = 0.0;
+	double LonOffset = 0.0;
+	double AltOffset = 0.0;
+
+	bool IsIdentity() const { return IdPrefix.IsEmpty() && LatOffset == 0.0 && LonOffset == 0.0 && AltOffset == 0.0; }
+
+	// False when the prefixed ID or PARENT no longer fits, the message must be dropped
+	bool Apply(FVistarEntityUpdate& Message) const;
+
+	// The prefix alone, for IDs outside a message, false when the result no longer fits
+	bool ApplyId(FVistarEntityId& Id) const;
+};
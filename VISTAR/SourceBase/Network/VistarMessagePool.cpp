@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarMessagePool.h"
+
+FVistarMessagePool::FVistarMessagePool(int32 InSlotCount, int32 InSlotSize)
+	: FreeSlots(FMath::Max(InSlotCount, 1) + 1)
+	, SlotSize(FMath::Max(InSlotSize, 64))
+{
+	const int32 SlotCount = FMath::Max(InSlotCount, 1);
+	Slab.SetNumUninitialized(SlotCount * SlotSize);
+
+	// Built before either thread runs, so filling from here is safe
+	for (int32 i = 0; i < SlotCount; ++i)
+	{
+		FreeSlots.Enqueue(static_cast<uint32>(i));
+	}
+}
+
+uint32 FVistarMessagePool::Acquire(int32 Size)
+{
+	uint32 Slot = InvalidSlot;
+	if (Size > SlotSize || !FreeSlots.Dequeue(Slot))
+	{
+		return InvalidSlot;
+	}
+	return Slot;
+}
+
+void FVistarMessagePool::Release(uint32 Slot)
+{
+	FreeSlots.Enqueue(Slot);
+}
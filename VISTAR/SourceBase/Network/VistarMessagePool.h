@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include <atomic>
+
+/**
+ * Fixed slab of equally sized slots for raw messages in flight between two threads
+ * One thread acquires, one thread releases. The free list is an SPSC ring of slot indices,
+ * so neither side locks and nothing is allocated after construction.
+ */
+class VISTAR_API FVistarMessagePool
+{
+public:
+	static constexpr uint32 InvalidSlot = MAX_uint32;
+
+	FVistarMessagePool(int32 InSlotCount, int32 InSlotSize);
+
+	// Producer side. Returns InvalidSlot when Size does not fit a slot or every slot is in flight
+	uint32 Acquire(int32 Size);
+
+	// Consumer side
+	void Release(uint32 Slot);
+
+	uint8* GetData(uint32 Slot) { return Slab.GetData() + static_cast<SIZE_T>(Slot) * SlotSize; }
+
+	int32 GetSlotSize() const { return SlotSize; }
+
+private:
+	TArray<uint8> Slab;
+	TCircularQueue<uint32> FreeSlots;
+	int32 SlotSize;
+};
+
+/**
+ * Allocation counters of the ingest path
+ * Everything counted here is a heap allocation on a path that should be allocation-free in steady
+ * state, so a Total() that stops moving proves the pipeline has settled.
+ */
+struct FVistarIngestAllocStats
+{
+	// Raw messages that went through a pool slot, for reference
+	uint64 PooledMessages = 0;
+	// Raw messages too large for a slot, copied to the heap instead
+	uint64 PoolHeapFallbacks = 0;
+	// Messages decoded through FJsonObject (unknown fields, escapes, POINTS)
+	uint64 DomDecodes = 0;
+	// Decoded messages carrying a heap POINTS array
+	uint64 PointArrays = 0;
+	// Messages rebuilt from fragments
+	uint64 Reassemblies = 0;
+
+	uint64 Total() const { return PoolHeapFallbacks + DomDecodes + PointArrays + Reassemblies; }
+
+	FVistarIngestAllocStats& operator+=(const FVistarIngestAllocStats& Other)
+	{
+		PooledMessages += Other.PooledMessages;
+		PoolHeapFallbacks += Other.PoolHeapFallbacks;
+		DomDecodes += Other.DomDecodes;
+		PointArrays += Other.PointArrays;
+		Reassemblies += Other.Reassemblies;
+		return *this;
+	}
+};
+
+/**
+ * Per-decoder counters, written by one thread and read by the game thread
+ */
+struct FVistarDecodeCounters
+{
+	std::atomic<uint64> DomDecodes{ 0 };
+	std::atomic<uint64> PointArrays{ 0 };
+	std::atomic<uint64> Malformed{ 0 };
+};
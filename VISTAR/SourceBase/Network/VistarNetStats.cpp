@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarNetStats.h"
+#include "VistarIngestSource.h"
+#include "Stats/Stats.h"
+#include "Engine/Engine.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+DECLARE_STATS_GROUP(TEXT("VistarNet"), STATGROUP_VistarNet, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Datagrams/s"), STAT_VistarNet_DatagramRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("KB/s"), STAT_VistarNet_KiloByteRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Parse failures"), STAT_VistarNet_ParseFailures, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Truncated"), STAT_VistarNet_Truncated, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Socket drops"), STAT_VistarNet_SocketDrops, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lost"), STAT_VistarNet_Lost, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reordered"), STAT_VistarNet_Reordered, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queue depth"), STAT_VistarNet_QueueDepth, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Coalesced updates"), STAT_VistarNet_Coalesced, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Stale updates"), STAT_VistarNet_Stale, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Entities"), STAT_VistarNet_Entities, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawned"), STAT_VistarNet_Spawned, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Destroyed"), STAT_VistarNet_Destroyed, STATGROUP_VistarNet);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Receive to apply p95 (ms)"), STAT_VistarNet_ReceiveToApply, STATGROUP_VistarNet);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Control receive to apply p95 (ms)"), STAT_VistarNet_ControlReceiveToApply, STATGROUP_VistarNet);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Send to render p95 (ms)"), STAT_VistarNet_SendToRender, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Interest saved msgs/s"), STAT_VistarNet_InterestSavedRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Interest saved KB/s"), STAT_VistarNet_InterestSavedKiloByteRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Fighter msgs/s"), STAT_VistarNet_FighterRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("UAV msgs/s"), STAT_VistarNet_UavRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Drone msgs/s"), STAT_VistarNet_DroneRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Drone swarm msgs/s"), STAT_VistarNet_DroneSwarmRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Radar msgs/s"), STAT_VistarNet_RadarRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Launcher msgs/s"), STAT_VistarNet_LauncherRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Missile msgs/s"), STAT_VistarNet_MissileRate, STATGROUP_VistarNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Route msgs/s"), STAT_VistarNet_RouteRate, STATGROUP_VistarNet);
+
+namespace
+{
+	// Fixed keys so the overlay replaces its own lines instead of stacking up
+	constexpr uint64 OverlayKey = 0x5649535441524E45ull;
+
+	double ClassRate(const double* Rates, EVistarClassType Class)
+	{
+		return Rates[static_cast<int32>(Class)];
+	}
+}
+
+FVistarNetStats::FVistarNetStats()
+	: WindowStartTime(0.0)
+	, DatagramRate(0.0)
+	, ByteRate(0.0)
+	, InterestSavedRate(0.0)
+	, InterestSavedByteRate(0.0)
+	, InterestSavedShare(0.0)
+	, Csv(nullptr)
+	, CsvStartTime(0.0)
+	, CsvOpenTime(0.0)
+	, CsvFrames(0)
+	, CsvFrameTimeSum(0.0)
+	, CsvFrameTimeMax(0.0)
+{
+	FMemory::Memzero(ClassRates, sizeof(ClassRates));
+}
+
+FVistarNetStats::~FVistarNetStats()
+{
+	CloseCsv();
+}
+
+void FVistarNetStats::Tick(float DeltaTime, const FVistarNetSample& Sample, const FVistarNetworkConfig& Config, const TArray<FVistarIngestSourceStats>& Sources)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (WindowStartTime == 0.0)
+	{
+		WindowStart = Sample;
+		WindowStartTime = Now;
+	}
+
+	const double Elapsed = Now - WindowStartTime;
+	if (Elapsed >= 1.0)
+	{
+		DatagramRate = Rate(Sample.Datagrams, WindowStart.Datagrams, Elapsed);
+		ByteRate = Rate(Sample.Bytes, WindowStart.Bytes, Elapsed);
+		for (int32 i = 0; i < VistarClassCount; ++i)
+		{
+			ClassRates[i] = Rate(Sample.ClassMessages[i], WindowStart.ClassMessages[i], Elapsed);
+		}
+		// The report totals restart with the filter, a drop means a new filter
+		if (Sample.InterestSuppressed >= WindowStart.InterestSuppressed && Sample.InterestPassed >= WindowStart.InterestPassed)
+		{
+			const uint64 Suppressed = Sample.InterestSuppressed - WindowStart.InterestSuppressed;
+			const uint64 Seen = Suppressed + Sample.InterestPassed - WindowStart.InterestPassed;
+			InterestSavedRate = Rate(Sample.InterestSuppressed, WindowStart.InterestSuppressed, Elapsed);
+			InterestSavedByteRate = Rate(Sample.InterestSuppressedBytes, WindowStart.InterestSuppressedBytes, Elapsed);
+			InterestSavedShare = Seen > 0 ? static_cast<double>(Suppressed) / Seen : 0.0;
+		}
+		WindowStart = Sample;
+		WindowStartTime = Now;
+
+		if (Config.bShowStatsOverlay)
+		{
+			DrawOverlay(Sample, Sources);
+		}
+	}
+
+	PublishStats(Sample);
+
+	if (Config.StatsCsvIntervalSeconds <= 0.0f)
+	{
+		CloseCsv();
+		return;
+	}
+	if (!Csv && !OpenCsv(Sample))
+	{
+		return;
+	}
+
+	++CsvFrames;
+	CsvFrameTimeSum += DeltaTime;
+	CsvFrameTimeMax = FMath::Max(CsvFrameTimeMax, static_cast<double>(DeltaTime));
+	if (Now - CsvStartTime >= Config.StatsCsvIntervalSeconds)
+	{
+		WriteCsvRow(Sample, Now);
+	}
+}
+
+void FVistarNetStats::PublishStats(const FVistarNetSample& Sample)
+{
+	SET_DWORD_STAT(STAT_VistarNet_DatagramRate, static_cast<uint32>(DatagramRate));
+	SET_DWORD_STAT(STAT_VistarNet_KiloByteRate, static_cast<uint32>(ByteRate / 1024.0));
+	SET_DWORD_STAT(STAT_VistarNet_ParseFailures, static_cast<uint32>(Sample.ParseFailures));
+	SET_DWORD_STAT(STAT_VistarNet_Truncated, static_cast<uint32>(Sample.Truncated));
+	SET_DWORD_STAT(STAT_VistarNet_SocketDrops, static_cast<uint32>(Sample.SocketDrops));
+	SET_DWORD_STAT(STAT_VistarNet_Lost, static_cast<uint32>(Sample.Lost));
+	SET_DWORD_STAT(STAT_VistarNet_Reordered, static_cast<uint32>(Sample.Reordered));
+	SET_DWORD_STAT(STAT_VistarNet_QueueDepth, Sample.QueueDepth);
+	SET_DWORD_STAT(STAT_VistarNet_Coalesced, static_cast<uint32>(Sample.Coalesced));
+	SET_DWORD_STAT(STAT_VistarNet_Stale, static_cast<uint32>(Sample.Stale));
+	SET_DWORD_STAT(STAT_VistarNet_Entities, Sample.Entities);
+	SET_DWORD_STAT(STAT_VistarNet_Spawned, static_cast<uint32>(Sample.Spawned));
+	SET_DWORD_STAT(STAT_VistarNet_Destroyed, static_cast<uint32>(Sample.Destroyed));
+	SET_FLOAT_STAT(STAT_VistarNet_ReceiveToApply, Sample.ReceiveToApplyP95Ms);
+	SET_FLOAT_STAT(STAT_VistarNet_ControlReceiveToApply, Sample.ControlReceiveToApplyP95Ms);
+	SET_FLOAT_STAT(STAT_VistarNet_SendToRender, Sample.SendToRenderP95Ms);
+	SET_DWORD_STAT(STAT_VistarNet_InterestSavedRate, static_cast<uint32>(InterestSavedRate));
+	SET_DWORD_STAT(STAT_VistarNet_InterestSavedKiloByteRate, static_cast<uint32>(InterestSavedByteRate / 1024.0));
+	SET_DWORD_STAT(STAT_VistarNet_FighterRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_FIGHTER)));
+	SET_DWORD_STAT(STAT_VistarNet_UavRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_UAV)));
+	SET_DWORD_STAT(STAT_VistarNet_DroneRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_DRONE)));
+	SET_DWORD_STAT(STAT_VistarNet_DroneSwarmRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_DRONE_SWARM)));
+	SET_DWORD_STAT(STAT_VistarNet_RadarRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_RADAR)));
+	SET_DWORD_STAT(STAT_VistarNet_LauncherRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_LAUNCHER)));
+	SET_DWORD_STAT(STAT_VistarNet_MissileRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_MISSILE)));
+	SET_DWORD_STAT(STAT_VistarNet_RouteRate, static_cast<uint32>(ClassRate(ClassRates, EVistarClassType::VISTAR_TYPE_ROUTE)));
+}
+
+void FVistarNetStats::DrawOverlay(const FVistarNetSample& Sample, const TArray<FVistarIngestSourceStats>& Sources)
+{
+	if (!GEngine)
+	{
+		return;
+	}
+
+	FString Classes;
+	for (int32 i = 1; i < VistarClassCount; ++i)
+	{
+		if (ClassRates[i] > 0.0)
+		{
+			Classes += FString::Printf(TEXT(" %s %.0f"), ANSI_TO_TCHAR(VistarClassToName(static_cast<EVistarClassType>(i))), ClassRates[i]);
+		}
+	}
+
+	// Shown until the next window replaces it, so the overlay disappears shortly after being turned off
+	FString Text = FString::Printf(
+		TEXT("VistarNet  %.0f dgram/s  %.1f KB/s  queue %u  entities %u\n")
+		TEXT("parse fail %llu  truncated %llu  socket drops %llu  lost %llu  reordered %llu  stale %llu\n")
+		TEXT("spawned %llu  destroyed %llu  coalesced %llu  recv->apply p95 %.1f ms (control %.1f)  send->render p95 %.1f ms\n")
+		TEXT("msgs/s:%s"),
+		DatagramRate, ByteRate / 1024.0, Sample.QueueDepth, Sample.Entities,
+		Sample.ParseFailures, Sample.Truncated, Sample.SocketDrops, Sample.Lost, Sample.Reordered, Sample.Stale,
+		Sample.Spawned, Sample.Destroyed, Sample.Coalesced, Sample.ReceiveToApplyP95Ms, Sample.ControlReceiveToApplyP95Ms,
+		Sample.SendToRenderP95Ms, Classes.IsEmpty() ? TEXT(" -") : *Classes);
+	if (Sample.InterestPassed + Sample.InterestSuppressed > 0)
+	{
+		Text += FString::Printf(TEXT("\ninterest filter saved %.0f msgs/s  %.1f KB/s  (%.0f%%)"),
+			InterestSavedRate, InterestSavedByteRate / 1024.0, InterestSavedShare * 100.0);
+	}
+	if (Sources.Num() > 1)
+	{
+		for (const FVistarIngestSourceStats& Source : Sources)
+		{
+			Text += FString::Printf(TEXT("\nsource %s  %.0f dgram/s  %.0f msgs/s  queue %u  parse fail %llu"),
+				*Source.Name, Source.DatagramRate, Source.MessageRate, Source.QueueDepth, Source.ParseFailures);
+		}
+	}
+	GEngine->AddOnScreenDebugMessage(OverlayKey, 1.5f, FColor::Cyan, Text);
+}
+
+bool FVistarNetStats::OpenCsv(const FVistarNetSample& Sample)
+{
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Logs") / FString::Printf(TEXT("VistarNet-%s.csv"), *FDateTime::Now().ToString());
+	Csv = IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_AllowRead);
+	if (!Csv)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarNetStats: cannot create %s"), *Path);
+		return false;
+	}
+	UE_LOG(LogTemp, Log, TEXT("VistarNetStats: writing %s"), *Path);
+
+	FString Header = TEXT("time_s,frames,avg_frame_ms,max_frame_ms,datagrams_per_s,kb_per_s,parse_failures,truncated,socket_drops,")
+		TEXT("lost,reordered,stale,coalesced,spawned,destroyed,queue_depth,entities,recv_apply_p95_ms,control_recv_apply_p95_ms,")
+		TEXT("send_render_p95_ms,interest_saved_per_s,interest_saved_kb_per_s");
+	for (int32 i = 1; i < VistarClassCount; ++i)
+	{
+		Header += FString::Printf(TEXT(",%s_per_s"), ANSI_TO_TCHAR(VistarClassToName(static_cast<EVistarClassType>(i))));
+	}
+	Header += TEXT("\n");
+	FTCHARToUTF8 Utf8(*Header);
+	Csv->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+
+	CsvStart = Sample;
+	CsvOpenTime = FPlatformTime::Seconds();
+	CsvStartTime = CsvOpenTime;
+	CsvFrames = 0;
+	CsvFrameTimeSum = 0.0;
+	CsvFrameTimeMax = 0.0;
+	return true;
+}
+
+void FVistarNetStats::WriteCsvRow(const FVistarNetSample& Sample, double Now)
+{
+	const double Elapsed = Now - CsvStartTime;
+	FString Row = FString::Printf(TEXT("%.3f,%d,%.2f,%.2f,%.0f,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%u,%u,%.2f,%.2f,%.2f,%.0f,%.1f"),
+		Now - CsvOpenTime, CsvFrames, CsvFrameTimeSum * 1000.0 / CsvFrames, CsvFrameTimeMax * 1000.0,
+		Rate(Sample.Datagrams, CsvStart.Datagrams, Elapsed), Rate(Sample.Bytes, CsvStart.Bytes, Elapsed) / 1024.0,
+		Sample.ParseFailures - CsvStart.ParseFailures, Sample.Truncated - CsvStart.Truncated, Sample.SocketDrops - CsvStart.SocketDrops,
+		Sample.Lost - CsvStart.Lost, Sample.Reordered - CsvStart.Reordered, Sample.Stale - CsvStart.Stale,
+		Sample.Coalesced - CsvStart.Coalesced, Sample.Spawned - CsvStart.Spawned, Sample.Destroyed - CsvStart.Destroyed,
+		Sample.QueueDepth, Sample.Entities, Sample.ReceiveToApplyP95Ms, Sample.ControlReceiveToApplyP95Ms, Sample.SendToRenderP95Ms,
+		Rate(Sample.InterestSuppressed, FMath::Min(CsvStart.InterestSuppressed, Sample.InterestSuppressed), Elapsed),
+		Rate(Sample.InterestSuppressedBytes, FMath::Min(CsvStart.InterestSuppressedBytes, Sample.InterestSuppressedBytes), Elapsed) / 1024.0);
+	for (int32 i = 1; i < VistarClassCount; ++i)
+	{
+		Row += FString::Printf(TEXT(",%.0f"), Rate(Sample.ClassMessages[i], CsvStart.ClassMessages[i], Elapsed));
+	}
+	Row += TEXT("\n");
+
+	FTCHARToUTF8 Utf8(*Row);
+	Csv->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+	// Rows must survive a crash, that is when they are needed most
+	Csv->Flush();
+
+	CsvStart = Sample;
+	CsvStartTime = Now;
+	CsvFrames = 0;
+	CsvFrameTimeSum = 0.0;
+	CsvFrameTimeMax = 0.0;
+}
+
+void FVistarNetStats::CloseCsv()
+{
+	if (Csv)
+	{
+		Csv->Close();
+		delete Csv;
+		Csv = nullptr;
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.h"
+
+struct FVistarIngestSourceStats;
+
+// One counter per EVistarClassType value
+constexpr int32 VistarClassCount = static_cast<int32>(EVistarClassType::VISTAR_TYPE_ROUTE) + 1;
+
+/**
+ * Running totals of the network path, gathered once per frame by UVistarGameInstance
+ */
+struct FVistarNetSample
+{
+	uint64 Datagrams = 0;
+	uint64 Bytes = 0;
+	// Messages, bundles and fragments that failed to decode
+	uint64 ParseFailures = 0;
+	uint64 Truncated = 0;
+	// Kernel receive buffer overflows, Linux only
+	uint64 SocketDrops = 0;
+	uint64 Lost = 0;
+	uint64 Reordered = 0;
+	uint64 Coalesced = 0;
+	uint64 Stale = 0;
+	uint64 Spawned = 0;
+	uint64 Destroyed = 0;
+	// Messages applied per CLASS
+	uint64 ClassMessages[VistarClassCount] = { 0 };
+	// As reported by an interest filter upstream, see FVistarInterestReport
+	uint64 InterestPassed = 0;
+	uint64 InterestSuppressed = 0;
+	uint64 InterestSuppressedBytes = 0;
+
+	// Current values rather than totals
+	uint32 QueueDepth = 0;
+	uint32 Entities = 0;
+	double ReceiveToApplyP95Ms = 0.0;
+	// Create, delete and action messages only
+	double ControlReceiveToApplyP95Ms = 0.0;
+	double SendToRenderP95Ms = 0.0;
+};
+
+/**
+ * Publishes FVistarNetSample as the VistarNet stat group ("stat VistarNet"), an optional on-screen
+ * overlay and an optional CSV file under Saved/Logs. Rates are taken over one-second windows, CSV rows
+ * over StatsCsvIntervalSeconds together with the frame times of the same interval, so a frame spike
+ * can be matched to the traffic that arrived with it. Game thread only.
+ */
+class VISTAR_API FVistarNetStats
+{
+public:
+	FVistarNetStats();
+	~FVistarNetStats();
+
+	// Once per frame. Sources adds a line per ingest source to the overlay when there is more than one
+	void Tick(float DeltaTime, const FVistarNetSample& Sample, const FVistarNetworkConfig& Config, const TArray<FVistarIngestSourceStats>& Sources);
+
+	// Closes the CSV file, a later Tick with CSV enabled starts a new one
+	void CloseCsv();
+
+private:
+	void PublishStats(const FVistarNetSample& Sample);
+	void DrawOverlay(const FVistarNetSample& Sample, const TArray<FVistarIngestSourceStats>& Sources);
+	bool OpenCsv(const FVistarNetSample& Sample);
+	void WriteCsvRow(const FVistarNetSample& Sample, double Now);
+
+	// Per second over [Start, Now] of a running total
+	static double Rate(uint64 Now, uint64 Start, double Seconds) { return Seconds > 0.0 ? (Now - Start) / Seconds : 0.0; }
+
+	// Rate window
+	FVistarNetSample WindowStart;
+	double WindowStartTime;
+	double DatagramRate;
+	double ByteRate;
+	double ClassRates[VistarClassCount];
+	// Traffic the interest filter held back, and its share of what the filter saw
+	double InterestSavedRate;
+	double InterestSavedByteRate;
+	double InterestSavedShare;
+
+	// CSV interval
+	FArchive* Csv;
+	FVistarNetSample CsvStart;
+	double CsvStartTime;
+	double CsvOpenTime;
+	int32 CsvFrames;
+	double CsvFrameTimeSum;
+	double CsvFrameTimeMax;
+};
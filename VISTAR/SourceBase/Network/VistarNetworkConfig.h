@@ -0,0 +1,387 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.generated.h"
+
+/**
+ * Scheduling priority for the network threads
+ */
+UENUM(BlueprintType)
+enum class EVistarThreadPriority : uint8
+{
+	Normal			UMETA(DisplayName = "Normal"),
+	AboveNormal		UMETA(DisplayName = "Above Normal"),
+	Highest			UMETA(DisplayName = "Highest"),
+	TimeCritical	UMETA(DisplayName = "Time Critical"),
+};
+
+/**
+ * Encoding used for outbound messages, inbound traffic is auto-detected
+ */
+UENUM(BlueprintType)
+enum class EVistarWireFormat : uint8
+{
+	Json		UMETA(DisplayName = "JSON"),
+	Binary		UMETA(DisplayName = "Binary"),
+};
+
+/**
+ * Where inbound traffic comes from
+ */
+UENUM(BlueprintType)
+enum class EVistarTransport : uint8
+{
+	Udp				UMETA(DisplayName = "UDP"),
+	// Ring buffer in named shared memory, for a simulator on the same machine
+	SharedMemory	UMETA(DisplayName = "Shared Memory"),
+};
+
+/**
+ * One more simulator to listen to, with its own receiver thread and decode pipeline
+ * See FVistarIngestSource
+ */
+USTRUCT(BlueprintType)
+struct VISTAR_API FVistarIngestSourceConfig
+{
+	GENERATED_BODY()
+
+	// Shown in the stats, and "<Name>:" prefixes its entity IDs with bNamespaceIds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	FString Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	EVistarTransport Transport = EVistarTransport::Udp;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source", meta = (ClampMin = "1", ClampMax = "65535"))
+	int32 Port = 8889;
+
+	// Empty = unicast and broadcast only
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	FString MulticastGroup = TEXT("225.0.0.1");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	FString SharedMemoryName;
+
+	// Keeps equal IDs from two simulators apart, off when the simulators already share one ID space
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	bool bNamespaceIds = true;
+
+	// Added to every LOCATION of this source, for a simulator on another datum or origin.
+	// DIS positions are earth-fixed and taken as they are
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	double LatOffset = 0.0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	double LonOffset = 0.0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Source")
+	double AltOffset = 0.0;
+};
+
+/**
+ * Configuration structure for the VISTAR network ingest path
+ * Defaults reproduce the original single receiver on port 8888
+ */
+USTRUCT(BlueprintType)
+struct VISTAR_API FVistarNetworkConfig
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Transport")
+	EVistarTransport Transport = EVistarTransport::Udp;
+
+	// Name of the shared memory ring, /dev/shm/<name> on Linux
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Transport")
+	FString SharedMemoryName = TEXT("vistar_ingest");
+
+	// Ring size in bytes when the viewer creates it, rounded up to a power of two
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Transport", meta = (ClampMin = "65536"))
+	int32 SharedMemorySize = 16 * 1024 * 1024;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1", ClampMax = "65535"))
+	int32 ListenPort = 8888;
+
+	// Joined on the receive socket, empty = unicast and broadcast only
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive")
+	FString MulticastGroup = TEXT("225.0.0.1");
+
+	// Further simulators, merged into the same entity directory. The receiver above stays the primary
+	// source, it also carries capture, replay and the outbound socket
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive")
+	TArray<FVistarIngestSourceConfig> AdditionalSources;
+
+	// Block on socket readiness and drain every pending datagram per wakeup.
+	// When false the receiver falls back to polling with a 10 ms sleep.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive")
+	bool bEventDrivenReceive = true;
+
+	// Longest time the receiver blocks before re-checking for shutdown
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1", ClampMax = "1000"))
+	int32 ReceiveWaitTimeoutMs = 50;
+
+	// Datagrams pulled per recvmmsg() call (Linux only, other platforms read one at a time)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1", ClampMax = "1024"))
+	int32 ReceiveBatchSize = 64;
+
+	// Upper bound on datagrams drained per wakeup so a flood cannot starve shutdown
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1"))
+	int32 MaxDatagramsPerWakeup = 8192;
+
+	// Kernel receive buffer size in bytes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "65536"))
+	int32 ReceiveBufferSize = 2 * 1024 * 1024;
+
+	// Largest datagram the receiver accepts, larger ones are counted as truncated and dropped.
+	// 65507 is the UDP payload limit, lower it to trade memory per receive slot
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "576", ClampMax = "65507"))
+	int32 MaxDatagramSize = 65507;
+
+	// Partially received fragmented messages kept at once, the oldest is evicted beyond that
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1"))
+	int32 MaxPendingReassemblies = 64;
+
+	// Largest message accepted from fragments, in bytes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "65536"))
+	int32 MaxReassembledSize = 4 * 1024 * 1024;
+
+	// Bytes held by all partially received messages together, the oldest is evicted beyond that. Every
+	// message allocates its whole size with its first fragment, so the entry count alone does not bound it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "65536"))
+	int32 MaxReassemblyBytes = 16 * 1024 * 1024;
+
+	// Largest keyframe body accepted once decompressed, in bytes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "65536"))
+	int32 MaxKeyframeSize = 32 * 1024 * 1024;
+
+	// A fragmented message not complete within this time is dropped
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "10"))
+	int32 ReassemblyTimeoutMs = 2000;
+
+	// Window of the per-source clock offset estimate. Shorter follows clock drift faster,
+	// longer is less likely to miss the fastest datagram
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Receive", meta = (ClampMin = "1", ClampMax = "600"))
+	float ClockOffsetWindowSeconds = 10.0f;
+
+	// Decoded messages buffered between the receiver thread and the game thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "64"))
+	int32 IngestQueueCapacity = 32768;
+
+	// Coalesced entity updates applied per frame, the rest stay pending (0 = no limit)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "0"))
+	int32 MaxUpdatesPerFrame = 4096;
+
+	// Decode threads fed by the receiver, sharded by entity ID so per-entity order holds.
+	// 0 decodes on the receiver thread itself
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "0", ClampMax = "32"))
+	int32 DecodeWorkerCount = 0;
+
+	// Raw messages buffered per decode worker, overflow is dropped and counted
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "64"))
+	int32 DecodeWorkerQueueCapacity = 8192;
+
+	// Bytes per pooled raw message slot of a decode worker. Larger messages fall back to the heap
+	// and show up in the allocation counters
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "64", ClampMax = "65507"))
+	int32 PooledMessageSlotSize = 512;
+
+	// Drop a sequenced state update older than the last one applied to the same entity
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest")
+	bool bDropStaleUpdates = true;
+
+	// DIS exercise to take PDUs from, 0 = every exercise on the port
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "0", ClampMax = "255"))
+	int32 DisExerciseId = 0;
+
+	// State updates for an entity deleted less than this ago are dropped. Deletes travel in the control
+	// lane and can overtake updates sent before them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest")
+	float DeleteHoldSeconds = 1.0f;
+
+	// Entities silent for longer than this are deleted as if the sender had, 0 = never. Keep it above the
+	// slowest update interval of static entities, or have the senders send heartbeats
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "0"))
+	float EntityLeaseSeconds = 0.0f;
+
+	// Entities checked for an expired lease per frame, and how many of them are removed per frame at most
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "1"))
+	int32 LeaseSweepPerFrame = 512;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest", meta = (ClampMin = "1"))
+	int32 MaxExpiredPerFrame = 32;
+
+	// Where outbound messages and interest areas go
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	FString OutboundAddress = TEXT("255.0.0.1");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send", meta = (ClampMin = "1", ClampMax = "65535"))
+	int32 OutboundPort = 7777;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	EVistarWireFormat OutboundWireFormat = EVistarWireFormat::Json;
+
+	// Hand outbound messages to a sender thread instead of writing the socket on the game thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bAsyncSend = true;
+
+	// Async send only: when several updates for one entity are still queued, send only the newest
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bCoalesceOutbound = false;
+
+	// Binary format only: lat/lon in 1e-7 degree and altitude in cm instead of doubles. A message whose
+	// position does not fit (actor transmissions carry Unreal coordinates) goes out as doubles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bQuantizeBinaryPositions = false;
+
+	// Binary format only: angles in 360/65536 degree steps instead of doubles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bQuantizeBinaryAngles = false;
+
+	// Pack outbound messages into bundle frames, flushed once per frame.
+	// Only enable when the peer understands bundles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bBundleOutbound = false;
+
+	// Outbound bundle size in bytes, 1400 fits a standard MTU, 8972 a jumbo frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send", meta = (ClampMin = "576", ClampMax = "65507"))
+	int32 OutboundBundleSize = 1400;
+
+	// Split outbound messages larger than OutboundFragmentSize into fragments.
+	// Messages over the 65507 byte UDP limit are always split, they cannot be sent whole
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bFragmentOutbound = false;
+
+	// Datagram size of each fragment including its 18 byte header
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send", meta = (ClampMin = "576", ClampMax = "65507"))
+	int32 OutboundFragmentSize = 1400;
+
+	// Prefix every outbound datagram with a sequence number and send timestamp.
+	// Only enable when the peer understands the sequence header
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bSendSequenceHeader = false;
+
+	// Source ID written in the sequence header, unique per sender on the network
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send", meta = (ClampMin = "0", ClampMax = "65535"))
+	int32 SequenceSourceId = 1;
+
+	// Send repeated creates and updates as deltas of the components that changed, see FVistarDeltaEncoder.
+	// Only enable when the peer understands deltas
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send")
+	bool bSendDeltas = false;
+
+	// Deltas only: every entity is sent whole at least this often so lost deltas heal
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Send", meta = (ClampMin = "0.1"))
+	float DeltaRefreshSeconds = 5.0f;
+
+	// Classes hidden from startup, see UVistarGameInstance::SetClassLayerVisible
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Ingest")
+	TArray<EVistarClassType> HiddenClasses;
+
+	// Publish the camera footprint so an interest filter upstream can thin out traffic elsewhere
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest")
+	bool bPublishInterest = false;
+
+	// Seconds between area messages. A camera move of a quarter radius publishes at once
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest", meta = (ClampMin = "0.1"))
+	float InterestPublishSeconds = 1.0f;
+
+	// Bounds of the footprint radius, which follows camera height and field of view
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest", meta = (ClampMin = "100"))
+	float InterestMinRadiusMeters = 10000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest", meta = (ClampMin = "100"))
+	float InterestMaxRadiusMeters = 300000.0f;
+
+	// Update rate asked for entities outside the area, 0 = none at all
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest", meta = (ClampMin = "0"))
+	float InterestOutsideRateHz = 1.0f;
+
+	// Classes wanted at full rate inside the area, empty = all
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest")
+	TArray<EVistarClassType> InterestClasses;
+
+	// Identifies this viewer to the filter, 0 = the process ID
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Interest", meta = (ClampMin = "0"))
+	int32 InterestViewerId = 0;
+
+	// Run as a relay: ingest and convert here, multicast the entity state to display nodes instead of
+	// spawning actors. Also on with -VistarRelay and in server builds, see FVistarRelay
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay")
+	bool bRelayMode = false;
+
+	// Where relay frames go, display nodes listen on it through ListenPort and MulticastGroup
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay")
+	FString RelayAddress = TEXT("225.0.0.2");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay")
+	int32 RelayPort = 8890;
+
+	// Relay frames per second, the display frame rate is enough
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay", meta = (ClampMin = "1"))
+	float RelayRateHz = 60.0f;
+
+	// Largest relay datagram in bytes, sequence header included
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay", meta = (ClampMin = "512", ClampMax = "65507"))
+	int32 RelayFrameSize = 1400;
+
+	// Seconds between keyframes of the whole scene for display nodes that join late or lose packets, 0 = none
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay", meta = (ClampMin = "0"))
+	float RelayKeyframeSeconds = 2.0f;
+
+	// Sequence source ID of the relay feed
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Relay", meta = (ClampMin = "0", ClampMax = "65535"))
+	int32 RelaySourceId = 100;
+
+	// On-screen summary of the VistarNet stats, refreshed once a second. "stat VistarNet" shows the full group
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Stats")
+	bool bShowStatsOverlay = false;
+
+	// Write a row of network and frame time figures to Saved/Logs/VistarNet-<date>.csv every
+	// this many seconds, 0 = off
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Stats", meta = (ClampMin = "0"))
+	float StatsCsvIntervalSeconds = 0.0f;
+
+	// Record every received datagram to this capture file from startup, empty = off.
+	// Relative paths go under Saved/Captures
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Capture")
+	FString CaptureFilePath;
+
+	// Play this capture file instead of listening on the socket, empty = live traffic
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Capture")
+	FString ReplayFilePath;
+
+	// 1 = recorded timing, 4 = four times faster, 0 = as fast as the ingest path takes it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Capture", meta = (ClampMin = "0"))
+	float ReplaySpeed = 1.0f;
+
+	// Start over at the end of the capture
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Capture")
+	bool bLoopReplay = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Threading")
+	EVistarThreadPriority ReceiverThreadPriority = EVistarThreadPriority::Normal;
+
+	// Bit mask of cores the receiver thread may run on, 0 = no affinity
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Threading")
+	int64 ReceiverThreadAffinityMask = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network|Threading")
+	EVistarThreadPriority DecodeWorkerThreadPriority = EVistarThreadPriority::Normal;
+
+	// Helpers to map onto the engine threading types
+	static EThreadPriority ToThreadPriority(EVistarThreadPriority Priority)
+	{
+		switch (Priority)
+		{
+		case EVistarThreadPriority::AboveNormal:	return TPri_AboveNormal;
+		case EVistarThreadPriority::Highest:		return TPri_Highest;
+		case EVistarThreadPriority::TimeCritical:	return TPri_TimeCritical;
+		default:									return TPri_Normal;
+		}
+	}
+
+	static uint64 ToAffinityMask(int64 Mask)
+	{
+		return Mask != 0 ? static_cast<uint64>(Mask) : FPlatformAffinity::GetNoAffinityMask();
+	}
+};
@@ -0,0 +1,479 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarRelay.h"
+#include "VistarSequence.h"
+#include "VistarKeyframe.h"
+
+namespace
+{
+	enum EEntryFields : uint8
+	{
+		Field_Parent	= 1 << 0,
+		Field_Action	= 1 << 1,
+		Field_Location	= 1 << 2,
+		Field_Rotation	= 1 << 3,
+		Field_Slew		= 1 << 4,
+	};
+
+	// Positions in millimeters, +-2147 km around the reference
+	constexpr double LocationScale = 10.0;
+	constexpr double AngleScale = 65536.0 / 360.0;
+
+	template <typename T>
+	FORCEINLINE void Write(TArray<uint8>& Buffer, T Value)
+	{
+		const int32 Offset = Buffer.AddUninitialized(sizeof(T));
+		FMemory::Memcpy(Buffer.GetData() + Offset, &Value, sizeof(T));
+	}
+
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+
+	void WriteString(TArray<uint8>& Buffer, const FVistarInlineString& Str)
+	{
+		Write<uint8>(Buffer, static_cast<uint8>(Str.Len()));
+		Buffer.Append(reinterpret_cast<const uint8*>(Str.GetData()), Str.Len());
+	}
+
+	FORCEINLINE int32 QuantizeLocation(double Value)
+	{
+		return static_cast<int32>(FMath::Clamp(FMath::RoundToDouble(Value * LocationScale), static_cast<double>(MIN_int32), static_cast<double>(MAX_int32)));
+	}
+
+	FORCEINLINE int16 QuantizeAngle(double Degrees)
+	{
+		return static_cast<int16>(FMath::RoundToInt(FRotator::NormalizeAxis(Degrees) * AngleScale));
+	}
+
+	struct FEntryReader
+	{
+		const uint8* P;
+		const uint8* End;
+
+		template <typename T>
+		bool Read(T& OutValue)
+		{
+			if (End - P < static_cast<int64>(sizeof(T)))
+			{
+				return false;
+			}
+			FMemory::Memcpy(&OutValue, P, sizeof(T));
+			P += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(FVistarInlineString& OutStr)
+		{
+			uint8 Length = 0;
+			if (!Read(Length) || End - P < Length)
+			{
+				return false;
+			}
+			const bool bFits = OutStr.Set(reinterpret_cast<const ANSICHAR*>(P), Length);
+			P += Length;
+			return bFits;
+		}
+
+		bool ReadAngle(double& OutDegrees)
+		{
+			int16 Value = 0;
+			if (!Read(Value))
+			{
+				return false;
+			}
+			OutDegrees = Value / AngleScale;
+			return true;
+		}
+	};
+}
+
+bool FVistarRelayFrame::ForEachEntry(const uint8* Data, int32 Size, TFunctionRef<void(FVistarEntityUpdate&)> Visit)
+{
+	if (!IsFrame(Data, Size) || Data[1] != Version)
+	{
+		return false;
+	}
+	uint16 Count = 0;
+	FMemory::Memcpy(&Count, Data + 10, sizeof(Count));
+
+	FEntryReader Reader{ Data + HeaderSize, Data + Size };
+	for (uint16 Index = 0; Index < Count; ++Index)
+	{
+		FVistarEntityUpdate Message;
+		uint8 Stream = 0, Class = 0, Fields = 0;
+		if (!Reader.Read(Stream) || !Reader.Read(Class) || !Reader.Read(Fields) || !Reader.ReadString(Message.Id)
+			|| Stream == 0 || Stream > static_cast<uint8>(EVistarStream::Action) || Class > static_cast<uint8>(EVistarClassType::VISTAR_TYPE_ROUTE))
+		{
+			return false;
+		}
+		Message.Stream = static_cast<EVistarStream>(Stream);
+		Message.Class = static_cast<EVistarClassType>(Class);
+
+		if ((Fields & Field_Parent) && (!Reader.ReadString(Message.ParentId) || !Reader.Read(Message.ChildId)))
+		{
+			return false;
+		}
+		if ((Fields & Field_Action) && !Reader.ReadString(Message.Action))
+		{
+			return false;
+		}
+		if (Fields & Field_Location)
+		{
+			int32 X = 0, Y = 0, Z = 0;
+			if (!Reader.Read(X) || !Reader.Read(Y) || !Reader.Read(Z))
+			{
+				return false;
+			}
+			Message.bHasLocal = true;
+			Message.Local = FVector3d(X / LocationScale, Y / LocationScale, Z / LocationScale);
+		}
+		if (Fields & Field_Rotation)
+		{
+			if (!Reader.ReadAngle(Message.Yaw) || !Reader.ReadAngle(Message.Pitch) || !Reader.ReadAngle(Message.Roll))
+			{
+				return false;
+			}
+			Message.bHasRotation = true;
+		}
+		if (Fields & Field_Slew)
+		{
+			if (!Reader.ReadAngle(Message.SlewAz) || !Reader.ReadAngle(Message.SlewElev))
+			{
+				return false;
+			}
+			Message.bHasSlew = true;
+		}
+		Visit(Message);
+	}
+	return true;
+}
+
+void FVistarRelayFrame::WriteHeader(uint8* Data, uint8 Flags, uint32 Frame, uint16 Part, uint16 Count)
+{
+	Data[0] = Magic;
+	Data[1] = Version;
+	Data[2] = Flags;
+	Data[3] = 0;
+	WriteAt<uint32>(Data, 4, Frame);
+	WriteAt<uint16>(Data, 8, Part);
+	WriteAt<uint16>(Data, 10, Count);
+}
+
+void FVistarRelayFrame::WriteEntry(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose, TArray<uint8>& OutBuffer)
+{
+	const bool bState = Message.Stream == EVistarStream::Create || Message.Stream == EVistarStream::Update;
+	uint8 Fields = 0;
+	if (Message.Stream == EVistarStream::Create && !Message.ParentId.IsEmpty())
+	{
+		Fields |= Field_Parent;
+	}
+	if (Message.Stream == EVistarStream::Action)
+	{
+		Fields |= Field_Action;
+	}
+	if (bState && Pose.bHasLocation)
+	{
+		Fields |= Field_Location;
+	}
+	if (bState && Pose.bHasRotation)
+	{
+		Fields |= Field_Rotation;
+	}
+	if (bState && Message.bHasSlew)
+	{
+		Fields |= Field_Slew;
+	}
+
+	Write<uint8>(OutBuffer, static_cast<uint8>(Message.Stream));
+	Write<uint8>(OutBuffer, static_cast<uint8>(Message.Class));
+	Write<uint8>(OutBuffer, Fields);
+	WriteString(OutBuffer, Message.Id);
+	if (Fields & Field_Parent)
+	{
+		WriteString(OutBuffer, Message.ParentId);
+		Write<int32>(OutBuffer, Message.ChildId);
+	}
+	if (Fields & Field_Action)
+	{
+		WriteString(OutBuffer, Message.Action);
+	}
+	if (Fields & Field_Location)
+	{
+		Write<int32>(OutBuffer, QuantizeLocation(Pose.Location.X));
+		Write<int32>(OutBuffer, QuantizeLocation(Pose.Location.Y));
+		Write<int32>(OutBuffer, QuantizeLocation(Pose.Location.Z));
+	}
+	if (Fields & Field_Rotation)
+	{
+		Write<int16>(OutBuffer, QuantizeAngle(Pose.Rotation.X));
+		Write<int16>(OutBuffer, QuantizeAngle(Pose.Rotation.Y));
+		Write<int16>(OutBuffer, QuantizeAngle(Pose.Rotation.Z));
+	}
+	if (Fields & Field_Slew)
+	{
+		Write<int16>(OutBuffer, QuantizeAngle(Message.SlewAz));
+		Write<int16>(OutBuffer, QuantizeAngle(Message.SlewElev));
+	}
+}
+
+FVistarRelay::FVistarRelay(const FVistarNetworkConfig& InConfig)
+	: Config(InConfig)
+	, Interval(1.0 / FMath::Max(InConfig.RelayRateHz, 1.0f))
+	, NextPublish(0.0)
+	, KeyframeInterval(InConfig.RelayKeyframeSeconds)
+	, NextKeyframe(0.0)
+	, KeyframeId(0)
+	, FrameNumber(0)
+	, PartNumber(0)
+	, PartEntries(0)
+	, bPartHasEvents(false)
+	, FramesSent(0)
+	, BytesSent(0)
+{
+	// Parts are sized to fit a datagram on their own, nothing to bundle or collapse. Only keyframes
+	// are fragmented. The sequence header lets the displays see loss on the relay feed
+	Config.bBundleOutbound = false;
+	Config.bFragmentOutbound = true;
+	Config.OutboundFragmentSize = InConfig.RelayFrameSize;
+	Config.bCoalesceOutbound = false;
+	Config.bSendSequenceHeader = true;
+	Config.SequenceSourceId = InConfig.RelaySourceId;
+	MaxPartSize = FMath::Max(InConfig.RelayFrameSize - FVistarSequence::HeaderSize, 512);
+}
+
+FVistarRelay::~FVistarRelay()
+{
+	Sender.Reset();
+	Communicator.Shutdown();
+}
+
+bool FVistarRelay::Start()
+{
+	if (!Communicator.StartSender(Config.RelayAddress, Config.RelayPort))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarRelay: could not open a socket to %s:%d"), *Config.RelayAddress, Config.RelayPort);
+		return false;
+	}
+	Sender = MakeUnique<FVistarSender>(&Communicator, Config);
+	UE_LOG(LogTemp, Log, TEXT("VistarRelay: publishing to %s:%d at %.0f Hz"), *Config.RelayAddress, Config.RelayPort, 1.0 / Interval);
+	return true;
+}
+
+void FVistarRelay::Apply(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose)
+{
+	if (Message.Stream == EVistarStream::Delete)
+	{
+		Entities.Remove(Message.Id);
+		Events.Add({ Message, Pose });
+		return;
+	}
+	if (Message.Stream == EVistarStream::Action)
+	{
+		Events.Add({ Message, Pose });
+		return;
+	}
+
+	FEntity& Entity = Entities.FindOrAdd(Message.Id);
+	if (Message.Class != EVistarClassType::VISTAR_TYPE_NONE)
+	{
+		Entity.Class = Message.Class;
+	}
+	if (Message.Stream == EVistarStream::Create)
+	{
+		Entity.ParentId = Message.ParentId;
+		Entity.ChildId = Message.ChildId;
+	}
+	if (Pose.bHasLocation)
+	{
+		Entity.Pose.bHasLocation = true;
+		Entity.Pose.Location = Pose.Location;
+	}
+	if (Pose.bHasRotation)
+	{
+		Entity.Pose.bHasRotation = true;
+		Entity.Pose.Rotation = Pose.Rotation;
+	}
+	if (Message.bHasSlew)
+	{
+		Entity.bHasSlew = true;
+		Entity.SlewAz = Message.SlewAz;
+		Entity.SlewElev = Message.SlewElev;
+	}
+
+	if (Message.Stream == EVistarStream::Create)
+	{
+		Events.Add({ Message, Pose });
+	}
+	else if (!Entity.bDirty)
+	{
+		Entity.bDirty = true;
+		DirtyIds.Add(Message.Id);
+	}
+}
+
+void FVistarRelay::Tick(double Now)
+{
+	if (!Sender || Now < NextPublish)
+	{
+		return;
+	}
+	// Skip ahead after a stall instead of publishing several frames back to back
+	NextPublish = FMath::Max(NextPublish + Interval, Now);
+	Publish();
+
+	// After the frame, so the keyframe holds everything the displays have been sent so far
+	if (KeyframeInterval > 0.0 && Now >= NextKeyframe)
+	{
+		NextKeyframe = Now + KeyframeInterval;
+		PublishKeyframe();
+	}
+}
+
+void FVistarRelay::Publish()
+{
+	if (Events.Num() == 0 && DirtyIds.Num() == 0)
+	{
+		return;
+	}
+	++FrameNumber;
+	PartNumber = 0;
+
+	for (FEvent& Event : Events)
+	{
+		// A create goes out with the latest state, later updates in the same frame are folded in
+		FEntity* Entity = Event.Message.Stream == EVistarStream::Create ? Entities.Find(Event.Message.Id) : nullptr;
+		if (Entity)
+		{
+			Event.Pose = Entity->Pose;
+			Event.Message.bHasSlew = Entity->bHasSlew;
+			Event.Message.SlewAz = Entity->SlewAz;
+			Event.Message.SlewElev = Entity->SlewElev;
+			Entity->bDirty = false;
+		}
+		WritePart(Event.Message, Event.Pose, true);
+	}
+
+	FVistarEntityUpdate Update;
+	Update.Stream = EVistarStream::Update;
+	for (const FVistarEntityId& Id : DirtyIds)
+	{
+		FEntity* Entity = Entities.Find(Id);
+		if (!Entity || !Entity->bDirty)
+		{
+			continue;
+		}
+		Update.Id = Id;
+		Update.Class = Entity->Class;
+		Update.bHasSlew = Entity->bHasSlew;
+		Update.SlewAz = Entity->SlewAz;
+		Update.SlewElev = Entity->SlewElev;
+		WritePart(Update, Entity->Pose, false);
+		Entity->bDirty = false;
+	}
+	FlushPart();
+	Sender->Flush();
+
+	Events.Reset();
+	DirtyIds.Reset();
+}
+
+void FVistarRelay::PublishKeyframe()
+{
+	if (Entities.Num() == 0)
+	{
+		return;
+	}
+
+	// Every entity as a create with its parent and state, one relay frame per 65535 entities
+	TArray<uint8> Body;
+	FVistarEntityUpdate Create;
+	Create.Stream = EVistarStream::Create;
+	uint16 Count = 0;
+	uint16 BodyPart = 0;
+	const auto SendBody = [this, &Body, &Count, &BodyPart]()
+	{
+		FVistarRelayFrame::WriteHeader(Body.GetData(), FVistarRelayFrame::Flag_Events, KeyframeId, BodyPart++, Count);
+		TArray<uint8> Keyframe = Sender->AcquireBuffer();
+		FVistarKeyframe::Encode(KeyframeId, Body.GetData(), Body.Num(), Keyframe);
+		BytesSent += Keyframe.Num();
+		Sender->Send(MoveTemp(Keyframe));
+		Count = 0;
+	};
+
+	++KeyframeId;
+	for (const TPair<FVistarEntityId, FEntity>& Pair : Entities)
+	{
+		if (Count == 0)
+		{
+			Body.Reset();
+			Body.AddZeroed(FVistarRelayFrame::HeaderSize);
+		}
+		const FEntity& Entity = Pair.Value;
+		Create.Id = Pair.Key;
+		Create.Class = Entity.Class;
+		Create.ParentId = Entity.ParentId;
+		Create.ChildId = Entity.ChildId;
+		Create.bHasSlew = Entity.bHasSlew;
+		Create.SlewAz = Entity.SlewAz;
+		Create.SlewElev = Entity.SlewElev;
+		FVistarRelayFrame::WriteEntry(Create, Entity.Pose, Body);
+		if (++Count == MAX_uint16)
+		{
+			SendBody();
+		}
+	}
+	if (Count > 0)
+	{
+		SendBody();
+	}
+	Sender->Flush();
+}
+
+void FVistarRelay::WritePart(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose, bool bEvent)
+{
+	if (PartEntries == 0)
+	{
+		Part = Sender->AcquireBuffer();
+		Part.AddZeroed(FVistarRelayFrame::HeaderSize);
+	}
+
+	const int32 EntryStart = Part.Num();
+	FVistarRelayFrame::WriteEntry(Message, Pose, Part);
+
+	// Entries never span parts, a full part goes out and the entry starts the next one
+	if (Part.Num() > MaxPartSize && PartEntries > 0)
+	{
+		TArray<uint8, TInlineAllocator<256>> Entry;
+		Entry.Append(Part.GetData() + EntryStart, Part.Num() - EntryStart);
+		Part.SetNum(EntryStart, EAllowShrinking::No);
+		FlushPart();
+
+		Part = Sender->AcquireBuffer();
+		Part.AddZeroed(FVistarRelayFrame::HeaderSize);
+		Part.Append(Entry.GetData(), Entry.Num());
+	}
+
+	++PartEntries;
+	bPartHasEvents |= bEvent;
+}
+
+void FVistarRelay::FlushPart()
+{
+	if (PartEntries == 0)
+	{
+		return;
+	}
+	FVistarRelayFrame::WriteHeader(Part.GetData(), bPartHasEvents ? FVistarRelayFrame::Flag_Events : 0, FrameNumber, PartNumber, PartEntries);
+
+	BytesSent += Part.Num();
+	++FramesSent;
+	Sender->Send(MoveTemp(Part));
+
+	++PartNumber;
+	PartEntries = 0;
+	bPartHasEvents = false;
+}
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.h"
+#include "FUdpCommunicator.h"
+#include "VistarSender.h"
+
+/**
+ * Position (Unreal units) and yaw/pitch/roll (degrees) of a message in the local frame, whichever
+ * form the message carried them in
+ */
+struct FVistarLocalPose
+{
+	bool bHasLocation = false;
+	FVector3d Location = FVector3d::ZeroVector;
+	bool bHasRotation = false;
+	FVector3d Rotation = FVector3d::ZeroVector;
+};
+
+/**
+ * Relay state frames, already converted entity state from a relay node to display nodes
+ *   u8 Magic (0xBA), u8 Version, u8 Flags, u8 Reserved, u32 Frame, u16 Part, u16 Entry count
+ * followed by the entries, see README_Network.md for the layout. One publish is split into parts that
+ * each fit a datagram and decode on their own.
+ */
+class VISTAR_API FVistarRelayFrame
+{
+public:
+	static constexpr uint8 Magic = 0xBA;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 12;
+
+	enum EFlags : uint8
+	{
+		// The part carries creates, deletes or actions, it goes through the control lane
+		Flag_Events = 1 << 0,
+	};
+
+	static bool IsFrame(const uint8* Data, int32 Size) { return Size >= HeaderSize && Data[0] == Magic; }
+	static bool HasEvents(const uint8* Data, int32 Size) { return IsFrame(Data, Size) && (Data[2] & Flag_Events) != 0; }
+
+	// Calls Visit with each entry decoded, Local set instead of LOCATION. False if the part is malformed,
+	// the entries before the bad one have been visited
+	static bool ForEachEntry(const uint8* Data, int32 Size, TFunctionRef<void(FVistarEntityUpdate&)> Visit);
+
+	static void WriteHeader(uint8* Data, uint8 Flags, uint32 Frame, uint16 Part, uint16 Count);
+
+	// Appends one entry. Pose is the converted state, ignored for deletes and actions
+	static void WriteEntry(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose, TArray<uint8>& OutBuffer);
+};
+
+/**
+ * Relay node side of fan-out mode
+ * The relay runs the full ingest path once and keeps the converted state of every entity. At
+ * RelayRateHz it multicasts the frame's events and the state of every entity that changed, so display
+ * nodes apply ready-made Unreal coordinates without decoding JSON or converting positions. Every
+ * RelayKeyframeSeconds the whole scene follows as an FVistarKeyframe for nodes that joined late.
+ * Game thread only, the socket writes run on the FVistarSender thread.
+ */
+class VISTAR_API FVistarRelay
+{
+public:
+	explicit FVistarRelay(const FVistarNetworkConfig& InConfig);
+	// Sends what is still queued before the socket closes
+	~FVistarRelay();
+
+	bool Start();
+
+	// An applied message and its converted pose, in apply order
+	void Apply(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose);
+
+	// Publishes when a relay frame is due
+	void Tick(double Now);
+
+	int32 GetNumEntities() const { return Entities.Num(); }
+	bool HasEntity(const FVistarEntityId& Id) const { return Entities.Contains(Id); }
+	uint64 GetFramesSent() const { return FramesSent; }
+	uint64 GetBytesSent() const { return BytesSent; }
+
+private:
+	struct FEntity
+	{
+		EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+		FVistarEntityId ParentId;
+		int32 ChildId = 0;
+		FVistarLocalPose Pose;
+		bool bHasSlew = false;
+		double SlewAz = 0.0;
+		double SlewElev = 0.0;
+		// Changed since the last publish and not yet covered by an event
+		bool bDirty = false;
+	};
+
+	struct FEvent
+	{
+		FVistarEntityUpdate Message;
+		FVistarLocalPose Pose;
+	};
+
+	void Publish();
+	void PublishKeyframe();
+	void WritePart(const FVistarEntityUpdate& Message, const FVistarLocalPose& Pose, bool bEvent);
+	void FlushPart();
+
+	FVistarNetworkConfig Config;
+	FUdpCommunicator Communicator;
+	TUniquePtr<FVistarSender> Sender;
+
+	TMap<FVistarEntityId, FEntity> Entities;
+	TArray<FVistarEntityId> DirtyIds;
+	TArray<FEvent> Events;
+
+	double Interval;
+	double NextPublish;
+	double KeyframeInterval;
+	double NextKeyframe;
+	uint32 KeyframeId;
+	int32 MaxPartSize;
+
+	// Part being filled
+	TArray<uint8> Part;
+	uint32 FrameNumber;
+	uint16 PartNumber;
+	uint16 PartEntries;
+	bool bPartHasEvents;
+
+	uint64 FramesSent;
+	uint64 BytesSent;
+};
@@ -0,0 +1,253 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarSender.h"
+#include "FUdpCommunicator.h"
+
+namespace
+{
+	// Buffers kept for reuse, enough for one InitializeObjects burst
+	constexpr int32 MaxPooledBuffers = 1024;
+	constexpr int32 PooledBufferReserve = 1024;
+}
+
+FVistarSender::FVistarSender(FUdpCommunicator* InCommunicator, const FVistarNetworkConfig& InConfig)
+	: Communicator(InCommunicator)
+	, bAsync(InConfig.bAsyncSend)
+	, bCoalesce(InConfig.bCoalesceOutbound)
+	// Without bFragmentOutbound only messages over the UDP limit get split. The sequence header
+	// comes on top of every datagram, so it is taken off the size budget up front
+	, Fragmenter((InConfig.bFragmentOutbound ? InConfig.OutboundFragmentSize : 65507) - (InConfig.bSendSequenceHeader ? FVistarSequence::HeaderSize : 0))
+	, bSequence(InConfig.bSendSequenceHeader)
+	, FreeCount(0)
+	, Queued(0)
+	, Thread(nullptr)
+	, WakeEvent(nullptr)
+	, bStop(false)
+	, bIdle(false)
+	, Sent(0)
+	, Coalesced(0)
+{
+	if (bSequence)
+	{
+		SequenceHeader.SourceId = static_cast<uint16>(FMath::Clamp(InConfig.SequenceSourceId, 0, 65535));
+		SequenceScratch.SetNumUninitialized(FVistarSequence::HeaderSize + 65507);
+	}
+
+	if (InConfig.bBundleOutbound)
+	{
+		const int32 BundleSize = InConfig.OutboundBundleSize - (bSequence ? FVistarSequence::HeaderSize : 0);
+		Bundler = MakeUnique<FVistarBundler>(BundleSize,
+			[this](const uint8* Data, int32 Size) { SendDatagram(Data, Size); });
+	}
+
+	if (bAsync)
+	{
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("VistarSender"), 0, TPri_Normal);
+	}
+}
+
+FVistarSender::~FVistarSender()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WakeEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = nullptr;
+	}
+}
+
+void FVistarSender::Stop()
+{
+	bStop = true;
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+TArray<uint8> FVistarSender::AcquireBuffer()
+{
+	if (TOptional<TArray<uint8>> Buffer = Free.Dequeue())
+	{
+		FreeCount.fetch_sub(1, std::memory_order_relaxed);
+		return MoveTemp(Buffer.GetValue());
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.Reserve(PooledBufferReserve);
+	return Buffer;
+}
+
+void FVistarSender::Recycle(TArray<uint8>&& Buffer)
+{
+	if (FreeCount.load(std::memory_order_relaxed) >= MaxPooledBuffers)
+	{
+		return;
+	}
+	Buffer.Reset();
+	FreeCount.fetch_add(1, std::memory_order_relaxed);
+	Free.Enqueue(MoveTemp(Buffer));
+}
+
+void FVistarSender::Send(TArray<uint8>&& Buffer, const FVistarEntityId* CoalesceKey, EVistarStream Stream)
+{
+	if (!bAsync)
+	{
+		Transmit(Buffer.GetData(), Buffer.Num());
+		Recycle(MoveTemp(Buffer));
+		return;
+	}
+
+	FOutbound Message;
+	Message.Bytes = MoveTemp(Buffer);
+	// Control lane messages always go out, only state updates are collapsed
+	if (bCoalesce && CoalesceKey && VistarLaneOf(Stream) == EVistarLane::Bulk)
+	{
+		Message.Key = *CoalesceKey;
+		Message.Stream = Stream;
+		Message.bHasKey = true;
+	}
+	Pending.Enqueue(MoveTemp(Message));
+	Queued.fetch_add(1, std::memory_order_relaxed);
+
+	// A busy sender finds the message on its own, only a sleeping one needs the syscall
+	if (bIdle.load())
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void FVistarSender::Flush()
+{
+	if (!bAsync && Bundler)
+	{
+		Bundler->Flush();
+	}
+}
+
+uint32 FVistarSender::Run()
+{
+	while (!bStop)
+	{
+		ProcessBatch();
+
+		// Same idle handshake as FVistarDecodeWorker, the timeout only bounds a missed signal
+		bIdle = true;
+		if (Pending.IsEmpty() && !bStop)
+		{
+			WakeEvent->Wait(FTimespan::FromMilliseconds(50));
+		}
+		bIdle = false;
+	}
+
+	// Nothing queued before shutdown is lost
+	ProcessBatch();
+	return 0;
+}
+
+void FVistarSender::ProcessBatch()
+{
+	// Take everything queued so far, a burst from one frame is handled as one batch
+	Batch.Reset();
+	while (TOptional<FOutbound> Message = Pending.Dequeue())
+	{
+		Batch.Add(MoveTemp(Message.GetValue()));
+	}
+	if (Batch.Num() == 0)
+	{
+		return;
+	}
+	Queued.fetch_sub(Batch.Num(), std::memory_order_relaxed);
+
+	// Only the newest message per key goes out, at the position of the newest
+	LastIndexByKey.Reset();
+	if (bCoalesce)
+	{
+		for (int32 i = 0; i < Batch.Num(); ++i)
+		{
+			if (Batch[i].bHasKey)
+			{
+				LastIndexByKey.Add(MakeTuple(Batch[i].Key, Batch[i].Stream), i);
+			}
+		}
+	}
+
+	for (int32 i = 0; i < Batch.Num(); ++i)
+	{
+		FOutbound& Message = Batch[i];
+		if (Message.bHasKey && LastIndexByKey.FindChecked(MakeTuple(Message.Key, Message.Stream)) != i)
+		{
+			Coalesced.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			Transmit(Message.Bytes.GetData(), Message.Bytes.Num());
+		}
+		Recycle(MoveTemp(Message.Bytes));
+	}
+
+	// The queue ran dry, a partial bundle would only wait for more traffic
+	if (Bundler)
+	{
+		Bundler->Flush();
+	}
+}
+
+void FVistarSender::Transmit(const uint8* Data, int32 Size)
+{
+	if (Bundler)
+	{
+		Bundler->Add(Data, Size);
+	}
+	else
+	{
+		SendDatagram(Data, Size);
+	}
+}
+
+void FVistarSender::SendDatagram(const uint8* Data, int32 Size)
+{
+	if (!Communicator)
+	{
+		return;
+	}
+
+	if (Size > Fragmenter.GetMaxDatagramSize())
+	{
+		if (!Fragmenter.Split(Data, Size, [this](const uint8* Fragment, int32 FragmentSize) { WriteSocket(Fragment, FragmentSize); }))
+		{
+			UE_LOG(LogTemp, Error, TEXT("VistarSender: message of %d bytes is too large to send"), Size);
+		}
+		Sent.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (WriteSocket(Data, Size))
+	{
+		Sent.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+bool FVistarSender::WriteSocket(const uint8* Data, int32 Size)
+{
+	if (!bSequence)
+	{
+		return Communicator->SendBytes(Data, Size);
+	}
+
+	// Every datagram gets its own number, fragments included, so the receiver sees each loss
+	SequenceHeader.SenderTimeUs = static_cast<uint64>(FVistarSequence::GetLocalTimeUs());
+	uint8* Out = SequenceScratch.GetData();
+	FVistarSequence::WriteHeader(Out, SequenceHeader);
+	FMemory::Memcpy(Out + FVistarSequence::HeaderSize, Data, Size);
+	++SequenceHeader.Sequence;
+	return Communicator->SendBytes(Out, FVistarSequence::HeaderSize + Size);
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Containers/SpscQueue.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.h"
+#include "VistarBundle.h"
+#include "VistarFragment.h"
+#include "VistarSequence.h"
+#include <atomic>
+
+class FUdpCommunicator;
+
+/**
+ * Outbound half of the network path
+ * The game thread fills pooled buffers and hands them over through a lock-free queue. A sender thread
+ * optionally collapses repeated messages per entity, bundles, fragments and writes them to the socket,
+ * each datagram behind a sequence header when bSendSequenceHeader is set.
+ * With bAsyncSend off the same steps run inline on the calling thread.
+ */
+class VISTAR_API FVistarSender : public FRunnable
+{
+public:
+	FVistarSender(FUdpCommunicator* InCommunicator, const FVistarNetworkConfig& InConfig);
+	// Sends whatever is still queued, then joins the thread
+	virtual ~FVistarSender();
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	// Game thread. An empty buffer with spare capacity from the pool
+	TArray<uint8> AcquireBuffer();
+
+	// Game thread. Takes ownership of Buffer. Messages with a key replace an earlier queued message
+	// with the same key that has not gone out yet (state updates only, and only when bCoalesceOutbound)
+	void Send(TArray<uint8>&& Buffer, const FVistarEntityId* CoalesceKey = nullptr, EVistarStream Stream = EVistarStream::None);
+
+	// Game thread, end of frame. Pushes out a partial bundle in synchronous mode
+	void Flush();
+
+	// Datagrams written to the socket, a bundle or a fragmented message counts once
+	uint64 GetSentCount() const { return Sent.load(std::memory_order_relaxed); }
+	uint64 GetCoalescedCount() const { return Coalesced.load(std::memory_order_relaxed); }
+	int32 GetQueueDepth() const { return Queued.load(std::memory_order_relaxed); }
+
+private:
+	struct FOutbound
+	{
+		TArray<uint8> Bytes;
+		FVistarEntityId Key;
+		EVistarStream Stream = EVistarStream::None;
+		bool bHasKey = false;
+	};
+
+	// Sender thread (or caller in synchronous mode)
+	void Transmit(const uint8* Data, int32 Size);
+	void SendDatagram(const uint8* Data, int32 Size);
+	// Adds the sequence header when enabled
+	bool WriteSocket(const uint8* Data, int32 Size);
+	void ProcessBatch();
+	void Recycle(TArray<uint8>&& Buffer);
+
+	FUdpCommunicator* Communicator;
+	bool bAsync;
+	bool bCoalesce;
+
+	TUniquePtr<FVistarBundler> Bundler;
+	FVistarFragmenter Fragmenter;
+
+	bool bSequence;
+	FVistarSequence::FHeader SequenceHeader;
+	// Header plus datagram, only used with bSequence
+	TArray<uint8> SequenceScratch;
+
+	// Game thread -> sender thread
+	TSpscQueue<FOutbound> Pending;
+	// Sender thread -> game thread, emptied buffers for reuse
+	TSpscQueue<TArray<uint8>> Free;
+	std::atomic<int32> FreeCount;
+	std::atomic<int32> Queued;
+
+	// Sender thread scratch
+	TArray<FOutbound> Batch;
+	TMap<TTuple<FVistarEntityId, EVistarStream>, int32> LastIndexByKey;
+
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	std::atomic<bool> bStop;
+	std::atomic<bool> bIdle;
+
+	std::atomic<uint64> Sent;
+	std::atomic<uint64> Coalesced;
+};
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarSequence.h"
+
+namespace
+{
+	template <typename T>
+	FORCEINLINE T ReadAt(const uint8* Data, int32 Offset)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		return Value;
+	}
+
+	template <typename T>
+	FORCEINLINE void WriteAt(uint8* Data, int32 Offset, T Value)
+	{
+		FMemory::Memcpy(Data + Offset, &Value, sizeof(T));
+	}
+
+	// Width of the duplicate window in datagrams
+	constexpr uint32 WindowSize = 64;
+}
+
+bool FVistarSequence::ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader)
+{
+	if (!IsSequenced(Data, Size) || Data[1] != Version)
+	{
+		return false;
+	}
+
+	OutHeader.SourceId = ReadAt<uint16>(Data, 2);
+	OutHeader.Sequence = ReadAt<uint32>(Data, 4);
+	OutHeader.SenderTimeUs = ReadAt<uint64>(Data, 8);
+	return true;
+}
+
+void FVistarSequence::WriteHeader(uint8* Out, const FHeader& Header)
+{
+	Out[0] = Magic;
+	Out[1] = Version;
+	WriteAt<uint16>(Out, 2, Header.SourceId);
+	WriteAt<uint32>(Out, 4, Header.Sequence);
+	WriteAt<uint64>(Out, 8, Header.SenderTimeUs);
+}
+
+FVistarSourceTracker::FVistarSourceTracker(double InOffsetWindowSeconds)
+	: NumSources(0)
+	, OffsetWindowUs(static_cast<int64>(FMath::Max(InOffsetWindowSeconds, 0.1) * 1000000.0))
+{
+}
+
+FVistarSourceTracker::FSource* FVistarSourceTracker::FindOrAdd(uint16 SourceId)
+{
+	const int32 Num = NumSources.load(std::memory_order_relaxed);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		if (Sources[i].SourceId == SourceId)
+		{
+			return &Sources[i];
+		}
+	}
+	if (Num == MaxSources)
+	{
+		return nullptr;
+	}
+
+	Sources[Num].SourceId = SourceId;
+	NumSources.store(Num + 1, std::memory_order_release);
+	return &Sources[Num];
+}
+
+bool FVistarSourceTracker::Track(const FVistarSequence::FHeader& Header, int64 ReceiveTimeUs, int64& OutSendTimeLocalUs)
+{
+	OutSendTimeLocalUs = 0;
+
+	FSource* Source = FindOrAdd(Header.SourceId);
+	if (!Source)
+	{
+		return true;
+	}
+	Source->Received.fetch_add(1, std::memory_order_relaxed);
+
+	const uint32 Sequence = Header.Sequence;
+	const bool bNewer = FVistarSequence::IsNewer(Sequence, Source->Highest);
+	const uint32 Ahead = Sequence - Source->Highest;
+	const uint32 Behind = Source->Highest - Sequence;
+	if (!Source->bStarted || (bNewer ? Ahead : Behind) >= FVistarSequence::RestartDistance)
+	{
+		// First datagram, or the sender restarted its count
+		Source->bStarted = true;
+		Source->Highest = Sequence;
+		Source->Window = 1;
+	}
+	else if (bNewer)
+	{
+		if (Ahead > 1)
+		{
+			Source->Lost.fetch_add(Ahead - 1, std::memory_order_relaxed);
+		}
+		Source->Window = Ahead >= WindowSize ? 1 : (Source->Window << Ahead) | 1;
+		Source->Highest = Sequence;
+	}
+	else if (Behind >= WindowSize)
+	{
+		// Too old to tell a duplicate apart, the game thread drops it if it is stale
+		Source->Late.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		const uint64 Bit = 1ull << Behind;
+		if (Source->Window & Bit)
+		{
+			Source->Duplicates.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		Source->Window |= Bit;
+		Source->Reordered.fetch_add(1, std::memory_order_relaxed);
+
+		// The gap it left was counted as lost when the later datagram arrived
+		if (Source->Lost.load(std::memory_order_relaxed) > 0)
+		{
+			Source->Lost.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	const int64 SenderTimeUs = static_cast<int64>(Header.SenderTimeUs);
+	UpdateOffset(*Source, ReceiveTimeUs - SenderTimeUs, ReceiveTimeUs);
+	OutSendTimeLocalUs = SenderTimeUs + Source->OffsetUs.load(std::memory_order_relaxed);
+	return true;
+}
+
+void FVistarSourceTracker::UpdateOffset(FSource& Source, int64 Sample, int64 ReceiveTimeUs)
+{
+	// Roll the window, the previous minimum keeps the estimate stable across the boundary
+	if (ReceiveTimeUs - Source.WindowStartUs >= OffsetWindowUs)
+	{
+		Source.PrevWindowMin = Source.WindowMin;
+		Source.WindowMin = MAX_int64;
+		Source.WindowStartUs = ReceiveTimeUs;
+	}
+	Source.WindowMin = FMath::Min(Source.WindowMin, Sample);
+	Source.OffsetUs.store(FMath::Min(Source.WindowMin, Source.PrevWindowMin), std::memory_order_relaxed);
+}
+
+void FVistarSourceTracker::GetStats(TArray<FVistarSourceStats>& OutStats) const
+{
+	const int32 Num = NumSources.load(std::memory_order_acquire);
+	OutStats.Reset(Num);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const FSource& Source = Sources[i];
+		FVistarSourceStats& Stats = OutStats.AddDefaulted_GetRef();
+		Stats.SourceId = Source.SourceId;
+		Stats.Received = Source.Received.load(std::memory_order_relaxed);
+		Stats.Lost = Source.Lost.load(std::memory_order_relaxed);
+		Stats.Reordered = Source.Reordered.load(std::memory_order_relaxed);
+		Stats.Duplicates = Source.Duplicates.load(std::memory_order_relaxed);
+		Stats.Late = Source.Late.load(std::memory_order_relaxed);
+		Stats.ClockOffsetMs = Source.OffsetUs.load(std::memory_order_relaxed) / 1000.0;
+	}
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Optional sequence header in front of a datagram
+ *   u8 Magic (0xB8), u8 Version, u16 SourceId, u32 Sequence, u64 SenderTimeUs, payload
+ * The payload is any other frame (JSON, binary, bundle or fragment). Sequence counts datagrams per
+ * source, SenderTimeUs is the sender's monotonic clock. Datagrams without it are handled as before.
+ */
+class VISTAR_API FVistarSequence
+{
+public:
+	static constexpr uint8 Magic = 0xB8;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 16;
+
+	struct FHeader
+	{
+		uint16 SourceId = 0;
+		uint32 Sequence = 0;
+		uint64 SenderTimeUs = 0;
+	};
+
+	static bool IsSequenced(const uint8* Data, int32 Size) { return Size > HeaderSize && Data[0] == Magic; }
+
+	static bool ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader);
+
+	// Out must hold HeaderSize bytes
+	static void WriteHeader(uint8* Out, const FHeader& Header);
+
+	// Monotonic local clock the timestamps are taken from, on both sides of the wire
+	static int64 GetLocalTimeUs() { return static_cast<int64>(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64()) * 1000000.0); }
+
+	// True when A was sent after B, correct across the 32-bit wrap
+	static bool IsNewer(uint32 A, uint32 B) { return static_cast<int32>(A - B) > 0; }
+
+	// A jump further than this either way is a restarted sender rather than loss or a late datagram
+	static constexpr uint32 RestartDistance = 1u << 16;
+};
+
+/**
+ * Delivery counters of one source, see FVistarSourceTracker
+ */
+struct FVistarSourceStats
+{
+	uint16 SourceId = 0;
+	uint64 Received = 0;
+	// Sequence gaps not (yet) filled by a reordered datagram
+	uint64 Lost = 0;
+	// Arrived after a later datagram of the same source
+	uint64 Reordered = 0;
+	// Dropped, the sequence was already received
+	uint64 Duplicates = 0;
+	// Older than the duplicate window, delivered but usually stale
+	uint64 Late = 0;
+	// Sender clock to local clock, including the smallest one-way delay seen
+	double ClockOffsetMs = 0.0;
+};
+
+/**
+ * Receiver-thread bookkeeping of sequenced datagrams
+ * Keeps a 64-datagram window per source to tell loss, reordering and duplicates apart, and
+ * estimates each source's clock offset as the lower envelope of (receive time - send time).
+ * Without a round trip the fixed part of the path delay cannot be separated from the offset, so
+ * latencies built on it are relative to the fastest datagram seen; on a LAN that floor is well
+ * under a millisecond. The envelope is taken over two sliding windows so clock drift is followed.
+ * Track() runs on the receiver thread only, GetStats() can be called from any thread.
+ */
+class VISTAR_API FVistarSourceTracker
+{
+public:
+	static constexpr int32 MaxSources = 32;
+
+	explicit FVistarSourceTracker(double InOffsetWindowSeconds);
+
+	// Returns false for a duplicate that should be dropped. OutSendTimeLocalUs is the send time on
+	// the local clock, 0 when more than MaxSources are seen
+	bool Track(const FVistarSequence::FHeader& Header, int64 ReceiveTimeUs, int64& OutSendTimeLocalUs);
+
+	void GetStats(TArray<FVistarSourceStats>& OutStats) const;
+
+private:
+	struct FSource
+	{
+		uint16 SourceId = 0;
+		bool bStarted = false;
+		uint32 Highest = 0;
+		// Bit N set when Highest - N was received
+		uint64 Window = 0;
+
+		int64 WindowStartUs = 0;
+		int64 WindowMin = MAX_int64;
+		int64 PrevWindowMin = MAX_int64;
+
+		std::atomic<uint64> Received{ 0 };
+		std::atomic<uint64> Lost{ 0 };
+		std::atomic<uint64> Reordered{ 0 };
+		std::atomic<uint64> Duplicates{ 0 };
+		std::atomic<uint64> Late{ 0 };
+		std::atomic<int64> OffsetUs{ 0 };
+	};
+
+	FSource* FindOrAdd(uint16 SourceId);
+
+	void UpdateOffset(FSource& Source, int64 Sample, int64 ReceiveTimeUs);
+
+	FSource Sources[MaxSources];
+	// Entries below this are initialised, published with release so readers see their SourceId
+	std::atomic<int32> NumSources;
+	int64 OffsetWindowUs;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarShmRing.h"
+
+namespace
+{
+	const uint8 RingMagic[8] = { 'V', 'S', 'T', 'R', 'S', 'H', 'M', '1' };
+
+	// Size field of a record that does not fit before the end, the consumer skips to the start
+	constexpr uint32 WrapMarker = 0xFFFFFFFFu;
+
+	constexpr uint32 AccessMode = FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write;
+
+	FORCEINLINE uint64 AlignRecord(uint64 Size)
+	{
+		return (Size + 7) & ~uint64(7);
+	}
+}
+
+// Producer and consumer indices sit on their own cache lines so the two processes do not fight
+// over one. Both only ever grow, a position in the ring is Index & (Capacity - 1)
+struct FVistarShmRing::FHeader
+{
+	uint8 Magic[8];
+	uint32 Version;
+	uint32 Reserved;
+	uint64 Capacity;
+	uint8 Pad0[40];
+
+	// Written by the producer only
+	std::atomic<uint64> WriteIndex;
+	uint8 Pad1[56];
+
+	// Written by the consumer only
+	std::atomic<uint64> ReadIndex;
+	uint8 Pad2[120];
+};
+
+FVistarShmRing::FVistarShmRing(FPlatformMemory::FSharedMemoryRegion* InRegion)
+	: Region(InRegion)
+	, Header(static_cast<FHeader*>(InRegion->GetAddress()))
+	, Data(static_cast<uint8*>(InRegion->GetAddress()) + HeaderSize)
+	, Capacity(static_cast<uint64>(InRegion->GetSize()) - HeaderSize)
+{
+	static_assert(sizeof(FHeader) == HeaderSize, "Shared memory header layout changed");
+	static_assert(std::atomic<uint64>::is_always_lock_free, "Shared memory indices need lock-free 64-bit atomics");
+}
+
+FVistarShmRing::~FVistarShmRing()
+{
+	// The process that created the region also removes the name
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+}
+
+TUniquePtr<FVistarShmRing> FVistarShmRing::CreateConsumer(const FString& Name, int32 Size)
+{
+	const uint64 Capacity = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(Size, 65536)));
+	FPlatformMemory::FSharedMemoryRegion* Region = FPlatformMemory::MapNamedSharedMemoryRegion(Name, true, AccessMode, HeaderSize + Capacity);
+	if (!Region)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarShmRing: could not create shared memory '%s'"), *Name);
+		return nullptr;
+	}
+
+	TUniquePtr<FVistarShmRing> Ring(new FVistarShmRing(Region));
+	FHeader* Header = Ring->Header;
+	if (FMemory::Memcmp(Header->Magic, RingMagic, sizeof(RingMagic)) == 0 && Header->Version == Version && Header->Capacity == Capacity)
+	{
+		// Left over from an earlier run, a producer may still be attached. Keep its position and
+		// skip whatever it wrote while nobody was reading
+		Header->ReadIndex.store(Header->WriteIndex.load(std::memory_order_acquire), std::memory_order_release);
+	}
+	else
+	{
+		Header->Version = Version;
+		Header->Reserved = 0;
+		Header->Capacity = Capacity;
+		Header->WriteIndex.store(0, std::memory_order_relaxed);
+		Header->ReadIndex.store(0, std::memory_order_relaxed);
+		// The magic goes last, a producer that sees it sees a complete header
+		std::atomic_thread_fence(std::memory_order_release);
+		FMemory::Memcpy(Header->Magic, RingMagic, sizeof(RingMagic));
+	}
+	Ring->Capacity = Capacity;
+	return Ring;
+}
+
+TUniquePtr<FVistarShmRing> FVistarShmRing::OpenProducer(const FString& Name)
+{
+	// The size is only known from the header, map that first
+	FPlatformMemory::FSharedMemoryRegion* Probe = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, AccessMode, HeaderSize);
+	if (!Probe)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarShmRing: shared memory '%s' does not exist, start the viewer first"), *Name);
+		return nullptr;
+	}
+	const FHeader* ProbeHeader = static_cast<const FHeader*>(Probe->GetAddress());
+	const bool bValid = FMemory::Memcmp(ProbeHeader->Magic, RingMagic, sizeof(RingMagic)) == 0 && ProbeHeader->Version == Version;
+	const uint64 Capacity = ProbeHeader->Capacity;
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(Probe);
+
+	if (!bValid || Capacity == 0 || !FMath::IsPowerOfTwo(Capacity))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarShmRing: shared memory '%s' is not a version %u ring"), *Name, Version);
+		return nullptr;
+	}
+
+	FPlatformMemory::FSharedMemoryRegion* Region = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, AccessMode, HeaderSize + Capacity);
+	if (!Region)
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarShmRing: could not map shared memory '%s'"), *Name);
+		return nullptr;
+	}
+	TUniquePtr<FVistarShmRing> Ring(new FVistarShmRing(Region));
+	Ring->Capacity = Capacity;
+	return Ring;
+}
+
+int32 FVistarShmRing::GetMaxRecordSize() const
+{
+	// Half the ring, so a record always fits once the consumer catches up, wrap padding included
+	return static_cast<int32>(FMath::Min<uint64>(Capacity / 2 - RecordHeaderSize, MAX_int32));
+}
+
+bool FVistarShmRing::Write(const uint8* InData, int32 Size)
+{
+	if (Size <= 0 || Size > GetMaxRecordSize())
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	const uint64 Record = AlignRecord(RecordHeaderSize + Size);
+	uint64 Write = Header->WriteIndex.load(std::memory_order_relaxed);
+	const uint64 Read = Header->ReadIndex.load(std::memory_order_acquire);
+
+	uint64 Pos = Write & (Capacity - 1);
+	const uint64 Tail = Capacity - Pos;
+	const uint64 Needed = Tail < Record ? Tail + Record : Record;
+	if (Write + Needed - Read > Capacity)
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Records never straddle the end, so the consumer can always hand out one contiguous pointer.
+	// Everything is 8-byte aligned, there is always room for the marker
+	if (Tail < Record)
+	{
+		FMemory::Memcpy(Data + Pos, &WrapMarker, sizeof(WrapMarker));
+		Write += Tail;
+		Pos = 0;
+	}
+
+	const uint32 RecordSize = static_cast<uint32>(Size);
+	FMemory::Memcpy(Data + Pos, &RecordSize, sizeof(RecordSize));
+	FMemory::Memcpy(Data + Pos + RecordHeaderSize, InData, Size);
+	Header->WriteIndex.store(Write + Record, std::memory_order_release);
+	return true;
+}
+
+int32 FVistarShmRing::Drain(TFunctionRef<void(const uint8*, int32)> Deliver, int32 MaxRecords)
+{
+	uint64 Read = Header->ReadIndex.load(std::memory_order_relaxed);
+	const uint64 Write = Header->WriteIndex.load(std::memory_order_acquire);
+	int32 Delivered = 0;
+
+	while (Read != Write && Delivered < MaxRecords)
+	{
+		const uint64 Pos = Read & (Capacity - 1);
+		uint32 Size = 0;
+		FMemory::Memcpy(&Size, Data + Pos, sizeof(Size));
+
+		if (Size == WrapMarker)
+		{
+			Read += Capacity - Pos;
+			continue;
+		}
+		if (Size == 0 || Size > static_cast<uint32>(GetMaxRecordSize()) || Pos + RecordHeaderSize + Size > Capacity)
+		{
+			// Only a misbehaving producer gets here, drop what is in the ring and start clean
+			UE_LOG(LogTemp, Warning, TEXT("VistarShmRing: corrupt record at %llu, skipping %llu bytes"), Read, Write - Read);
+			Read = Write;
+			break;
+		}
+
+		Deliver(Data + Pos + RecordHeaderSize, static_cast<int32>(Size));
+		Read += AlignRecord(RecordHeaderSize + Size);
+		++Delivered;
+
+		// Free each record as soon as it is consumed, the producer may be waiting for space
+		Header->ReadIndex.store(Read, std::memory_order_release);
+	}
+
+	Header->ReadIndex.store(Read, std::memory_order_release);
+	return Delivered;
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+#include <atomic>
+
+/**
+ * Single producer, single consumer ring of datagrams in named shared memory
+ * Lets a simulator on the same machine hand VISTAR messages to the viewer without the two kernel
+ * copies of UDP loopback. The consumer reads records in place, see the README for the layout.
+ */
+class VISTAR_API FVistarShmRing
+{
+public:
+	static constexpr int32 HeaderSize = 256;
+	static constexpr int32 RecordHeaderSize = 8;
+	static constexpr uint32 Version = 1;
+
+	// Viewer side. Maps the region, creating it if needed, and discards anything left in it
+	static TUniquePtr<FVistarShmRing> CreateConsumer(const FString& Name, int32 Size);
+	// Simulator side. Maps a region the consumer has already created
+	static TUniquePtr<FVistarShmRing> OpenProducer(const FString& Name);
+
+	~FVistarShmRing();
+
+	// Producer. False when the consumer has fallen behind and the record does not fit, the record is
+	// dropped like a datagram on a full socket
+	bool Write(const uint8* Data, int32 Size);
+
+	// Consumer. Hands up to MaxRecords records to Deliver, pointing straight into the ring, and frees
+	// each one after Deliver returns. Returns the count delivered
+	int32 Drain(TFunctionRef<void(const uint8* /*Data*/, int32 /*Size*/)> Deliver, int32 MaxRecords);
+
+	// Largest record Write accepts
+	int32 GetMaxRecordSize() const;
+	uint64 GetCapacity() const { return Capacity; }
+	// Records Write dropped on this side
+	uint64 GetDroppedCount() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct FHeader;
+
+	FVistarShmRing(FPlatformMemory::FSharedMemoryRegion* InRegion);
+
+	FPlatformMemory::FSharedMemoryRegion* Region;
+	FHeader* Header;
+	uint8* Data;
+	uint64 Capacity;
+
+	std::atomic<uint64> Dropped{ 0 };
+};
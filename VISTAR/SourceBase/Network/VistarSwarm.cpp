@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarSwarm.h"
+
+namespace
+{
+	constexpr float MinResolution = 0.01f;
+	constexpr float AngleScale = 65536.0f / 360.0f;
+
+	template <typename T>
+	FORCEINLINE void Write(TArray<uint8>& Buffer, T Value)
+	{
+		const int32 Offset = Buffer.AddUninitialized(sizeof(T));
+		FMemory::Memcpy(Buffer.GetData() + Offset, &Value, sizeof(T));
+	}
+
+	template <typename T>
+	FORCEINLINE T ReadAt(const uint8* Data, int32 Offset)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		return Value;
+	}
+
+	FORCEINLINE int16 QuantizeAngle(float Degrees)
+	{
+		return static_cast<int16>(FMath::RoundToInt(FRotator3f::NormalizeAxis(Degrees) * AngleScale));
+	}
+
+	// Count x 3 packed i16 into vectors of Scale steps. No branches or bounds checks inside, the compiler
+	// turns this into SIMD loads and converts
+	void Unpack(const uint8* Packed, int32 Count, float Scale, FVector3f* Out)
+	{
+		for (int32 i = 0; i < Count; ++i)
+		{
+			int16 Values[3];
+			FMemory::Memcpy(Values, Packed + i * sizeof(Values), sizeof(Values));
+			Out[i] = FVector3f(Values[0] * Scale, Values[1] * Scale, Values[2] * Scale);
+		}
+	}
+}
+
+void FVistarSwarm::Encode(const FVistarSwarmUpdate& Swarm, TArray<uint8>& OutBuffer)
+{
+	const int32 Count = FMath::Min(Swarm.Num(), MaxMembers);
+	const bool bAttitudes = Swarm.Attitudes.Num() >= Count && Count > 0;
+
+	float MaxOffset = 0.0f;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		MaxOffset = FMath::Max(MaxOffset, Swarm.Offsets[i].GetAbsMax());
+	}
+	const float Resolution = FMath::Max(MaxOffset / MAX_int16, MinResolution);
+
+	const FVistarEntityId& Id = Swarm.Reference.Id;
+	OutBuffer.Reserve(OutBuffer.Num() + HeaderSize + 1 + Id.Len() + 3 * sizeof(double) + Count * (bAttitudes ? 12 : 6));
+	Write<uint8>(OutBuffer, Magic);
+	Write<uint8>(OutBuffer, Version);
+	Write<uint8>(OutBuffer, bAttitudes ? Flag_Attitudes : 0);
+	Write<uint8>(OutBuffer, static_cast<uint8>(Swarm.MemberClass));
+	Write<uint16>(OutBuffer, static_cast<uint16>(FMath::Clamp(Swarm.FirstMember, 0, (int32)MAX_uint16)));
+	Write<uint16>(OutBuffer, static_cast<uint16>(Count));
+	Write<float>(OutBuffer, Resolution);
+
+	Write<uint8>(OutBuffer, static_cast<uint8>(Id.Len()));
+	OutBuffer.Append(reinterpret_cast<const uint8*>(Id.GetData()), Id.Len());
+	Write<double>(OutBuffer, Swarm.Reference.Lon);
+	Write<double>(OutBuffer, Swarm.Reference.Lat);
+	Write<double>(OutBuffer, Swarm.Reference.Alt);
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const FVector3f& Offset = Swarm.Offsets[i];
+		Write<int16>(OutBuffer, static_cast<int16>(FMath::RoundToInt(Offset.X / Resolution)));
+		Write<int16>(OutBuffer, static_cast<int16>(FMath::RoundToInt(Offset.Y / Resolution)));
+		Write<int16>(OutBuffer, static_cast<int16>(FMath::RoundToInt(Offset.Z / Resolution)));
+	}
+	if (bAttitudes)
+	{
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FVector3f& Attitude = Swarm.Attitudes[i];
+			Write<int16>(OutBuffer, QuantizeAngle(Attitude.X));
+			Write<int16>(OutBuffer, QuantizeAngle(Attitude.Y));
+			Write<int16>(OutBuffer, QuantizeAngle(Attitude.Z));
+		}
+	}
+}
+
+bool FVistarSwarm::Decode(const uint8* Data, int32 Size, FVistarSwarmUpdate& OutSwarm)
+{
+	if (Size <= HeaderSize || Data[0] != Magic || Data[1] != Version || Data[3] > static_cast<uint8>(EVistarClassType::VISTAR_TYPE_ROUTE))
+	{
+		return false;
+	}
+	const uint8 Flags = Data[2];
+	const int32 Count = ReadAt<uint16>(Data, 6);
+	const float Resolution = ReadAt<float>(Data, 8);
+	if (!FMath::IsFinite(Resolution) || Resolution <= 0.0f)
+	{
+		return false;
+	}
+
+	const int32 IdLength = Data[HeaderSize];
+	const int32 MembersAt = HeaderSize + 1 + IdLength + 3 * sizeof(double);
+	const int32 PackedSize = Count * 3 * sizeof(int16);
+	if (IdLength == 0 || Size != MembersAt + ((Flags & Flag_Attitudes) ? 2 * PackedSize : PackedSize))
+	{
+		return false;
+	}
+
+	FVistarEntityUpdate& Reference = OutSwarm.Reference;
+	Reference.Stream = EVistarStream::Update;
+	Reference.Class = EVistarClassType::VISTAR_TYPE_DRONE_SWARM;
+	if (!Reference.Id.Set(reinterpret_cast<const ANSICHAR*>(Data + HeaderSize + 1), IdLength))
+	{
+		return false;
+	}
+	Reference.bHasLocation = true;
+	Reference.Lon = ReadAt<double>(Data, HeaderSize + 1 + IdLength);
+	Reference.Lat = ReadAt<double>(Data, HeaderSize + 1 + IdLength + 8);
+	Reference.Alt = ReadAt<double>(Data, HeaderSize + 1 + IdLength + 16);
+	OutSwarm.MemberClass = static_cast<EVistarClassType>(Data[3]);
+	OutSwarm.FirstMember = ReadAt<uint16>(Data, 4);
+
+	// Sizes were checked once above, the loops run without checks
+	OutSwarm.Offsets.SetNumUninitialized(Count, EAllowShrinking::No);
+	Unpack(Data + MembersAt, Count, Resolution, OutSwarm.Offsets.GetData());
+	if (Flags & Flag_Attitudes)
+	{
+		OutSwarm.Attitudes.SetNumUninitialized(Count, EAllowShrinking::No);
+		Unpack(Data + MembersAt + PackedSize, Count, 1.0f / AngleScale, OutSwarm.Attitudes.GetData());
+	}
+	else
+	{
+		OutSwarm.Attitudes.Reset();
+	}
+	return CanNameMembers(OutSwarm);
+}
+
+bool FVistarSwarm::MakeMemberId(const FVistarEntityId& SwarmId, int32 Index, FVistarEntityId& OutId)
+{
+	ANSICHAR Buffer[FVistarInlineString::MaxLength + 16];
+	FMemory::Memcpy(Buffer, SwarmId.GetData(), SwarmId.Len());
+	const int32 Length = SwarmId.Len() + FCStringAnsi::Snprintf(Buffer + SwarmId.Len(), 16, ".%d", Index);
+	if (Length > FVistarInlineString::MaxLength)
+	{
+		return false;
+	}
+	OutId.Set(Buffer, Length);
+	return true;
+}
+
+bool FVistarSwarm::CanNameMembers(const FVistarSwarmUpdate& Swarm)
+{
+	FVistarEntityId LastMember;
+	return Swarm.Num() == 0 || MakeMemberId(Swarm.Reference.Id, Swarm.FirstMember + Swarm.Num() - 1, LastMember);
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+
+/**
+ * One decoded swarm message, the members of one swarm (or a range of them) around a reference point
+ */
+struct VISTAR_API FVistarSwarmUpdate
+{
+	// The swarm entity itself, an update with LOCATION set to the reference point
+	FVistarEntityUpdate Reference;
+	EVistarClassType MemberClass = EVistarClassType::VISTAR_TYPE_DRONE;
+	// Index of the first member carried, the members are FirstMember .. FirstMember + Offsets.Num() - 1
+	int32 FirstMember = 0;
+	// East, north, up of each member from the reference point, meters
+	TArray<FVector3f> Offsets;
+	// Yaw, pitch, roll of each member in degrees, empty when the message carries none
+	TArray<FVector3f> Attitudes;
+
+	int32 Num() const { return Offsets.Num(); }
+};
+
+/**
+ * Aggregate state of a VISTAR_TYPE_DRONE_SWARM, one message instead of one per member
+ *   u8 Magic (0xBC), u8 Version, u8 Flags, u8 Member class, u16 First member, u16 Count, f32 Resolution,
+ *   swarm ID, f64 lon, f64 lat, f64 alt of the reference point, Count x 3 x i16 offsets, Count x 3 x i16 attitudes
+ * Offsets are east/north/up steps of Resolution meters, attitudes 360/65536 degree steps. Members are
+ * entities of their own named "<swarm ID>.<index>", spawned by their first swarm message and deleted by the
+ * sender like any entity. The reference is converted once on the viewer, every member is placed relative to it.
+ */
+class VISTAR_API FVistarSwarm
+{
+public:
+	static constexpr uint8 Magic = 0xBC;
+	static constexpr uint8 Version = 1;
+	static constexpr int32 HeaderSize = 12;
+	// Members per message, the count is a u16
+	static constexpr int32 MaxMembers = MAX_uint16;
+
+	enum EFlags : uint8
+	{
+		Flag_Attitudes = 1 << 0,
+	};
+
+	static bool IsSwarm(const uint8* Data, int32 Size) { return Size >= HeaderSize && Data[0] == Magic; }
+
+	// Appends the swarm message to OutBuffer. Resolution is the smallest that still fits the farthest member,
+	// at least 1 cm. Members past MaxMembers are left out
+	static void Encode(const FVistarSwarmUpdate& Swarm, TArray<uint8>& OutBuffer);
+
+	// Decodes every member in one pass over the packed arrays, false if malformed
+	static bool Decode(const uint8* Data, int32 Size, FVistarSwarmUpdate& OutSwarm);
+
+	// "<swarm ID>.<index>", false when that is longer than an ID can be. Never truncated, members of a
+	// long swarm ID would all end up with one ID
+	static bool MakeMemberId(const FVistarEntityId& SwarmId, int32 Index, FVistarEntityId& OutId);
+
+	// Whether every member of the swarm gets an ID of its own, the last one has the longest
+	static bool CanNameMembers(const FVistarSwarmUpdate& Swarm);
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarTrafficGenCommandlet.h"
+#include "VistarTrafficGenerator.h"
+
+UVistarTrafficGenCommandlet::UVistarTrafficGenCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UVistarTrafficGenCommandlet::Main(const FString& Params)
+{
+	FVistarTrafficGenOptions Options;
+	FString Error;
+	if (!FVistarTrafficGenOptions::Parse(*Params, Options, Error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VistarTrafficGen: %s"), *Error);
+		return 1;
+	}
+
+	FVistarTrafficGenerator Generator(Options);
+	if (!Generator.Start())
+	{
+		const FString Target = Options.SharedMemoryName.IsEmpty()
+			? FString::Printf(TEXT("a socket to %s:%d"), *Options.TargetIp, Options.Port)
+			: FString::Printf(TEXT("shared memory '%s'"), *Options.SharedMemoryName);
+		UE_LOG(LogTemp, Error, TEXT("VistarTrafficGen: could not open %s"), *Target);
+		return 1;
+	}
+	Generator.Run();
+	return 0;
+}
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VistarTrafficGenCommandlet.generated.h"
+
+/**
+ * Headless synthetic traffic source, see FVistarTrafficGenOptions::Parse for the switches
+ *   UnrealEditor-Cmd VISTAR.uproject -run=VistarTrafficGen -entities=5000 -rate=20 -binary
+ */
+UCLASS()
+class VISTAR_API UVistarTrafficGenCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVistarTrafficGenCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
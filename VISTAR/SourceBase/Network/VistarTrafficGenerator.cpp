@@ -0,0 +1,590 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VistarTrafficGenerator.h"
+#include "FUdpCommunicator.h"
+#include "VistarSender.h"
+#include "VistarBinaryCodec.h"
+#include "VistarJsonWriter.h"
+#include "VistarBundle.h"
+#include "VistarKeyframe.h"
+#include "Misc/Parse.h"
+#include "CoreGlobals.h"
+
+namespace
+{
+	// Somewhere over the default reference point of the viewer
+	constexpr double AreaLat = 13.0;
+	constexpr double AreaLon = 77.5;
+	constexpr double AreaRadiusDeg = 1.0;
+
+	// Sockets on a launcher or swarm
+	constexpr int32 ChildSlots = 4;
+
+	bool IsAttachable(EVistarClassType Class)
+	{
+		return Class == EVistarClassType::VISTAR_TYPE_MISSILE || Class == EVistarClassType::VISTAR_TYPE_DRONE;
+	}
+
+	bool IsParentFor(EVistarClassType Parent, EVistarClassType Child)
+	{
+		return (Child == EVistarClassType::VISTAR_TYPE_MISSILE && Parent == EVistarClassType::VISTAR_TYPE_LAUNCHER)
+			|| (Child == EVistarClassType::VISTAR_TYPE_DRONE && Parent == EVistarClassType::VISTAR_TYPE_DRONE_SWARM);
+	}
+
+	// Rough cruise speed per class in degrees per second along the circle
+	double CruiseSpeed(EVistarClassType Class)
+	{
+		switch (Class)
+		{
+		case EVistarClassType::VISTAR_TYPE_FIGHTER:		return 0.0025;
+		case EVistarClassType::VISTAR_TYPE_MISSILE:		return 0.008;
+		case EVistarClassType::VISTAR_TYPE_UAV:			return 0.0006;
+		case EVistarClassType::VISTAR_TYPE_DRONE:
+		case EVistarClassType::VISTAR_TYPE_DRONE_SWARM:	return 0.0002;
+		default:										return 0.0;
+		}
+	}
+}
+
+bool FVistarTrafficGenOptions::Parse(const TCHAR* Params, FVistarTrafficGenOptions& OutOptions, FString& OutError)
+{
+	FParse::Value(Params, TEXT("ip="), OutOptions.TargetIp);
+	FParse::Value(Params, TEXT("port="), OutOptions.Port);
+	FParse::Value(Params, TEXT("shm="), OutOptions.SharedMemoryName);
+	FParse::Value(Params, TEXT("interestport="), OutOptions.InterestPort);
+	FParse::Value(Params, TEXT("entities="), OutOptions.Entities);
+	FParse::Value(Params, TEXT("rate="), OutOptions.UpdateRateHz);
+	FParse::Value(Params, TEXT("attached="), OutOptions.AttachedFraction);
+	FParse::Value(Params, TEXT("churn="), OutOptions.ChurnPerSecond);
+	FParse::Value(Params, TEXT("actions="), OutOptions.ActionsPerSecond);
+	FParse::Value(Params, TEXT("action="), OutOptions.ActionName);
+	FParse::Value(Params, TEXT("keyframe="), OutOptions.KeyframeSeconds);
+	FParse::Value(Params, TEXT("swarmsize="), OutOptions.SwarmSize);
+	FParse::Value(Params, TEXT("heartbeat="), OutOptions.HeartbeatSeconds);
+	FParse::Value(Params, TEXT("duration="), OutOptions.DurationSeconds);
+	FParse::Value(Params, TEXT("step="), OutOptions.StepSeconds);
+	FParse::Value(Params, TEXT("seed="), OutOptions.Seed);
+
+	FString Mix = TEXT("fighter=4,uav=2,drone_swarm=1,drone=2,missile=2,radar=1,launcher=1");
+	FParse::Value(Params, TEXT("mix="), Mix, false);
+	TArray<FString> Entries;
+	Mix.ParseIntoArray(Entries, TEXT(","));
+	OutOptions.ClassMix.Reset();
+	for (const FString& Entry : Entries)
+	{
+		FString Name, Weight;
+		if (!Entry.Split(TEXT("="), &Name, &Weight))
+		{
+			Name = Entry;
+			Weight = TEXT("1");
+		}
+		FTCHARToUTF8 Utf8(*Name.TrimStartAndEnd().ToLower());
+		const EVistarClassType Class = VistarClassFromName(Utf8.Get(), Utf8.Length());
+		if (Class == EVistarClassType::VISTAR_TYPE_NONE || Class == EVistarClassType::VISTAR_TYPE_ROUTE)
+		{
+			OutError = FString::Printf(TEXT("unknown class '%s' in -mix"), *Name);
+			return false;
+		}
+		OutOptions.ClassMix.Add(Class, FCString::Atof(*Weight));
+	}
+
+	FString Sweep;
+	if (FParse::Value(Params, TEXT("sweep="), Sweep, false))
+	{
+		TArray<FString> Steps;
+		Sweep.ParseIntoArray(Steps, TEXT(","));
+		for (const FString& Step : Steps)
+		{
+			OutOptions.Sweep.Add(FMath::Max(FCString::Atoi(*Step), 0));
+		}
+	}
+
+	FVistarNetworkConfig& Network = OutOptions.Network;
+	Network.OutboundWireFormat = FParse::Param(Params, TEXT("binary")) ? EVistarWireFormat::Binary : EVistarWireFormat::Json;
+	Network.bQuantizeBinaryPositions = FParse::Param(Params, TEXT("quantize"));
+	Network.bQuantizeBinaryAngles = Network.bQuantizeBinaryPositions;
+	Network.bBundleOutbound = FParse::Param(Params, TEXT("bundle"));
+	FParse::Value(Params, TEXT("bundlesize="), Network.OutboundBundleSize);
+	Network.bFragmentOutbound = FParse::Param(Params, TEXT("fragment"));
+	Network.bSendSequenceHeader = FParse::Param(Params, TEXT("seq"));
+	FParse::Value(Params, TEXT("sourceid="), Network.SequenceSourceId);
+	Network.bAsyncSend = !FParse::Param(Params, TEXT("sync"));
+
+	OutOptions.SwarmSize = FMath::Clamp(OutOptions.SwarmSize, 0, FVistarSwarm::MaxMembers);
+
+	if (OutOptions.UpdateRateHz <= 0.0f)
+	{
+		OutError = TEXT("-rate must be above 0");
+		return false;
+	}
+	return true;
+}
+
+FVistarTrafficGenerator::FVistarTrafficGenerator(const FVistarTrafficGenOptions& InOptions)
+	: Options(InOptions)
+	, Random(InOptions.Seed)
+	, Communicator(nullptr)
+	, TickTime(0.0)
+	, NumAttached(0)
+	, NextSerial(0)
+	, TotalWeight(0.0f)
+	, MessagesSent(0)
+	, KeyframeId(0)
+	, HeartbeatId(0)
+{
+	for (const TPair<EVistarClassType, float>& Entry : Options.ClassMix)
+	{
+		if (Entry.Value > 0.0f)
+		{
+			Weights.Add(Entry);
+			TotalWeight += Entry.Value;
+		}
+	}
+	if (Weights.Num() == 0)
+	{
+		Weights.Add(MakeTuple(EVistarClassType::VISTAR_TYPE_FIGHTER, 1.0f));
+		TotalWeight = 1.0f;
+	}
+}
+
+FVistarTrafficGenerator::~FVistarTrafficGenerator()
+{
+	// Drains and joins the sender thread while the socket still exists
+	Sender.Reset();
+	if (Communicator)
+	{
+		Communicator->Shutdown();
+		delete Communicator;
+		Communicator = nullptr;
+	}
+}
+
+bool FVistarTrafficGenerator::Start()
+{
+	Communicator = new FUdpCommunicator();
+	const bool bStarted = Options.SharedMemoryName.IsEmpty()
+		? Communicator->StartSender(Options.TargetIp, Options.Port)
+		: Communicator->StartSharedMemorySender(Options.SharedMemoryName);
+	if (!bStarted)
+	{
+		return false;
+	}
+	Sender = MakeUnique<FVistarSender>(Communicator, Options.Network);
+
+	if (Options.InterestPort > 0)
+	{
+		FOnUdpDataReceived OnArea;
+		OnArea.BindLambda([this](const uint8* Data, int32 Size)
+		{
+			FVistarInterestArea Area;
+			if (FVistarInterest::ReadArea(Data, Size, Area))
+			{
+				PendingAreas.Enqueue(Area);
+			}
+		});
+		if (!Communicator->StartReceiver(Options.InterestPort, OnArea))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("VistarTrafficGen: cannot listen for interest areas on port %d"), Options.InterestPort);
+		}
+	}
+	return true;
+}
+
+EVistarClassType FVistarTrafficGenerator::PickClass()
+{
+	float Pick = Random.FRandRange(0.0f, TotalWeight);
+	for (const TPair<EVistarClassType, float>& Entry : Weights)
+	{
+		Pick -= Entry.Value;
+		if (Pick <= 0.0f)
+		{
+			return Entry.Key;
+		}
+	}
+	return Weights.Last().Key;
+}
+
+void FVistarTrafficGenerator::Spawn()
+{
+	FSimEntity& Entity = Entities.AddDefaulted_GetRef();
+	Entity.Class = PickClass();
+
+	Entity.Id = FVistarEntityId(FString::Printf(TEXT("%s_%llu"), ANSI_TO_TCHAR(VistarClassToName(Entity.Class)), NextSerial++));
+
+	// Attach to a random parent of the right class, if one turns up within a few tries
+	if (IsAttachable(Entity.Class) && Random.FRand() < Options.AttachedFraction && Entities.Num() > 1)
+	{
+		for (int32 Try = 0; Try < 8; ++Try)
+		{
+			const int32 Candidate = Random.RandHelper(Entities.Num() - 1);
+			if (IsParentFor(Entities[Candidate].Class, Entity.Class))
+			{
+				Entity.Parent = Candidate;
+				Entity.ChildId = Random.RandHelper(ChildSlots);
+				++NumAttached;
+				break;
+			}
+		}
+	}
+
+	Entity.CenterLat = AreaLat + Random.FRandRange(-AreaRadiusDeg, AreaRadiusDeg);
+	Entity.CenterLon = AreaLon + Random.FRandRange(-AreaRadiusDeg, AreaRadiusDeg);
+	Entity.Radius = Random.FRandRange(0.01f, 0.1f);
+	Entity.AngularSpeed = CruiseSpeed(Entity.Class) / Entity.Radius * (Random.FRand() < 0.5f ? -1.0 : 1.0);
+	Entity.Phase = Random.FRandRange(0.0f, 2.0f * PI);
+	Entity.Alt = Entity.Class == EVistarClassType::VISTAR_TYPE_RADAR || Entity.Class == EVistarClassType::VISTAR_TYPE_LAUNCHER
+		? 0.0 : Random.FRandRange(100.0f, 10000.0f);
+
+	FVistarEntityUpdate Message;
+	Message.Stream = EVistarStream::Create;
+	FillState(Entity, 0.0, Message);
+	if (Entity.Parent != INDEX_NONE)
+	{
+		Message.ParentId = Entities[Entity.Parent].Id;
+		Message.ChildId = Entity.ChildId;
+	}
+	Send(Message);
+}
+
+void FVistarTrafficGenerator::Despawn(int32 Index)
+{
+	// Children first, highest index first so the removals do not shift the ones still to visit
+	for (int32 i = Entities.Num() - 1; i >= 0; --i)
+	{
+		if (Entities[i].Parent == Index)
+		{
+			Despawn(i);
+			if (i < Index)
+			{
+				--Index;
+			}
+		}
+	}
+
+	FVistarEntityUpdate Message;
+	Message.Stream = EVistarStream::Delete;
+	Message.Id = Entities[Index].Id;
+	Message.Class = Entities[Index].Class;
+	Send(Message);
+
+	// Swarm members are entities of their own
+	if (Options.SwarmSize > 0 && Message.Class == EVistarClassType::VISTAR_TYPE_DRONE_SWARM)
+	{
+		Message.Class = EVistarClassType::VISTAR_TYPE_DRONE;
+		for (int32 i = 0; i < Options.SwarmSize; ++i)
+		{
+			if (FVistarSwarm::MakeMemberId(Entities[Index].Id, i, Message.Id))
+			{
+				Send(Message);
+			}
+		}
+	}
+
+	if (Entities[Index].Parent != INDEX_NONE)
+	{
+		--NumAttached;
+	}
+	Entities.RemoveAt(Index);
+	for (FSimEntity& Entity : Entities)
+	{
+		if (Entity.Parent > Index)
+		{
+			--Entity.Parent;
+		}
+	}
+}
+
+void FVistarTrafficGenerator::SetEntityCount(int32 Count)
+{
+	while (Entities.Num() < Count)
+	{
+		Spawn();
+	}
+	while (Entities.Num() > Count)
+	{
+		Despawn(Entities.Num() - 1);
+	}
+}
+
+void FVistarTrafficGenerator::FillState(const FSimEntity& Entity, double Time, FVistarEntityUpdate& OutMessage) const
+{
+	OutMessage.Id = Entity.Id;
+	OutMessage.Class = Entity.Class;
+
+	const double Angle = Entity.Phase + Entity.AngularSpeed * Time;
+	OutMessage.bHasLocation = true;
+	OutMessage.Lat = Entity.CenterLat + Entity.Radius * FMath::Sin(Angle);
+	OutMessage.Lon = Entity.CenterLon + Entity.Radius * FMath::Cos(Angle);
+	OutMessage.Alt = Entity.Alt;
+
+	// Heading along the circle
+	OutMessage.bHasRotation = true;
+	OutMessage.Yaw = FMath::Fmod(FMath::RadiansToDegrees(Entity.AngularSpeed >= 0.0 ? -Angle : PI - Angle) + 720.0, 360.0);
+	OutMessage.Pitch = 0.0;
+	OutMessage.Roll = Entity.AngularSpeed != 0.0 ? (Entity.AngularSpeed > 0.0 ? -15.0 : 15.0) : 0.0;
+
+	if (Entity.Class == EVistarClassType::VISTAR_TYPE_RADAR)
+	{
+		OutMessage.bHasSlew = true;
+		OutMessage.SlewAz = FMath::Fmod(Time * 36.0 + FMath::RadiansToDegrees(Entity.Phase), 360.0);
+		OutMessage.SlewElev = 10.0;
+	}
+}
+
+void FVistarTrafficGenerator::Encode(const FVistarEntityUpdate& Message, TArray<uint8>& OutBuffer) const
+{
+	if (Options.Network.OutboundWireFormat == EVistarWireFormat::Binary)
+	{
+		FVistarBinaryCodec::FOptions BinaryOptions;
+		BinaryOptions.bQuantizePosition = Options.Network.bQuantizeBinaryPositions;
+		BinaryOptions.bQuantizeAngles = Options.Network.bQuantizeBinaryAngles;
+		FVistarBinaryCodec::EncodeEntity(Message, BinaryOptions, OutBuffer);
+	}
+	else
+	{
+		FVistarJsonWriter::WriteEntity(Message, OutBuffer, nullptr);
+	}
+}
+
+void FVistarTrafficGenerator::Send(const FVistarEntityUpdate& Message)
+{
+	TArray<uint8> Buffer = Sender->AcquireBuffer();
+	Encode(Message, Buffer);
+	if (!Interest.Accept(Message, Buffer.Num(), TickTime))
+	{
+		return;
+	}
+	Sender->Send(MoveTemp(Buffer));
+	++MessagesSent;
+}
+
+void FVistarTrafficGenerator::SendHeartbeat()
+{
+	TArray<FVistarEntityId> Ids;
+	Ids.Reserve(Entities.Num());
+	for (const FSimEntity& Entity : Entities)
+	{
+		Ids.Add(Entity.Id);
+	}
+	FVistarHeartbeat::Encode(++HeartbeatId, Ids, Options.Network.OutboundBundleSize, [this](TArray<uint8>&& Part)
+	{
+		Sender->Send(MoveTemp(Part));
+	});
+}
+
+void FVistarTrafficGenerator::SendKeyframe(double Time)
+{
+	// The body is a bundle of creates, so a viewer decodes it like any other traffic
+	TArray<uint8> Body;
+	uint16 Count = 0;
+	const auto SendBody = [this, &Body, &Count]()
+	{
+		FMemory::Memcpy(Body.GetData() + 2, &Count, sizeof(Count));
+		TArray<uint8> Keyframe = Sender->AcquireBuffer();
+		FVistarKeyframe::Encode(KeyframeId, Body.GetData(), Body.Num(), Keyframe);
+		Sender->Send(MoveTemp(Keyframe));
+		Count = 0;
+	};
+
+	++KeyframeId;
+	TArray<uint8> Message;
+	for (const FSimEntity& Entity : Entities)
+	{
+		if (Count == 0)
+		{
+			Body.Reset();
+			Body.Add(FVistarBundle::Magic);
+			Body.Add(FVistarBundle::Version);
+			Body.AddZeroed(2);
+		}
+		FVistarEntityUpdate Create;
+		Create.Stream = EVistarStream::Create;
+		FillState(Entity, Time, Create);
+		Create.ParentId = Entity.Parent != INDEX_NONE ? Entities[Entity.Parent].Id : FVistarEntityId();
+		Create.ChildId = Entity.Parent != INDEX_NONE ? Entity.ChildId : 0;
+		Message.Reset();
+		Encode(Create, Message);
+		const uint16 Length = static_cast<uint16>(Message.Num());
+		Body.Append(reinterpret_cast<const uint8*>(&Length), sizeof(Length));
+		Body.Append(Message);
+		if (++Count == MAX_uint16)
+		{
+			SendBody();
+		}
+	}
+	if (Count > 0)
+	{
+		SendBody();
+	}
+}
+
+void FVistarTrafficGenerator::SendSwarm(const FSimEntity& Entity, double Time)
+{
+	FVistarEntityUpdate& Reference = Swarm.Reference;
+	FillState(Entity, Time, Reference);
+	Reference.Stream = EVistarStream::Update;
+	Swarm.MemberClass = EVistarClassType::VISTAR_TYPE_DRONE;
+	Swarm.FirstMember = 0;
+	Swarm.Offsets.SetNumUninitialized(Options.SwarmSize, EAllowShrinking::No);
+	Swarm.Attitudes.SetNumUninitialized(Options.SwarmSize, EAllowShrinking::No);
+
+	// Members on a sunflower disc that slowly turns and breathes, 15 m apart, all on the swarm's heading
+	constexpr float Spacing = 15.0f;
+	const float Spin = static_cast<float>(Time * 0.1);
+	for (int32 i = 0; i < Options.SwarmSize; ++i)
+	{
+		const float Radius = Spacing * FMath::Sqrt(static_cast<float>(i));
+		const float Angle = i * 2.39996323f + Spin;
+		Swarm.Offsets[i] = FVector3f(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), 5.0f * FMath::Sin(Angle + Spin * 10.0f));
+		Swarm.Attitudes[i] = FVector3f(static_cast<float>(Reference.Yaw), 0.0f, static_cast<float>(Reference.Roll));
+	}
+
+	TArray<uint8> Buffer = Sender->AcquireBuffer();
+	FVistarSwarm::Encode(Swarm, Buffer);
+	if (!Interest.Accept(Reference, Buffer.Num(), TickTime))
+	{
+		return;
+	}
+	Sender->Send(MoveTemp(Buffer));
+	++MessagesSent;
+}
+
+int32 FVistarTrafficGenerator::GetTargetCount(double Time) const
+{
+	if (Options.Sweep.Num() == 0)
+	{
+		return Options.Entities;
+	}
+	const int32 Step = FMath::Min(static_cast<int32>(Time / FMath::Max(Options.StepSeconds, 1.0f)), Options.Sweep.Num() - 1);
+	return Options.Sweep[Step];
+}
+
+void FVistarTrafficGenerator::Run()
+{
+	const double TickSeconds = 1.0 / Options.UpdateRateHz;
+	const double Duration = Options.Sweep.Num() > 0
+		? Options.Sweep.Num() * FMath::Max(Options.StepSeconds, 1.0f)
+		: Options.DurationSeconds;
+
+	const double StartTime = FPlatformTime::Seconds();
+	double NextTick = StartTime;
+	double NextReport = StartTime + 1.0;
+	double ChurnDue = 0.0;
+	double ActionsDue = 0.0;
+	double NextKeyframe = 0.0;
+	double NextHeartbeat = 0.0;
+	int32 LastTarget = -1;
+	uint64 ReportMessages = 0;
+	uint64 ReportDatagrams = 0;
+	int32 LateTicks = 0;
+
+	FVistarEntityUpdate Update;
+	Update.Stream = EVistarStream::Update;
+
+	while (!IsEngineExitRequested())
+	{
+		const double Time = NextTick - StartTime;
+		if (Duration > 0.0 && Time >= Duration)
+		{
+			break;
+		}
+
+		const int32 Target = GetTargetCount(Time);
+		if (Target != LastTarget)
+		{
+			UE_LOG(LogTemp, Display, TEXT("VistarTrafficGen: %d entities at %.1f Hz"), Target, Options.UpdateRateHz);
+			LastTarget = Target;
+		}
+		SetEntityCount(Target);
+
+		TickTime = NextTick;
+		while (TOptional<FVistarInterestArea> Area = PendingAreas.Dequeue())
+		{
+			Interest.Subscribe(Area.GetValue(), TickTime);
+		}
+
+		// Churn and actions are spread over the ticks at their average rate
+		ChurnDue += Options.ChurnPerSecond * TickSeconds;
+		for (; ChurnDue >= 1.0 && Entities.Num() > 0; ChurnDue -= 1.0)
+		{
+			Despawn(Random.RandHelper(Entities.Num()));
+			SetEntityCount(Target);
+		}
+		ActionsDue += Options.ActionsPerSecond * TickSeconds;
+		for (; ActionsDue >= 1.0 && Entities.Num() > 0; ActionsDue -= 1.0)
+		{
+			const FSimEntity& Entity = Entities[Random.RandHelper(Entities.Num())];
+			FVistarEntityUpdate Action;
+			Action.Stream = EVistarStream::Action;
+			Action.Id = Entity.Id;
+			Action.Class = Entity.Class;
+			Action.Action = FVistarInlineString(Options.ActionName);
+			Send(Action);
+		}
+
+		// Attached children sit on their parent's socket, an update would detach them
+		for (const FSimEntity& Entity : Entities)
+		{
+			if (Entity.Parent != INDEX_NONE)
+			{
+				continue;
+			}
+			if (Options.SwarmSize > 0 && Entity.Class == EVistarClassType::VISTAR_TYPE_DRONE_SWARM)
+			{
+				SendSwarm(Entity, Time);
+				continue;
+			}
+			FillState(Entity, Time, Update);
+			Send(Update);
+		}
+		if (Options.KeyframeSeconds > 0.0f && Time >= NextKeyframe)
+		{
+			SendKeyframe(Time);
+			NextKeyframe = Time + Options.KeyframeSeconds;
+		}
+		if (Options.HeartbeatSeconds > 0.0f && Time >= NextHeartbeat)
+		{
+			SendHeartbeat();
+			NextHeartbeat = Time + Options.HeartbeatSeconds;
+		}
+		Sender->Flush();
+
+		const double Now = FPlatformTime::Seconds();
+		if (Now >= NextReport)
+		{
+			const uint64 Datagrams = Sender->GetSentCount();
+			UE_LOG(LogTemp, Display, TEXT("VistarTrafficGen: %d entities (%d attached), %llu msgs/s, %llu datagrams/s, sender queue %d, %d late ticks"),
+				Entities.Num(), NumAttached, MessagesSent - ReportMessages, Datagrams - ReportDatagrams, Sender->GetQueueDepth(), LateTicks);
+			// Lets the viewers show what their interest areas saved
+			if (Options.InterestPort > 0)
+			{
+				TArray<uint8> Buffer = Sender->AcquireBuffer();
+				FVistarInterest::WriteReport(Interest.GetReport(), Buffer);
+				Sender->Send(MoveTemp(Buffer));
+				const FVistarInterestReport& Report = Interest.GetReport();
+				UE_LOG(LogTemp, Display, TEXT("VistarTrafficGen: %d interest subscribers, %llu updates held back so far"), Interest.GetNumSubscribers(), Report.Suppressed);
+			}
+			ReportMessages = MessagesSent;
+			ReportDatagrams = Datagrams;
+			LateTicks = 0;
+			NextReport += 1.0;
+		}
+
+		NextTick += TickSeconds;
+		if (NextTick > Now)
+		{
+			FPlatformProcess::SleepNoStats(static_cast<float>(NextTick - Now));
+		}
+		else
+		{
+			// Cannot keep the rate, skip ahead instead of bursting to catch up
+			++LateTicks;
+			NextTick = Now;
+		}
+	}
+
+	SetEntityCount(0);
+	Sender->Flush();
+	UE_LOG(LogTemp, Display, TEXT("VistarTrafficGen: done, %llu messages in %.1f s"), MessagesSent, FPlatformTime::Seconds() - StartTime);
+}
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VistarMessage.h"
+#include "VistarNetworkConfig.h"
+#include "VistarInterest.h"
+#include "VistarSwarm.h"
+#include "VistarLease.h"
+#include "Containers/SpscQueue.h"
+
+class FUdpCommunicator;
+class FVistarSender;
+
+/**
+ * Settings of FVistarTrafficGenerator, parsed from a command line
+ */
+struct VISTAR_API FVistarTrafficGenOptions
+{
+	FString TargetIp = TEXT("225.0.0.1");
+	int32 Port = 8888;
+	// Write into the viewer's shared memory ring of this name instead of sending UDP
+	FString SharedMemoryName;
+	// Listen for viewer interest areas here and filter updates by them, 0 = send everything
+	int32 InterestPort = 0;
+
+	int32 Entities = 100;
+	// Updates per entity per second
+	float UpdateRateHz = 20.0f;
+	// Relative weight per CLASS, "fighter=4,uav=2,drone_swarm=1,missile=2,radar=1,launcher=1"
+	TMap<EVistarClassType, float> ClassMix;
+	// Share of missiles and drones created attached to a launcher or swarm
+	float AttachedFraction = 0.1f;
+	// Entities deleted and replaced by new ones per second
+	float ChurnPerSecond = 0.0f;
+	// ACTION messages per second, sent to random entities
+	float ActionsPerSecond = 0.0f;
+	FString ActionName = TEXT("destroy");
+	// Seconds between keyframes of every entity, 0 = none. Use with -fragment
+	float KeyframeSeconds = 0.0f;
+	// Members of every drone swarm, sent as one swarm message per tick instead of the swarm's update.
+	// 0 = plain updates. Over ~100 members use -fragment
+	int32 SwarmSize = 0;
+	// Seconds between heartbeats listing every entity, 0 = none
+	float HeartbeatSeconds = 0.0f;
+
+	// 0 = until the process is stopped
+	float DurationSeconds = 0.0f;
+	// Entity counts stepped through in order, each held for StepSeconds. Overrides Entities
+	TArray<int32> Sweep;
+	float StepSeconds = 30.0f;
+
+	int32 Seed = 0;
+
+	// Wire format, bundling, fragmentation and sequence header, same fields as the viewer's outbound side
+	FVistarNetworkConfig Network;
+
+	// -entities=5000 -rate=20 -mix=fighter=4,uav=1 -attached=0.2 -churn=10 -actions=2 -action=destroy
+	// -keyframe=2 -swarmsize=500 -heartbeat=5 -duration=60 -sweep=100,1000,10000,50000 -step=30 -seed=1 -ip=225.0.0.1 -port=8888 -shm=vistar_ingest
+	// -interestport=7777
+	// -binary -quantize -bundle -bundlesize=1400 -fragment -seq -sourceid=2 -sync
+	static bool Parse(const TCHAR* Params, FVistarTrafficGenOptions& OutOptions, FString& OutError);
+};
+
+/**
+ * Synthetic VISTAR traffic for load testing a viewer without a simulator
+ * Entities fly circles around a fixed point, send create on spawn, an update per tick and delete on
+ * churn. Everything goes out through FVistarSender, so wire formats, bundles, fragments and the
+ * sequence header are exactly what a real sender produces.
+ */
+class VISTAR_API FVistarTrafficGenerator
+{
+public:
+	explicit FVistarTrafficGenerator(const FVistarTrafficGenOptions& InOptions);
+	~FVistarTrafficGenerator();
+
+	// Opens the socket, false when that fails
+	bool Start();
+
+	// Sends until the duration or the sweep runs out, or the engine is asked to exit
+	void Run();
+
+private:
+	struct FSimEntity
+	{
+		FVistarEntityId Id;
+		EVistarClassType Class = EVistarClassType::VISTAR_TYPE_NONE;
+		double CenterLat = 0.0;
+		double CenterLon = 0.0;
+		// Circle radius in degrees, and the angular speed around it in radians per second
+		double Radius = 0.0;
+		double AngularSpeed = 0.0;
+		double Phase = 0.0;
+		double Alt = 0.0;
+		// Index into Entities, attached children follow their parent and get no updates
+		int32 Parent = INDEX_NONE;
+		int32 ChildId = 0;
+	};
+
+	EVistarClassType PickClass();
+	void Spawn();
+	// Deletes the entity and its children
+	void Despawn(int32 Index);
+	void SetEntityCount(int32 Count);
+
+	void FillState(const FSimEntity& Entity, double Time, FVistarEntityUpdate& OutMessage) const;
+	void Encode(const FVistarEntityUpdate& Message, TArray<uint8>& OutBuffer) const;
+	void Send(const FVistarEntityUpdate& Message);
+	// Every entity as a create with its latest state, bundled into keyframes
+	void SendKeyframe(double Time);
+	// The swarm's reference point and Options.SwarmSize members flying a formation around it
+	void SendSwarm(const FSimEntity& Entity, double Time);
+	// The IDs of every entity, in parts of one bundle each
+	void SendHeartbeat();
+
+	int32 GetTargetCount(double Time) const;
+
+	FVistarTrafficGenOptions Options;
+	FRandomStream Random;
+
+	FUdpCommunicator* Communicator;
+	TUniquePtr<FVistarSender> Sender;
+
+	// Areas from the receiver thread, applied on the generator thread
+	TSpscQueue<FVistarInterestArea> PendingAreas;
+	FVistarInterestFilter Interest;
+	// Time of the tick being sent, for the interest filter
+	double TickTime;
+
+	TArray<FSimEntity> Entities;
+	// Entities sitting on a parent socket
+	int32 NumAttached;
+	uint64 NextSerial;
+
+	TArray<TPair<EVistarClassType, float>> Weights;
+	float TotalWeight;
+
+	uint64 MessagesSent;
+	uint32 KeyframeId;
+	uint32 HeartbeatId;
+	// Reused by every swarm message
+	FVistarSwarmUpdate Swarm;
+};
@@ -1,5 +1,6 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class VISTAR : ModuleRules
@@ -18,6 +19,17 @@ public class VISTAR : ModuleRules
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
+		// Batched UDP receive (recvmmsg) needs the native descriptor behind FSocketBSD
+		if (Target.Platform == UnrealTargetPlatform.Linux)
+		{
+			PrivateIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Sockets/Private"));
+			PublicDefinitions.Add("VISTAR_WITH_RECVMMSG=1");
+		}
+		else
+		{
+			PublicDefinitions.Add("VISTAR_WITH_RECVMMSG=0");
+		}
+
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
 		